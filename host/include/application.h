@@ -3,17 +3,29 @@
 #include "service_registry.h"
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QElapsedTimer>
 #include <memory>
 
 namespace mpf {
 
 class PluginManager;
 class Logger;
+class QmlUrlInterceptor;
+class PageCache;
+class QmlContext;
 
 /**
  * @brief Main application class
  * 
  * Manages application lifecycle, plugin loading, and QML engine setup.
+ *
+ * With --headless (or MPF_HEADLESS=1) the application runs on a
+ * QCoreApplication without QML engine or window: the service registry,
+ * host services and plugin lifecycle work as usual, which allows running
+ * plugin services as a batch worker or benchmarking them without a
+ * display. --script <file> then drives them (see ScriptDriver); it
+ * works with the window too, and the application quits when the script
+ * is done.
  */
 class Application : public QObject
 {
@@ -36,7 +48,12 @@ public:
     int run();
 
     /**
-     * @brief Get the QML engine
+     * @brief Whether the application runs without GUI and QML engine
+     */
+    bool isHeadless() const { return m_headless; }
+
+    /**
+     * @brief Get the QML engine (nullptr when headless)
      */
     QQmlApplicationEngine* engine() const { return m_engine.get(); }
 
@@ -67,22 +84,40 @@ signals:
 private:
     void setupPaths();
     void setupLogging();
+    QStringList qmlSearchPaths() const;
     void setupQmlContext();
     void loadPlugins();
     bool loadMainQml();
-
-    std::unique_ptr<QGuiApplication> m_app;
-    std::unique_ptr<QQmlApplicationEngine> m_engine;
+    void releasePluginPage(const QString& pluginId);
+    void markPluginUsed(const QString& pluginId);
+    QString currentPagePlugin() const;
+    void reportStartupTimes();
+    void reportQmlCompilation();
+    int runScript();
+
+    // Declaration order matters: the engine is destroyed before the registry
+    // so QML never outlives the lazily constructed services it references
+    std::unique_ptr<QCoreApplication> m_app;  // QGuiApplication unless headless
     std::unique_ptr<ServiceRegistryImpl> m_registry;
+    std::unique_ptr<QmlUrlInterceptor> m_urlInterceptor;  // Must outlive the engine
+    std::unique_ptr<QQmlApplicationEngine> m_engine;
+    std::unique_ptr<PageCache> m_pageCache;  // Pages die before the engine
+    QmlContext* m_qmlContext = nullptr;      // Child of this, GUI mode only
     std::unique_ptr<PluginManager> m_pluginManager;
     std::unique_ptr<Logger> m_logger;
 
     QString m_pluginPath;
     QString m_qmlPath;
     QString m_configPath;
+    QString m_scriptPath;            // --script / MPF_SCRIPT (headless or GUI; quits when done)
+    QString m_scriptResultPath;      // --script-results / MPF_SCRIPT_RESULTS
+    bool m_headless = false;
     QStringList m_extraQmlPaths;     // Extra QML import paths (e.g., SDK qml directory)
     QStringList m_extraPluginPaths;  // Extra plugin search paths (for development overrides)
 
+    QElapsedTimer m_startupTimer;    // Started before QGuiApplication
+    qint64 m_pluginsReadyMs = 0;     // Startup plugins loaded (before any warm-up)
+
     static Application* s_instance;
 };
 
@@ -7,6 +7,8 @@
 #include <QMutex>
 #include <QRegularExpression>
 
+#include "plugin_context.h"
+
 namespace mpf {
 
 /**
@@ -59,6 +61,12 @@ public:
     // Property accessor
     int totalSubscribers() const;
 
+    /**
+     * @brief Install the handler told about every delivery to a subscriber
+     * @note Set once during startup
+     */
+    void setDeliveryHandler(PluginUsageHandler handler);
+
 signals:
     /**
      * @brief Emitted when an event is published (for QML/C++ subscribers)
@@ -111,6 +119,7 @@ private:
     QHash<QString, Subscription> m_subscriptions;       // subscriptionId -> Subscription
     QHash<QString, QStringList> m_subscriberIndex;      // subscriberId -> [subscriptionIds]
     QHash<QString, TopicData> m_topicStats;             // topic -> stats
+    PluginUsageHandler m_deliveryHandler;
 };
 
 } // namespace mpf
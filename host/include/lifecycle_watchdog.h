@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <memory>
+
+class QThread;
+
+namespace mpf {
+
+/**
+ * @brief Reports plugin lifecycle calls that overrun their time budget
+ *
+ * Plugin code cannot be interrupted safely, so nothing is aborted: a
+ * monitor thread logs a call that is still running when its budget runs
+ * out, and again each time the overrun doubles, naming the plugin that
+ * holds up the host. What happens to the plugin once the call returns is
+ * up to PluginManager.
+ */
+class LifecycleWatchdog
+{
+public:
+    LifecycleWatchdog();
+    ~LifecycleWatchdog();
+
+    /**
+     * @brief Budget for a phase ("initialize", "start", "stop") when the
+     *        plugin metadata sets none
+     */
+    static qint64 defaultBudgetMs(const QString& phase);
+
+    /**
+     * @brief Start watching a call (thread-safe)
+     * @param budgetMs Budget; 0 or less leaves the call unwatched
+     * @return Token for disarm()
+     */
+    quint64 arm(const QString& pluginId, const QString& phase, qint64 budgetMs);
+
+    /**
+     * @brief Stop watching a call (thread-safe)
+     */
+    void disarm(quint64 token);
+
+    LifecycleWatchdog(const LifecycleWatchdog&) = delete;
+    LifecycleWatchdog& operator=(const LifecycleWatchdog&) = delete;
+
+private:
+    struct Watch {
+        QString pluginId;
+        QString phase;
+        qint64 budgetMs;
+        qint64 nextReportMs;     // Doubles after each report
+        QElapsedTimer timer;
+    };
+
+    void run();
+
+    QMutex m_mutex;
+    QWaitCondition m_changed;
+    QHash<quint64, Watch> m_watches;
+    quint64 m_nextToken = 1;
+    bool m_quit = false;
+    std::unique_ptr<QThread> m_thread;
+};
+
+/**
+ * @brief RAII watch over one lifecycle call
+ */
+class WatchdogScope
+{
+public:
+    WatchdogScope(LifecycleWatchdog* watchdog, const QString& pluginId,
+                  const QString& phase, qint64 budgetMs)
+        : m_watchdog(watchdog)
+        , m_token(watchdog->arm(pluginId, phase, budgetMs))
+    {
+    }
+
+    ~WatchdogScope()
+    {
+        m_watchdog->disarm(m_token);
+    }
+
+    WatchdogScope(const WatchdogScope&) = delete;
+    WatchdogScope& operator=(const WatchdogScope&) = delete;
+
+private:
+    LifecycleWatchdog* m_watchdog;
+    quint64 m_token;
+};
+
+} // namespace mpf
@@ -4,15 +4,26 @@
 #include <QObject>
 #include <QMutex>
 #include <QString>
+#include <QDateTime>
 #include <functional>
+#include <memory>
 
 namespace mpf {
 
+class AsyncLogWriter;
+
 /**
  * @brief Default logger implementation
  * 
  * Routes logs to Qt's message system with formatting.
  * Can be replaced with custom implementation via ServiceRegistry.
+ *
+ * In async mode (enableAsync(), MPF_LOG_ASYNC=1) log() only copies the
+ * message into a bounded lock-free queue; a writer thread formats it and
+ * passes it on (the handler then runs on that thread). When the queue is
+ * full the message is dropped and counted instead of blocking the caller.
+ * Errors are written before log() returns, and everything queued is
+ * written before a fatal message aborts and when the logger is destroyed.
  */
 class Logger : public QObject, public ILogger
 {
@@ -32,6 +43,27 @@ public:
     // Custom handler
     void setHandler(LogHandler handler);
 
+    /**
+     * @brief Write messages on a background thread from now on
+     * @param queueSize Messages that may wait to be written (rounded up to a power of two)
+     * @note Call before other threads log; async mode stays on for the
+     *       lifetime of the logger
+     */
+    void enableAsync(int queueSize = 8192);
+    bool isAsync() const { return m_async != nullptr; }
+
+    /**
+     * @brief Wait until the messages logged so far are written
+     * @param timeoutMs Longest wait, -1 for no limit
+     * @return true if everything was written
+     */
+    bool flush(int timeoutMs = 5000);
+
+    /**
+     * @brief Messages dropped because the async queue was full
+     */
+    quint64 droppedCount() const;
+
     // Formatting
     void setFormat(const QString& format);
     QString format() const;
@@ -41,13 +73,15 @@ public:
     static void setInstance(Logger* logger);
 
 private:
-    QString formatMessage(Level level, const QString& tag, const QString& message);
+    void write(Level level, const QString& tag, const QString& message, const QDateTime& time);
+    QString formatMessage(Level level, const QString& tag, const QString& message, const QDateTime& time);
     static QString levelToString(Level level);
 
     Level m_minLevel = Level::Debug;
     QString m_format = "[%level%] [%tag%] %message%";
     LogHandler m_handler;
     mutable QMutex m_mutex;
+    std::unique_ptr<AsyncLogWriter> m_async;
 
     static Logger* s_instance;
 };
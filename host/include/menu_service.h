@@ -9,6 +9,8 @@ namespace mpf {
 
 /**
  * @brief Default menu service implementation
+ *
+ * Thread-safe; menuChanged() is always emitted on the service's thread.
  */
 class MenuService : public QObject, public IMenu
 {
@@ -38,6 +40,7 @@ signals:
     void menuChanged();
 
 private:
+    void notifyChanged();
     void sortItems();
     
     mutable QMutex m_mutex;
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "mpf/interfaces/inavigation.h"
-#include <QList>
+#include "plugin_context.h"
+#include "route_table.h"
+#include <QMutex>
+#include <functional>
 
 class QQmlApplicationEngine;
 
@@ -13,15 +16,59 @@ namespace mpf {
  * Plugins register their main page URL via registerRoute().
  * QML uses getPageUrl() to load pages via Loader.
  * Internal navigation within plugins uses Popup/Dialog.
+ *
+ * Routes may have parameter segments ("orders/:id"); see RouteTable.
+ * The parameters of a concrete route ("orders/42" gives {"id": "42"})
+ * come with navigationChanged() and from routeParams(), and the page
+ * cache hands them to the page's routeParams property.
+ *
+ * Thread-safe: thread-safe plugins register routes from pool threads
+ * during parallel startup. navigationChanged() is always emitted on the
+ * service's thread.
  */
 class NavigationService : public QObject, public INavigation
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Called for a route nobody has registered yet
+     *
+     * Returns true if it registered the route (e.g. by loading the
+     * plugin that declares it), in which case the lookup is retried.
+     */
+    using RouteActivationHandler = std::function<bool(const QString& route)>;
+
     explicit NavigationService(QQmlApplicationEngine* engine, QObject* parent = nullptr);
     ~NavigationService() override;
 
+    void setRouteActivationHandler(RouteActivationHandler handler);
+
+    /**
+     * @brief Install the handler told which plugin owns each page looked up
+     */
+    void setRouteUsageHandler(PluginUsageHandler handler);
+
+    /**
+     * @brief Remove the routes a plugin registered
+     */
+    void unregisterPluginRoutes(const QString& pluginId);
+
+    /**
+     * @brief ID of the plugin that registered a route (empty for the host)
+     */
+    QString routeOwner(const QString& route) const;
+
+    /**
+     * @brief Registered pattern a concrete route matches (empty if none)
+     */
+    QString routePattern(const QString& route) const;
+
+    /**
+     * @brief Parameters of a concrete route, from its pattern and query string
+     */
+    Q_INVOKABLE QVariantMap routeParams(const QString& route) const;
+
     // INavigation interface
     Q_INVOKABLE void registerRoute(const QString& route, const QString& qmlPageUrl) override;
     Q_INVOKABLE QString getPageUrl(const QString& route) const override;
@@ -32,14 +79,15 @@ signals:
     void navigationChanged(const QString& route, const QVariantMap& params);
 
 private:
+    bool findRoute(const QString& route, QString* pageUrl, QString* pluginId,
+                   QVariantMap* params = nullptr, QString* pattern = nullptr) const;
+
     QQmlApplicationEngine* m_engine;
+    mutable QMutex m_mutex;             // Guards m_currentRoute and m_routes
     QString m_currentRoute;
-    
-    struct RouteEntry {
-        QString pattern;
-        QString pageUrl;
-    };
-    QList<RouteEntry> m_routes;
+    RouteTable m_routes;
+    RouteActivationHandler m_routeActivationHandler;
+    PluginUsageHandler m_routeUsageHandler;
 };
 
 } // namespace mpf
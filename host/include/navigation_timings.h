@@ -0,0 +1,107 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QVariantList>
+#include <vector>
+
+namespace mpf {
+
+/**
+ * @brief Phases of one navigation, in nanoseconds
+ */
+struct NavigationTiming
+{
+    QString route;
+    QString pattern;        // Registered route it matched, e.g. "orders/:id" (else the route)
+    qint64 timestamp = 0;   // Start, milliseconds since the epoch
+    qint64 resolveNs = 0;   // Route lookup, including loading the plugin that owns it
+    qint64 compileNs = 0;   // Loading and compiling the page component
+    qint64 createNs = 0;    // Incubating the page object
+    qint64 frameNs = 0;     // Page shown until the first frame with it was swapped
+    qint64 totalNs = 0;     // Request until that frame (or the failure)
+    bool cached = false;    // The page was already created
+    bool failed = false;
+};
+
+/**
+ * @brief Recent navigations and their per-route percentiles
+ *
+ * The page cache records every navigation it completes: the time from the
+ * route request to the first frame showing the page, split into route
+ * resolution, component compilation, object creation and the wait for
+ * that frame. The last navigations are kept in a fixed-size ring buffer;
+ * summary() computes percentiles over it per route pattern, so that
+ * "orders/1" and "orders/2" count towards the same "orders/:id" row.
+ *
+ * Exposed to QML as NavigationTimings. MPF_NAVIGATION_TIMINGS=<file>
+ * writes the recorded navigations as JSON and logs the summary when the
+ * application quits.
+ *
+ * @note GUI thread only.
+ */
+class NavigationTimings : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY recorded)
+    Q_PROPERTY(int capacity READ capacity CONSTANT)
+
+public:
+    explicit NavigationTimings(int capacity = 256, QObject* parent = nullptr);
+
+    int count() const { return m_size; }
+    int capacity() const { return int(m_ring.size()); }
+
+    void record(const NavigationTiming& timing);
+
+    /**
+     * @brief Recorded navigations, oldest first
+     */
+    QList<NavigationTiming> recent() const;
+
+    /**
+     * @brief Recorded navigations, newest first
+     *
+     * Each entry is a map with route, pattern, timestamp, cached, failed and the
+     * phase durations in milliseconds: resolveMs, compileMs, createMs,
+     * frameMs and totalMs.
+     */
+    Q_INVOKABLE QVariantList history() const;
+
+    /**
+     * @brief Per-pattern percentiles, slowest p90 first
+     *
+     * Each entry is a map with route (the pattern), count, cached and failed counts,
+     * and for the total and each phase the 50th, 90th and 99th percentile
+     * in milliseconds (e.g. totalP50Ms, compileP90Ms) plus totalMaxMs.
+     * Failed navigations are counted but not part of the percentiles.
+     */
+    Q_INVOKABLE QVariantList summary() const;
+
+    /**
+     * @brief Discard the recorded navigations
+     */
+    Q_INVOKABLE void reset();
+
+    /**
+     * @brief Format the summary as a table for logging
+     */
+    QString report() const;
+
+    /**
+     * @brief Write history and summary as JSON
+     * @return true if the file was written
+     */
+    Q_INVOKABLE bool write(const QString& path) const;
+
+signals:
+    void recorded();
+
+private:
+    std::vector<NavigationTiming> m_ring;
+    int m_next = 0;     // Slot of the next record
+    int m_size = 0;
+};
+
+} // namespace mpf
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "navigation_timings.h"
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <memory>
+
+class QQmlEngine;
+class QQmlComponent;
+class QQuickItem;
+
+namespace mpf {
+
+class NavigationService;
+class PageIncubator;
+
+/**
+ * @brief Creates route pages asynchronously and keeps them for reuse
+ *
+ * Pages are compiled and incubated without blocking the GUI thread, one
+ * at a time, and kept after they are left: an LRU of instantiated pages
+ * whose estimated memory (resident set growth while the page was created)
+ * stays within a budget, MPF_PAGE_CACHE_MB (default 64). The page shown
+ * is never evicted. Returning to a cached page only swaps visibility.
+ *
+ * The cache follows NavigationService: show() sets the current route, and
+ * a route set elsewhere (e.g. by a plugin) is shown as well. prefetch()
+ * creates a page ahead of time, e.g. while its menu item is hovered.
+ *
+ * Pages are parented to the container item and sized to it. Each
+ * concrete route gets its own page; a page declaring
+ * "property var routeParams" receives the route's parameters.
+ *
+ * Every navigation is timed from show() to the first frame swapped with
+ * the page and recorded in timings(). The phases (resolve, compile,
+ * create) are those of the job that created the page, which may have
+ * started before show() when the page was prefetched.
+ */
+class PageCache : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem* container READ container WRITE setContainer NOTIFY containerChanged)
+    Q_PROPERTY(QQuickItem* currentItem READ currentItem NOTIFY currentItemChanged)
+    Q_PROPERTY(QString currentRoute READ currentRoute NOTIFY currentRouteChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+    Q_PROPERTY(int pageCount READ pageCount NOTIFY pagesChanged)
+    Q_PROPERTY(qint64 memoryUsed READ memoryUsed NOTIFY pagesChanged)
+
+public:
+    PageCache(QQmlEngine* engine, NavigationService* navigation, QObject* parent = nullptr);
+    ~PageCache() override;
+
+    QQuickItem* container() const { return m_container; }
+    void setContainer(QQuickItem* container);
+
+    QQuickItem* currentItem() const { return m_currentItem; }
+    QString currentRoute() const { return m_currentRoute; }
+    bool isLoading() const { return m_loading; }
+    int pageCount() const { return int(m_pages.size()); }
+    qint64 memoryUsed() const;
+
+    NavigationTimings* timings() const { return m_timings; }
+
+    /**
+     * @brief Memory budget for cached pages in bytes
+     */
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+
+    /**
+     * @brief Show the page of a route; an empty route shows no page (home)
+     */
+    Q_INVOKABLE void show(const QString& route);
+
+    /**
+     * @brief Create the page of a route in the background if not cached
+     */
+    Q_INVOKABLE void prefetch(const QString& route);
+
+    /**
+     * @brief Destroy every page of a plugin (before its library unloads)
+     */
+    void releasePlugin(const QString& pluginId);
+
+signals:
+    void containerChanged();
+    void currentItemChanged();
+    void currentRouteChanged();
+    void loadingChanged();
+    void pagesChanged();
+    void loadFailed(const QString& route, const QString& error);
+    
+    /**
+     * @brief Emitted before a page's QML is first compiled
+     */
+    void aboutToCompile(const QString& url);
+
+private:
+    struct Page {
+        QString route;
+        QString url;
+        QString pluginId;
+        QQuickItem* item = nullptr;
+        qint64 cost = 0;            // Estimated bytes
+    };
+
+    struct CachedComponent {
+        QQmlComponent* component = nullptr;
+        QString pluginId;
+    };
+
+    struct Job {
+        QString route;
+        QString url;
+        QString pluginId;
+        QQmlComponent* component = nullptr;
+        std::unique_ptr<PageIncubator> incubator;
+        qint64 residentBefore = 0;
+        QElapsedTimer timer;        // Started before the route was resolved
+        qint64 resolveNs = 0;
+        qint64 compileNs = 0;
+    };
+
+    struct Measurement {
+        int id = 0;
+        NavigationTiming timing;
+        QElapsedTimer timer;
+        qint64 shownNs = 0;         // Page became visible
+    };
+
+    friend class PageIncubator;
+
+    qsizetype indexOf(const QString& route) const;
+    void enqueue(const QString& route, bool urgent);
+    void startNext();
+    void createPage();
+    void incubated();
+    void fail(const QString& route, const QString& error);
+    void setCurrentItem(QQuickItem* item);
+    void setLoading(bool loading);
+    void fitToContainer();
+    void evict();
+    void destroyPage(const Page& page);
+    void cancelJob();
+    void beginMeasurement(const QString& route);
+    void awaitFrame();
+    void finishMeasurement(bool failed);
+
+    QQmlEngine* m_engine;
+    QPointer<NavigationService> m_navigation;
+    QPointer<QQuickItem> m_container;
+    QPointer<QQuickItem> m_currentItem;
+    QString m_currentRoute;
+    bool m_loading = false;
+    qint64 m_budget;
+
+    QList<Page> m_pages;                            // Most recently used first
+    QHash<QString, CachedComponent> m_components;   // By URL
+    QStringList m_queue;                            // Routes waiting to be created
+    std::unique_ptr<Job> m_job;                     // Page being created
+
+    NavigationTimings* m_timings;
+    std::unique_ptr<Measurement> m_measurement;     // Navigation being timed
+    int m_lastMeasurementId = 0;
+};
+
+} // namespace mpf
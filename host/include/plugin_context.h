@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QString>
+#include <functional>
+
+namespace mpf {
+
+/**
+ * @brief Notified when a host service does work on behalf of a plugin
+ *
+ * Used to track when each plugin was last used (route shown, service
+ * looked up, event delivered). Must be cheap and thread-safe.
+ */
+using PluginUsageHandler = std::function<void(const QString& pluginId)>;
+
+/**
+ * @brief The plugin on whose behalf the current thread is running
+ *
+ * PluginManager sets it around plugin lifecycle calls so that host
+ * services can attribute what a plugin registers (routes, services, ...)
+ * without the plugin having to pass its ID, and remove it again when the
+ * plugin is reloaded or unloaded.
+ */
+class PluginContext
+{
+public:
+    /**
+     * @brief ID of the plugin running on this thread (empty for the host)
+     */
+    static QString current();
+
+private:
+    friend class PluginContextScope;
+    static thread_local QString s_current;
+};
+
+/**
+ * @brief RAII scope marking the current thread as running a plugin
+ */
+class PluginContextScope
+{
+public:
+    explicit PluginContextScope(const QString& pluginId)
+        : m_previous(PluginContext::s_current)
+    {
+        PluginContext::s_current = pluginId;
+    }
+
+    ~PluginContextScope()
+    {
+        PluginContext::s_current = m_previous;
+    }
+
+    PluginContextScope(const PluginContextScope&) = delete;
+    PluginContextScope& operator=(const PluginContextScope&) = delete;
+
+private:
+    QString m_previous;
+};
+
+} // namespace mpf
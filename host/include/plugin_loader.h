@@ -4,11 +4,13 @@
 #include <QString>
 #include <QPluginLoader>
 #include <memory>
+#include <optional>
 
 namespace mpf {
 
 class IPlugin;
 class PluginMetadata;
+class RemotePlugin;
 
 /**
  * @brief Handles loading a single plugin
@@ -27,6 +29,14 @@ public:
     };
 
     explicit PluginLoader(const QString& path, QObject* parent = nullptr);
+
+    /**
+     * @brief Wrap a plugin linked into the host (see MPF_STATIC_PLUGINS)
+     *
+     * load() only instantiates it; unload() releases it without unloading
+     * code. path() is "static:<class name>".
+     */
+    explicit PluginLoader(const QStaticPlugin& plugin, QObject* parent = nullptr);
     ~PluginLoader() override;
 
     /**
@@ -52,11 +62,41 @@ public:
      */
     const PluginMetadata& metadata() const { return *m_metadata; }
 
+    /**
+     * @brief Provide metadata read at discovery so load() need not re-read it
+     */
+    void setMetadata(const PluginMetadata& metadata);
+
     /**
      * @brief Get plugin file path
      */
     QString path() const { return m_path; }
 
+    /**
+     * @brief Check if the plugin is linked into the host
+     */
+    bool isStatic() const { return !m_loader; }
+
+    /**
+     * @brief Run the plugin in a separate mpf-plugin-host process
+     *
+     * Takes effect on the next load(). plugin() is then a RemotePlugin
+     * proxy; the library is still mapped here, uninstantiated, for its QML
+     * resources. Also enabled by "outOfProcess": true in the metadata.
+     *
+     * Refused, with a warning, for plugins whose metadata lists "provides":
+     * their services would exist only in the plugin host. Also refused for
+     * plugins with "qmlModules" unless their own metadata sets
+     * "outOfProcess": their QML renders here, but types they register from
+     * C++ would not exist here (see plugins/notes for a plugin built for it).
+     */
+    void setOutOfProcess(bool outOfProcess);
+
+    /**
+     * @brief Check if the plugin runs out of process
+     */
+    bool isOutOfProcess() const;
+
     /**
      * @brief Get current state
      */
@@ -83,8 +123,11 @@ signals:
 
 private:
     QString m_path;
-    std::unique_ptr<QPluginLoader> m_loader;
+    std::unique_ptr<QPluginLoader> m_loader;   // Null for static plugins
+    std::optional<QStaticPlugin> m_staticPlugin;
     std::unique_ptr<PluginMetadata> m_metadata;
+    std::unique_ptr<RemotePlugin> m_remote;
+    bool m_outOfProcess = false;
     IPlugin* m_plugin = nullptr;
     State m_state = State::Unloaded;
     QString m_errorString;
@@ -4,16 +4,41 @@
 #include <QString>
 #include <QList>
 #include <QHash>
+#include <QSet>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <functional>
+#include <QJsonObject>
 #include <memory>
 #include <vector>
 
+class QFileInfo;
+class QFileSystemWatcher;
+class QTimer;
+
 namespace mpf {
 
 class PluginLoader;
 class ServiceRegistry;
 class PluginMetadata;
+class PluginMetadataCache;
+class LifecycleWatchdog;
 class IPlugin;
 
+/**
+ * @brief Time spent in one plugin's lifecycle calls
+ */
+struct PluginTiming
+{
+    QString id;
+    qint64 initializeNs = -1;  // -1 if not called
+    qint64 startNs = -1;
+    qint64 stopNs = -1;
+    bool threaded = false;     // Ran on a worker thread
+    bool slow = false;         // A call exceeded its budget (see LifecycleWatchdog)
+};
+
 /**
  * @brief Manages plugin discovery, loading, and lifecycle
  */
@@ -22,6 +47,21 @@ class PluginManager : public QObject
     Q_OBJECT
 
 public:
+    /**
+     * @brief How initializeAll() and startAll() schedule plugins
+     *
+     * Serial calls plugins one at a time in load order. Parallel groups
+     * plugins by dependency level; within a level, plugins whose metadata
+     * declares "threadSafe": true run concurrently on worker threads while
+     * the others run on the GUI thread. A level completes before the next
+     * one begins. Worker threads run no event loop, so thread-safe plugins
+     * must not create QObjects in initialize() or start() (see IPlugin).
+     */
+    enum class ExecutionMode {
+        Serial,
+        Parallel
+    };
+
     explicit PluginManager(ServiceRegistry* registry, QObject* parent = nullptr);
     ~PluginManager() override;
 
@@ -32,12 +72,156 @@ public:
      */
     int discover(const QString& path);
 
+    /**
+     * @brief Discover plugins in several directories
+     *
+     * Metadata is read and parsed on a thread pool; registration then
+     * happens in directory order, so a plugin ID found in an earlier
+     * directory takes precedence over the same ID in a later one.
+     *
+     * @param paths Directory paths, highest precedence first
+     * @return Number of plugins found
+     */
+    int discover(const QStringList& paths);
+
+    /**
+     * @brief Discover plugins linked into the host (MPF_STATIC_PLUGINS)
+     *
+     * Static plugins go through the same metadata and lifecycle path as
+     * shared ones, minus the library load. A plugin ID that is already
+     * known (e.g. a development override) takes precedence.
+     *
+     * @return Number of plugins found
+     */
+    int discoverStatic();
+
+    /**
+     * @brief Use an on-disk metadata cache for discovery
+     * @param filePath Cache file (created if missing)
+     */
+    void setMetadataCache(const QString& filePath);
+
+    /**
+     * @brief Persist the metadata cache and report its hit rate
+     */
+    void saveMetadataCache();
+
     /**
      * @brief Load all discovered plugins
+     *
+     * Plugins whose metadata sets "loadOnStartup": false are deferred unless
+     * a startup plugin depends on them: only the menu entries declared in
+     * their metadata are registered, and they are loaded, initialized and
+     * started by ensureLoaded() on first use.
+     *
      * @return true if all required plugins loaded successfully
      */
     bool loadAll();
 
+    /**
+     * @brief Load only critical plugins in loadAll()
+     *
+     * Startup plugins whose metadata does not set "critical": true (and
+     * that no critical plugin depends on) are deferred like loadOnStartup=
+     * false plugins and queued for warmUp(). Set before loadAll().
+     */
+    void setCriticalOnly(bool criticalOnly);
+
+    /**
+     * @brief Bring the startup plugins deferred by setCriticalOnly() up
+     *
+     * Runs from the event loop, one plugin per pass, so rendering and input
+     * are handled in between. Emits warmUpFinished() when the queue is done.
+     */
+    void warmUp();
+
+    /**
+     * @brief Plugins still queued for warmUp()
+     */
+    QStringList warmUpQueue() const { return m_warmUpQueue; }
+
+    /**
+     * @brief Bring a deferred plugin (and its dependencies) up to Started
+     * @return true if the plugin is running
+     */
+    bool ensureLoaded(const QString& id);
+
+    /**
+     * @brief Load the deferred plugin declaring a route in its metadata
+     * @return true if a plugin was loaded
+     */
+    bool loadForRoute(const QString& route);
+
+    /**
+     * @brief Load the deferred plugin whose metadata "provides" a service
+     * @param typeName Interface type name as used by the service registry
+     * @return true if a plugin was loaded
+     */
+    bool loadForService(const char* typeName);
+
+    /**
+     * @brief Plugins not loaded yet because they are loaded on demand
+     */
+    QStringList deferredPlugins() const;
+
+    /**
+     * @brief Reload a plugin from its (possibly rebuilt) binary
+     *
+     * Stops and unloads the plugin and every plugin depending on it,
+     * removing their event bus subscriptions, menu items, routes and
+     * services, then loads, initializes and starts them again in
+     * dependency order.
+     *
+     * @return true if all affected plugins came back up
+     */
+    bool reload(const QString& id);
+
+    /**
+     * @brief Plugins that depend on a plugin, directly or transitively
+     * @return Plugin IDs in load order
+     */
+    QStringList dependants(const QString& id) const;
+
+    /**
+     * @brief Watch plugin binaries and reload them when they change
+     */
+    void setWatchEnabled(bool enabled);
+
+    /**
+     * @brief Record that a plugin was used (thread-safe, lock-free)
+     *
+     * Fed by route lookups, service lookups and event deliveries.
+     */
+    void markUsed(const QString& id);
+
+    /**
+     * @brief Milliseconds since a plugin was last used (-1 if unknown)
+     */
+    qint64 idleTime(const QString& id) const;
+
+    /**
+     * @brief Unload plugins idle for longer than a threshold
+     *
+     * Idle plugins are stopped and unloaded, then deferred like
+     * loadOnStartup=false plugins so they load again on next use. Only
+     * plugins that can come back this way (metadata declares routes or
+     * provided services) and that no loaded plugin depends on qualify.
+     *
+     * @param timeoutMs Idle threshold; 0 disables idle unloading
+     */
+    void setIdleTimeout(qint64 timeoutMs);
+
+    /**
+     * @brief Veto idle unloading of a plugin, e.g. while its page is shown
+     */
+    void setIdleUnloadFilter(std::function<bool(const QString& id)> canUnload);
+
+    /**
+     * @brief Unload every plugin that is currently idle
+     * @return Number of plugins unloaded
+     */
+    int unloadIdlePlugins();
+
     /**
      * @brief Initialize all loaded plugins (dependency resolution)
      * @return true if all plugins initialized successfully
@@ -50,6 +234,24 @@ public:
      */
     bool startAll();
 
+    /**
+     * @brief Set the scheduling used by initializeAll() and startAll()
+     */
+    void setExecutionMode(ExecutionMode mode);
+    ExecutionMode executionMode() const { return m_executionMode; }
+
+    /**
+     * @brief Run the given discovered plugins in mpf-plugin-host processes
+     *
+     * Takes effect when a plugin is next loaded (see PluginLoader::setOutOfProcess()).
+     */
+    void setOutOfProcess(const QStringList& ids);
+
+    /**
+     * @brief Lifecycle call timings, in load order
+     */
+    QList<PluginTiming> timings() const;
+
     /**
      * @brief Stop all running plugins
      */
@@ -89,28 +291,94 @@ public:
 
     /**
      * @brief Get load order respecting dependencies
+     *
+     * Plugins come level by level (see loadLevels()); within a level they
+     * are ordered by metadata priority, lower first, then by ID. The order
+     * is computed once and cached until plugins are added or removed.
+     *
      * @return Ordered list of plugin IDs
      */
     QStringList loadOrder() const;
 
+    /**
+     * @brief Get plugins grouped by dependency level
+     * @return Levels in order; plugins within a level do not depend on each other
+     */
+    QList<QStringList> loadLevels() const;
+
 signals:
     void pluginDiscovered(const QString& id);
     void pluginLoaded(const QString& id);
     void pluginInitialized(const QString& id);
     void pluginStarted(const QString& id);
     void pluginStopped(const QString& id);
+    void pluginAboutToUnload(const QString& id);
     void pluginUnloaded(const QString& id);
+    void pluginReloaded(const QString& id);
+    void pluginIdleUnloaded(const QString& id, qint64 freedBytes);
     void pluginError(const QString& id, const QString& error);
+    void warmUpFinished(int started);
 
 private:
+    enum class Phase {
+        Initialize,
+        Start
+    };
+
+    QJsonObject readMetaData(const QFileInfo& info) const;
+    void deferPlugin(const QString& id);
+    bool bringUp(const QString& id);
+    void teardown(const QString& id);
+    void releaseRegistrations(const QString& id);
+    void checkPluginFile(const QString& path);
+    void reloadChanged();
+    void warmUpNext();
+    bool canUnloadIdle(const QString& id) const;
+    bool runPhase(Phase phase);
+    bool isReady(PluginLoader* loader, Phase phase) const;
+    bool invokePhase(PluginLoader* loader, Phase phase, qint64* elapsedNs) const;
+    bool finishPhase(const QString& id, Phase phase, bool ok, qint64 elapsedNs, bool threaded);
+    QString blockingDependency(PluginLoader* loader, Phase phase) const;
+    void invokeStop(const QString& id, PluginLoader* loader);
     QStringList computeLoadOrder() const;
-    bool topologicalSort(const QString& id, 
-                         QHash<QString, int>& state, 
-                         QStringList& order) const;
+    void buildLoadOrder() const;
+    void invalidateLoadOrder();
 
     ServiceRegistry* m_registry;
+    std::unique_ptr<LifecycleWatchdog> m_watchdog;
+    std::unique_ptr<PluginMetadataCache> m_metadataCache;
     std::vector<std::unique_ptr<PluginLoader>> m_loaders;
     QHash<QString, PluginLoader*> m_pluginMap;
+    QHash<QString, PluginTiming> m_timings;
+    QSet<QString> m_deferred;    // loadOnStartup=false plugins not loaded yet
+    QSet<QString> m_activating;  // Guards ensureLoaded() against re-entry
+    QStringList m_searchPaths;
+
+    // Hot reload
+    std::unique_ptr<QFileSystemWatcher> m_watcher;
+    QTimer* m_reloadTimer = nullptr;
+    QHash<QString, QDateTime> m_fileStamps;  // Plugin path -> last seen mtime
+    QSet<QString> m_pendingReloads;
+    ExecutionMode m_executionMode = ExecutionMode::Serial;
+
+    // Dependency order, rebuilt on demand after invalidateLoadOrder()
+    mutable QList<QStringList> m_levels;
+    mutable QStringList m_loadOrder;
+    mutable QStringList m_cyclic;      // Left out of the order: in or behind a cycle
+    mutable bool m_loadOrderValid = false;
+
+    // Idle unloading; the usage map is filled at discovery and never rehashed
+    QElapsedTimer m_clock;
+    QHash<QString, std::shared_ptr<QAtomicInteger<qint64>>> m_lastUsed;
+    qint64 m_idleTimeoutMs = 0;
+    QTimer* m_idleTimer = nullptr;
+    std::function<bool(const QString& id)> m_idleUnloadFilter;
+
+    // Critical-only startup
+    bool m_criticalOnly = false;
+    QStringList m_warmUpQueue;   // Deferred startup plugins, in load order
+    QTimer* m_warmUpTimer = nullptr;
+    int m_warmUpStarted = 0;
 };
 
 } // namespace mpf
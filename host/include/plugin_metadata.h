@@ -2,7 +2,9 @@
 
 #include <QString>
 #include <QStringList>
+#include <QHash>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QVersionNumber>
 
 namespace mpf {
@@ -56,9 +58,21 @@ public:
     QStringList qmlModules() const { return m_qmlModules; }
     QString entryQml() const { return m_entryQml; }
 
+    // Declared UI, registered from metadata while a plugin is not loaded yet
+    QStringList routes() const { return m_routes; }
+    QJsonArray menuItems() const { return m_menuItems; }  // {id, label, icon, route, group, order}
+
     // Loading hints
-    int priority() const { return m_priority; }
+    int priority() const { return m_priority; }  // Order within a dependency level, lower first
     bool loadOnStartup() const { return m_loadOnStartup; }
+    bool critical() const { return m_critical; }  // Needed before the first frame (critical-only startup)
+    bool threadSafe() const { return m_threadSafe; }  // initialize()/start() may run off the GUI thread (no QObjects there, see IPlugin)
+    bool outOfProcess() const { return m_outOfProcess; }  // Run in a separate mpf-plugin-host process (QML modules must not need C++ types)
+
+    // Lifecycle budgets in ms per phase ("initialize", "start", "stop"):
+    // -1 if not set, 0 for no limit. Over budget is slow, or failed with "fail"
+    qint64 timeoutMs(const QString& phase) const { return m_timeouts.value(phase, -1); }
+    bool failOnTimeout() const { return m_failOnTimeout; }
 
     // Raw JSON
     QJsonObject toJson() const { return m_json; }
@@ -82,9 +96,16 @@ private:
     QStringList m_provides;
     QStringList m_qmlModules;
     QString m_entryQml;
+    QStringList m_routes;
+    QJsonArray m_menuItems;
     
     int m_priority = 0;
     bool m_loadOnStartup = true;
+    bool m_critical = false;
+    bool m_threadSafe = false;
+    bool m_outOfProcess = false;
+    QHash<QString, qint64> m_timeouts;
+    bool m_failOnTimeout = false;
     
     QJsonObject m_json;
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+#include <QMutex>
+
+class QFileInfo;
+
+namespace mpf {
+
+/**
+ * @brief On-disk cache of plugin metadata
+ *
+ * Stores the metadata JSON embedded in each plugin binary, keyed by path
+ * and validated against file size, modification time and content hash.
+ * A binary is only opened when it changed since the last run; when only
+ * its timestamp moved (e.g. reinstalled unchanged) the hash confirms it
+ * and the entry is reused.
+ *
+ * metaData() may be called from several threads at once; files are read
+ * and hashed outside the lock.
+ */
+class PluginMetadataCache
+{
+public:
+    explicit PluginMetadataCache(const QString& filePath);
+
+    /**
+     * @brief Read the cache file (missing or stale files start empty)
+     */
+    void load();
+
+    /**
+     * @brief Write entries seen since load() back to the cache file
+     * @return true if the file was written
+     */
+    bool save();
+
+    /**
+     * @brief Get the embedded metadata of a plugin binary
+     * @param info Plugin file
+     * @return The "MetaData" object; empty for non-MPF libraries
+     */
+    QJsonObject metaData(const QFileInfo& info);
+
+    int hits() const;
+    int misses() const;
+
+    /**
+     * @brief Hits as a fraction of lookups (0 when nothing was looked up)
+     */
+    double hitRate() const;
+
+private:
+    struct Entry {
+        qint64 size = -1;
+        qint64 modified = 0;   // ms since epoch
+        QByteArray hash;       // SHA-1, hex
+        QJsonObject metaData;
+    };
+
+    static QByteArray fileHash(const QString& path);
+
+    QString m_filePath;
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    QSet<QString> m_used;      // Paths looked up this run; others are pruned on save
+    bool m_dirty = false;
+    int m_hits = 0;
+    int m_misses = 0;
+};
+
+} // namespace mpf
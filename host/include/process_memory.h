@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mpf {
+
+/**
+ * @brief Resident set size of the host process in bytes (-1 if unavailable)
+ */
+qint64 residentMemory();
+
+/**
+ * @brief Return freed heap memory to the OS where the allocator allows it
+ *
+ * Makes resident memory measurements after unloading reflect what was
+ * actually released.
+ */
+void trimHeap();
+
+} // namespace mpf
@@ -18,37 +18,81 @@ class IEventBus;
 /**
  * @brief Sets up QML context with services
  * 
- * Exposes services to QML as singletons accessible via App.Services.
+ * Navigation, Theme and AppMenu are context properties: the shell needs
+ * them for its first frame, so GUI mode constructs them at startup.
+ * Settings and EventBus are context properties too, but only from
+ * exposePluginServices() on, which runs before the first route page (or a
+ * plugin's entry QML) is compiled: plugin pages keep using them without an
+ * import, while the shell's first frame does not construct them.
+ *
+ * Settings, EventBus and Diagnostics are also singletons of the
+ * MPF.Services module, constructed when QML first uses them; host QML
+ * that may run before any plugin page imports them from there:
+ *
+ * @code
+ * import MPF.Services
+ * Switch { checked: Diagnostics.enabled }
+ * @endcode
+ *
+ * A singleton keeps the provider it was created with; bind to App.settings
+ * or App.eventBus to follow a higher-ranked provider taking over.
  */
 class QmlContext : public QObject
 {
     Q_OBJECT
     
     Q_PROPERTY(QString version READ version CONSTANT)
-    Q_PROPERTY(QObject* navigation READ navigation CONSTANT)
-    Q_PROPERTY(QObject* settings READ settings CONSTANT)
-    Q_PROPERTY(QObject* theme READ theme CONSTANT)
-    Q_PROPERTY(QObject* appMenu READ appMenu CONSTANT)
-    Q_PROPERTY(QObject* eventBus READ eventBus CONSTANT)
+    Q_PROPERTY(QObject* navigation READ navigation NOTIFY servicesChanged)
+    Q_PROPERTY(QObject* settings READ settings NOTIFY servicesChanged)
+    Q_PROPERTY(QObject* theme READ theme NOTIFY servicesChanged)
+    Q_PROPERTY(QObject* appMenu READ appMenu NOTIFY servicesChanged)
+    Q_PROPERTY(QObject* eventBus READ eventBus NOTIFY servicesChanged)
+    Q_PROPERTY(QObject* diagnostics READ diagnostics CONSTANT)
 
 public:
     explicit QmlContext(ServiceRegistry* registry, QObject* parent = nullptr);
     ~QmlContext() override;
-
+    
     /**
      * @brief Set up QML context on engine
      */
     void setup(QQmlApplicationEngine* engine);
-
+    
+    /**
+     * @brief Set the Settings and EventBus context properties
+     *
+     * Constructs both services. Call before plugin QML is compiled; later
+     * calls do nothing.
+     */
+    void exposePluginServices();
+    
     QString version() const;
     QObject* navigation() const;
     QObject* settings() const;
     QObject* theme() const;
     QObject* appMenu() const;
     QObject* eventBus() const;
+    QObject* diagnostics() const;
+    
+    /**
+     * @brief Check if a service is registered without constructing it
+     * @param name QML name, e.g. "Settings" or "Diagnostics"
+     */
+    Q_INVOKABLE bool hasService(const QString& name) const;
+
+signals:
+    /**
+     * @brief Emitted when a service is added, removed or switches provider
+     */
+    void servicesChanged();
 
 private:
+    void updateContextProperties();
+    void registerSingletons();
+    
     ServiceRegistryImpl* m_registry;
+    QQmlApplicationEngine* m_engine = nullptr;
+    bool m_pluginServicesExposed = false;
 };
 
 } // namespace mpf
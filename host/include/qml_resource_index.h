@@ -0,0 +1,57 @@
+#pragma once
+
+#include "mpf/interfaces/iqmlresources.h"
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+namespace mpf {
+
+/**
+ * @brief IQmlResources indexing each module on its first lookup
+ *
+ * A module is looked up by URI on the search paths (the first path with
+ * its directory and qmldir wins, matching the order plugins used to probe
+ * in) and only its own tree is scanned, stopping at subdirectories that
+ * are modules themselves. Qt's module trees and modules nobody asks for
+ * are never walked. Results, including misses, are kept for later
+ * lookups. fileUrl() prefers a compiled resource copy of the file (see
+ * QmlUrlInterceptor).
+ */
+class QmlResourceIndex : public QObject, public IQmlResources
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param searchPaths Directories to scan, highest priority first;
+     *        missing and duplicate entries are dropped
+     */
+    explicit QmlResourceIndex(const QStringList& searchPaths, QObject* parent = nullptr);
+
+    QString moduleDirectory(const QString& uri) const override;
+    QString fileUrl(const QString& uri, const QString& fileName) const override;
+    QStringList searchPaths() const override { return m_searchPaths; }
+
+    /**
+     * @brief Number of modules indexed so far
+     */
+    int moduleCount() const;
+
+private:
+    struct Module {
+        QString directory;               // Empty if no search path has the module
+        QHash<QString, QString> files;   // Path relative to the module -> URL
+    };
+
+    Module module(const QString& uri) const;
+    Module scan(const QString& uri) const;
+
+    QStringList m_searchPaths;
+    bool m_preferResources;
+    mutable QMutex m_mutex;
+    mutable QHash<QString, Module> m_modules;    // By URI
+};
+
+} // namespace mpf
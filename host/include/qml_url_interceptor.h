@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QQmlAbstractUrlInterceptor>
+#include <QStringList>
+#include <QMutex>
+#include <QSet>
+
+namespace mpf {
+
+/**
+ * @brief Redirects QML loads to the compiled copies in the resources
+ *
+ * qt_add_qml_module compiles each module's QML ahead of time and links
+ * the compiled units into the binary under qrc:/<module path>/. The same
+ * files are also copied into the build's qml directory, and loading those
+ * by file URL makes the engine parse and compile them again at startup.
+ * A QML or JavaScript file under one of the QML roots is therefore
+ * redirected to its resource counterpart when one exists.
+ *
+ * Redirection is off when MPF_QML_FROM_DISK=1, for editing QML in place
+ * without rebuilding. Every distinct file loaded is counted as served
+ * from qrc or loaded from disk. Being served from qrc does not prove the
+ * engine used a compiled unit: qmlcachegen may have skipped the file, or
+ * MPF_QML_AOT may be off.
+ */
+class QmlUrlInterceptor : public QQmlAbstractUrlInterceptor
+{
+public:
+    /**
+     * @param roots QML roots whose files may have a compiled counterpart
+     */
+    explicit QmlUrlInterceptor(const QStringList& roots);
+
+    /**
+     * @brief Whether loading from resources is preferred (MPF_QML_FROM_DISK unset)
+     */
+    static bool preferResources();
+
+    QUrl intercept(const QUrl& url, DataType type) override;
+
+    /**
+     * @brief Distinct files served from qrc so far
+     */
+    int resourceCount() const;
+
+    /**
+     * @brief Distinct files loaded from disk so far
+     */
+    QStringList diskLoaded() const;
+
+private:
+    void record(const QUrl& url);
+
+    QStringList m_roots;
+    bool m_redirect;
+
+    mutable QMutex m_mutex;          // The type loader may call from its own thread
+    QSet<QString> m_resourceUrls;
+    QSet<QString> m_diskUrls;
+};
+
+} // namespace mpf
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/ieventbus.h>
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QVariantList>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <functional>
+#include <memory>
+
+class QLocalSocket;
+class QSharedMemory;
+class QDataStream;
+
+namespace mpf {
+
+/**
+ * @brief Handles a call or notification received from the peer
+ * @return Result sent back to the caller (ignored for notifications)
+ */
+using RemoteCallHandler = std::function<QVariant(const QString& service,
+                                                 const QString& method,
+                                                 const QVariantList& args)>;
+
+/**
+ * @brief Message channel between the host and an out-of-process plugin
+ *
+ * Carries calls, replies and notifications over a local socket (a Unix
+ * domain socket, or a named pipe on Windows). Each message is a length-
+ * prefixed QDataStream frame. Payloads above inlineLimit() are copied into
+ * a shared memory segment instead and only its key travels over the
+ * socket; the receiver copies the payload out and tells the sender to
+ * release the segment.
+ *
+ * call() is synchronous and keeps dispatching incoming calls while it
+ * waits, so both sides may call each other re-entrantly (e.g. the plugin
+ * registering routes while the host waits for initialize() to return).
+ * Single-threaded: use a channel only from the thread that owns the socket.
+ */
+class RemoteChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param socket Connected socket; the channel takes ownership
+     */
+    explicit RemoteChannel(QLocalSocket* socket, QObject* parent = nullptr);
+    ~RemoteChannel() override;
+
+    /**
+     * @brief Call a method on the peer and wait for the result
+     * @param timeoutMs Give up after this long without a reply (-1 waits forever)
+     * @return Result, or an invalid QVariant on failure or timeout
+     */
+    QVariant call(const QString& service, const QString& method,
+                  const QVariantList& args = {}, int timeoutMs = 30000);
+
+    /**
+     * @brief Send a one-way message to the peer
+     */
+    void notify(const QString& service, const QString& method, const QVariantList& args = {});
+
+    void setCallHandler(RemoteCallHandler handler);
+    void setNotificationHandler(RemoteCallHandler handler);
+
+    bool isConnected() const;
+
+    /**
+     * @brief Payloads larger than this many bytes go through shared memory
+     */
+    static constexpr int inlineLimit() { return 16 * 1024; }
+
+    /**
+     * @brief Number of payloads sent through shared memory so far
+     */
+    qint64 sharedMemoryTransfers() const { return m_sharedTransfers; }
+
+signals:
+    void disconnected();
+
+private:
+    enum class MessageType : quint8 {
+        Call,
+        Reply,
+        Notify,
+        Release     // Peer is done with a shared memory payload
+    };
+
+    void send(MessageType type, quint32 id, const QByteArray& payload);
+    void sendFrame(const QByteArray& body);
+    void processIncoming();
+    void dispatch(MessageType type, quint32 id, const QByteArray& payload);
+    QByteArray readPayload(QDataStream& in);
+
+    QLocalSocket* m_socket;
+    QByteArray m_buffer;
+    quint32 m_nextId = 1;
+    QSet<quint32> m_waiting;                                    // Calls awaiting a reply
+    QHash<quint32, QVariant> m_replies;
+    QHash<QString, std::shared_ptr<QSharedMemory>> m_outgoing;  // Key -> segment awaiting Release
+    quint32 m_nextSegment = 0;
+    qint64 m_sharedTransfers = 0;
+    RemoteCallHandler m_callHandler;
+    RemoteCallHandler m_notificationHandler;
+};
+
+/**
+ * @brief Rebuild SDK structs that travel over a RemoteChannel as QVariantMap
+ */
+MenuItem menuItemFromVariant(const QVariantMap& map);
+SubscriptionOptions subscriptionOptionsFromVariant(const QVariantMap& map);
+
+} // namespace mpf
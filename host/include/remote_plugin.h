@@ -0,0 +1,102 @@
+#pragma once
+
+#include <mpf/interfaces/iplugin.h>
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QJsonObject>
+#include <QVariant>
+#include <QDeadlineTimer>
+
+class QProcess;
+class QLocalServer;
+
+namespace mpf {
+
+class RemoteChannel;
+class IEventBus;
+
+/**
+ * @brief IPlugin proxy for a plugin running in an mpf-plugin-host process
+ *
+ * initialize() spawns the plugin host next to the executable and forwards
+ * the lifecycle calls over a RemoteChannel. The plugin reaches the host's
+ * INavigation, IMenu, ISettings and IEventBus through proxies; their calls
+ * arrive here and are served by the real services on the GUI thread, with
+ * the plugin as the current plugin context. Events matching the plugin's
+ * subscriptions are pushed to the plugin host.
+ *
+ * The plugin library is still mapped into this process (without being
+ * instantiated) so its QML resources render here; QML types the plugin
+ * registers from C++ exist only in the plugin host, so its pages use only
+ * the host's context properties (see plugins/notes).
+ *
+ * The GUI thread waits for each lifecycle call at most the phase's budget
+ * (metadata "timeouts", else the watchdog default; starting the plugin
+ * host counts towards initialize()). A plugin host that overruns it is
+ * killed and the call fails.
+ */
+class RemotePlugin : public QObject, public IPlugin
+{
+    Q_OBJECT
+    Q_INTERFACES(mpf::IPlugin)
+
+public:
+    /**
+     * @param path Plugin library to load in the plugin host
+     * @param metadata Plugin metadata (the "MetaData" object)
+     */
+    RemotePlugin(const QString& path, const QJsonObject& metadata, QObject* parent = nullptr);
+    ~RemotePlugin() override;
+
+    bool initialize(ServiceRegistry* registry) override;
+    bool start() override;
+    void stop() override;
+    QJsonObject metadata() const override { return m_metadata; }
+    QString qmlModuleUri() const override { return m_qmlModuleUri; }
+    QString entryQml() const override { return m_entryQml; }
+
+    /**
+     * @brief Compare service call latency through the proxies with in-process calls
+     *
+     * Runs a plugin host without a plugin that calls ISettings::value() and
+     * publishes large IEventBus payloads (sent through shared memory)
+     * @p iterations times each, repeats the same calls in process and logs
+     * the per-call times.
+     */
+    static void runBenchmark(ServiceRegistry* registry, int iterations);
+
+private:
+    bool launch(const QStringList& arguments, QDeadlineTimer deadline);
+    void shutdown();
+    void kill();
+    int lifecycleTimeoutMs(const QString& phase) const;
+    QVariant callLifecycle(const QString& phase, int timeoutMs);
+    QVariant dispatch(const QString& service, const QString& method, const QVariantList& args);
+    QVariant dispatchNavigation(const QString& method, const QVariantList& args);
+    QVariant dispatchMenu(const QString& method, const QVariantList& args);
+    QVariant dispatchSettings(const QString& method, const QVariantList& args);
+    QVariant dispatchEventBus(const QString& method, const QVariantList& args);
+    void forwardEvent(const QString& topic, const QVariantMap& data, const QString& senderId);
+
+    struct Subscription {
+        QString pattern;
+        QString subscriberId;
+        bool receiveOwnEvents;
+    };
+
+    QString m_path;
+    QString m_id;
+    QJsonObject m_metadata;
+    ServiceRegistry* m_registry = nullptr;
+    QProcess* m_process = nullptr;
+    QLocalServer* m_server = nullptr;
+    RemoteChannel* m_channel = nullptr;
+    QString m_qmlModuleUri;
+    QString m_entryQml;
+    QHash<QString, Subscription> m_subscriptions;   // By subscription ID
+};
+
+} // namespace mpf
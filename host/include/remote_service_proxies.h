@@ -0,0 +1,170 @@
+#pragma once
+
+#include <mpf/service_registry.h>
+#include <mpf/interfaces/inavigation.h>
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/isettings.h>
+#include <mpf/interfaces/ieventbus.h>
+
+#include <QObject>
+#include <QHash>
+#include <QByteArray>
+#include <QList>
+#include <QPromise>
+#include <memory>
+
+namespace mpf {
+
+class RemoteChannel;
+
+/**
+ * @brief INavigation forwarded to the host process
+ */
+class NavigationProxy : public QObject, public INavigation
+{
+    Q_OBJECT
+
+public:
+    explicit NavigationProxy(RemoteChannel* channel, QObject* parent = nullptr);
+
+    void registerRoute(const QString& route, const QString& qmlPageUrl) override;
+    QString getPageUrl(const QString& route) const override;
+    QString currentRoute() const override;
+    void setCurrentRoute(const QString& route) override;
+
+private:
+    RemoteChannel* m_channel;
+};
+
+/**
+ * @brief IMenu forwarded to the host process
+ */
+class MenuProxy : public QObject, public IMenu
+{
+    Q_OBJECT
+
+public:
+    explicit MenuProxy(RemoteChannel* channel, QObject* parent = nullptr);
+
+    bool registerItem(const MenuItem& item) override;
+    void unregisterItem(const QString& id) override;
+    void unregisterPlugin(const QString& pluginId) override;
+    bool updateItem(const QString& id, const QVariantMap& updates) override;
+    void setBadge(const QString& id, const QString& badge) override;
+    void setEnabled(const QString& id, bool enabled) override;
+    QList<MenuItem> items() const override;
+    QVariantList itemsAsVariant() const override;
+    QVariantList itemsInGroup(const QString& group) const override;
+    QStringList groups() const override;
+    int count() const override;
+
+private:
+    RemoteChannel* m_channel;
+};
+
+/**
+ * @brief ISettings forwarded to the host process
+ */
+class SettingsProxy : public QObject, public ISettings
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsProxy(RemoteChannel* channel, QObject* parent = nullptr);
+
+    QVariant value(const QString& pluginId, const QString& key,
+                   const QVariant& defaultValue = {}) const override;
+    void setValue(const QString& pluginId, const QString& key, const QVariant& value) override;
+    void remove(const QString& pluginId, const QString& key) override;
+    bool contains(const QString& pluginId, const QString& key) const override;
+    QStringList keys(const QString& pluginId) const override;
+    void sync() override;
+
+private:
+    RemoteChannel* m_channel;
+};
+
+/**
+ * @brief IEventBus forwarded to the host process
+ *
+ * Events matching this process's subscriptions are pushed back by the
+ * host and re-emitted as eventPublished(), like EventBusService does.
+ */
+class EventBusProxy : public QObject, public IEventBus
+{
+    Q_OBJECT
+
+public:
+    explicit EventBusProxy(RemoteChannel* channel, QObject* parent = nullptr);
+
+    int publish(const QString& topic, const QVariantMap& data, const QString& senderId = {}) override;
+    int publishSync(const QString& topic, const QVariantMap& data, const QString& senderId = {}) override;
+    QString subscribe(const QString& pattern, const QString& subscriberId,
+                      const SubscriptionOptions& options = {}) override;
+    bool unsubscribe(const QString& subscriptionId) override;
+    void unsubscribeAll(const QString& subscriberId) override;
+    int subscriberCount(const QString& topic) const override;
+    QStringList activeTopics() const override;
+    TopicStats topicStats(const QString& topic) const override;
+    QStringList subscriptionsFor(const QString& subscriberId) const override;
+    bool matchesTopic(const QString& topic, const QString& pattern) const override;
+
+    /**
+     * @brief Deliver an event pushed by the host
+     */
+    void deliver(const QString& topic, const QVariantMap& data, const QString& senderId);
+
+signals:
+    void eventPublished(const QString& topic, const QVariantMap& data, const QString& senderId);
+
+private:
+    RemoteChannel* m_channel;
+};
+
+/**
+ * @brief Service registry of the plugin host process
+ *
+ * Serves proxies for the host's core services. Services the plugin
+ * registers itself stay local to this process.
+ */
+class RemoteServiceRegistry : public ServiceRegistry
+{
+public:
+    explicit RemoteServiceRegistry(RemoteChannel* channel);
+    ~RemoteServiceRegistry() override;
+
+    EventBusProxy* eventBus() const { return m_eventBus; }
+
+    quint64 generation() const override { return m_generation; }
+
+protected:
+    QObject* getService(const char* typeName, int minVersion) override;
+    QList<QObject*> getServices(const char* typeName, int minVersion) override;
+    bool addService(const char* typeName, QObject* instance, int version,
+                    const QString& providerId) override;
+    bool addRankedService(const char* typeName, QObject* instance, int version,
+                          const QString& providerId, int rank) override;
+    bool hasService(const char* typeName, int minVersion) const override;
+    QFuture<QObject*> serviceAvailable(const char* typeName, int minVersion) override;
+
+private:
+    struct Entry {
+        QObject* instance;
+        int version;
+        int rank;
+    };
+
+    struct Pending {
+        QByteArray typeName;
+        int minVersion;
+        std::shared_ptr<QPromise<QObject*>> promise;
+    };
+
+    QHash<QByteArray, QList<Entry>> m_services;   // Ordered by rank, highest first
+    QList<Pending> m_pending;
+    QList<QObject*> m_proxies;   // Owned
+    EventBusProxy* m_eventBus = nullptr;
+    quint64 m_generation = 0;
+};
+
+} // namespace mpf
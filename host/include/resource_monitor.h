@@ -0,0 +1,181 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QVariantList>
+
+namespace mpf {
+
+/**
+ * @brief What a plugin-attributed scope is doing
+ */
+enum class ResourceCategory
+{
+    Lifecycle,  ///< initialize()/start()/stop()
+    Service,    ///< Service factories and host service calls made by the plugin
+    Event,      ///< Running event handlers (see ResourceMonitor::eventHandlersId())
+    Count
+};
+
+/**
+ * @brief Heap traffic attributed to one plugin
+ */
+struct HeapCounters
+{
+    QAtomicInteger<qint64> allocated;
+    QAtomicInteger<qint64> freed;
+};
+
+/**
+ * @brief Resource usage accumulated for one plugin
+ */
+struct PluginResources
+{
+    QAtomicInteger<qint64> cpuNs[int(ResourceCategory::Count)];
+    QAtomicInteger<qint64> calls[int(ResourceCategory::Count)];
+    HeapCounters heap;
+    QAtomicInteger<qint64> published;       ///< Events published
+    QAtomicInteger<qint64> delivered;       ///< Events delivered to its subscriptions
+    QAtomicInteger<qint64> subscriptions;   ///< Active subscriptions
+};
+
+/**
+ * @brief Per-plugin resource accounting (host service)
+ *
+ * Attributes thread CPU time, heap traffic and event bus volume to the
+ * plugin on whose behalf the host is running, so that a slow or large
+ * host can be traced back to a plugin. CPU time is exclusive: a nested
+ * scope for another plugin pauses the enclosing one.
+ *
+ * Heap accounting needs the host built with MPF_HEAP_ACCOUNTING=ON, which
+ * replaces the global operator new/delete. Frees are attributed to the
+ * plugin active when they happen, so the net figure is growth during the
+ * plugin's scopes rather than an exact ownership count. Allocations made
+ * through a plugin's own C runtime (e.g. a separate MSVC CRT) are not seen.
+ *
+ * Disabled by default (MPF_RESOURCE_MONITOR=1 enables it at startup); a
+ * disabled scope costs one relaxed atomic load.
+ */
+class ResourceMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool heapAccounting READ heapAccounting CONSTANT)
+
+public:
+    explicit ResourceMonitor(QObject* parent = nullptr);
+    ~ResourceMonitor() override;
+
+    static bool isEnabled() { return s_enabled.loadRelaxed() != 0; }
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Whether the host was built with heap accounting hooks
+     */
+    static bool heapAccounting();
+
+    /**
+     * @brief Counters of a plugin, created on first use (thread-safe)
+     */
+    static PluginResources* resources(const QString& pluginId);
+
+    /**
+     * @brief CPU time consumed by the calling thread in nanoseconds
+     */
+    static qint64 threadCpuTime();
+
+    /**
+     * @brief Row charged with in-process event handler time
+     *
+     * The event bus runs every handler in one signal emission and cannot
+     * tell which plugin a handler belongs to, so their time is reported
+     * under this ID rather than charged to the publisher. Forwarding an
+     * event to an out-of-process subscriber is charged to that plugin.
+     */
+    static QString eventHandlersId() { return QStringLiteral("(event handlers)"); }
+
+    // Event bus volume
+    static void recordPublished(const QString& pluginId);
+    static void recordDelivered(const QString& pluginId);
+    static void recordSubscriptions(const QString& pluginId, int delta);
+
+    /**
+     * @brief Snapshot of all plugins, highest CPU time first
+     *
+     * Each entry is a map with id, lifecycleMs, serviceMs, eventMs, cpuMs,
+     * calls, heapAllocated, heapFreed, heapNet, published, delivered and
+     * subscriptions.
+     */
+    Q_INVOKABLE QVariantList snapshot() const;
+
+    /**
+     * @brief Discard the accumulated figures (active subscriptions are kept)
+     */
+    Q_INVOKABLE void reset();
+
+    /**
+     * @brief Format the snapshot as a table for logging
+     */
+    QString report() const;
+
+    /**
+     * @brief Heap counters of the scope active on this thread
+     * @note Used by the allocation hooks only
+     */
+    static thread_local HeapCounters* s_heapCounters;
+
+signals:
+    void enabledChanged();
+
+private:
+    static QAtomicInt s_enabled;
+};
+
+/**
+ * @brief RAII scope attributing the current thread's work to a plugin
+ */
+class ResourceScope
+{
+public:
+    ResourceScope(const QString& pluginId, ResourceCategory category)
+    {
+        if (ResourceMonitor::isEnabled() && !pluginId.isEmpty()) {
+            begin(pluginId, category);
+        }
+    }
+
+    /**
+     * @brief Attribute to the plugin in PluginContext::current(), if any
+     */
+    explicit ResourceScope(ResourceCategory category)
+    {
+        if (ResourceMonitor::isEnabled()) {
+            beginCurrent(category);
+        }
+    }
+
+    ~ResourceScope()
+    {
+        if (m_resources) {
+            end();
+        }
+    }
+
+    ResourceScope(const ResourceScope&) = delete;
+    ResourceScope& operator=(const ResourceScope&) = delete;
+
+private:
+    void begin(const QString& pluginId, ResourceCategory category);
+    void beginCurrent(ResourceCategory category);
+    void end();
+
+    PluginResources* m_resources = nullptr;
+    ResourceCategory m_category = ResourceCategory::Lifecycle;
+    qint64 m_startCpuNs = 0;
+    ResourceScope* m_parent = nullptr;
+    HeapCounters* m_parentHeap = nullptr;
+};
+
+} // namespace mpf
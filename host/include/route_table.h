@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QVariantMap>
+#include <memory>
+#include <unordered_map>
+
+namespace mpf {
+
+/**
+ * @brief Routes of NavigationService, indexed for lookup
+ *
+ * A route pattern is a '/' separated path whose segments are either
+ * literal or a parameter, written ":name" (e.g. "orders/:id"). Literal
+ * routes live in a hash; patterns with parameters in a segment trie, so a
+ * lookup costs one hash probe plus O(segments). Literal segments take
+ * precedence over parameters. When several plugins register the same
+ * pattern the first registration wins until its plugin is removed.
+ *
+ * A query string ("orders/42?tab=items") is not part of the match; its
+ * items are returned as parameters along with the path parameters.
+ *
+ * Not thread-safe; NavigationService serializes access.
+ */
+class RouteTable
+{
+public:
+    struct Route {
+        QString pattern;
+        QString pageUrl;
+        QString pluginId;        // Plugin that registered the route
+        QStringList paramNames;  // In segment order
+    };
+
+    struct Match {
+        const Route* route = nullptr;
+        QVariantMap params;
+    };
+
+    RouteTable();
+    ~RouteTable();
+
+    /**
+     * @brief Whether a pattern has parameter segments
+     */
+    static bool isPattern(const QString& pattern);
+
+    /**
+     * @brief Whether a route matches a pattern, without a table
+     */
+    static bool matches(const QString& pattern, const QString& route);
+
+    void insert(const QString& pattern, const QString& pageUrl, const QString& pluginId);
+
+    /**
+     * @brief Remove the routes a plugin registered
+     * @return Number of routes removed
+     */
+    int removePlugin(const QString& pluginId);
+
+    /**
+     * @brief Find the route serving a concrete route
+     * @return Match with route == nullptr if none
+     */
+    Match match(const QString& route) const;
+
+    int size() const { return m_size; }
+
+    RouteTable(const RouteTable&) = delete;
+    RouteTable& operator=(const RouteTable&) = delete;
+
+private:
+    struct Node {
+        std::unordered_map<QString, std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;   // Child for any ":name" segment
+        QList<Route> routes;           // Patterns ending here, first registered wins
+    };
+
+    static const Node* walk(const Node* node, const QStringList& segments, int index,
+                            QStringList& values);
+    static int removeFrom(Node* node, const QString& pluginId);
+
+    QHash<QString, QList<Route>> m_literal;
+    std::unique_ptr<Node> m_root;
+    int m_size = 0;
+};
+
+} // namespace mpf
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QString>
+#include <QJsonObject>
+#include <QHash>
+#include <functional>
+
+class QObject;
+
+namespace mpf {
+
+class ServiceRegistryImpl;
+class PluginManager;
+
+/**
+ * @brief Runs a JSON script of service calls against a running host
+ *
+ * Used with the headless host for batch processing and load tests
+ * (mpf-host --headless --script <file>). The script is a JSON array of
+ * steps, or an object with a "steps" array. Every step has an "op" and
+ * an optional "count" (default 1); each step reports its total time and
+ * the time per operation.
+ *
+ * @code
+ * [
+ *   {"op": "publish", "topic": "orders/created", "data": {"id": "1"}, "count": 10000},
+ *   {"op": "invoke", "target": "orders::OrdersService", "method": "createOrder",
+ *    "args": [{"customerName": "Load test"}], "count": 1000},
+ *   {"op": "lookup", "service": "IEventBus", "count": 1000000, "threads": 8},
+ *   {"op": "log", "count": 100000, "sink": "null"},
+ *   {"op": "wait", "ms": 100},
+ *   {"op": "wait", "topic": "orders/*", "ms": 1000},
+ *   {"op": "state", "plugin": "com.yourco.orders", "expect": "started"}
+ * ]
+ * @endcode
+ *
+ * - publish: IEventBus::publish (or publishSync with "sync": true)
+ * - invoke: calls an invokable method on a registered service or on a
+ *   QObject owned by a plugin, found by class name
+ * - lookup: compares get<T>() with a cached ServiceRef<T> for an SDK interface;
+ *   with "threads", also runs get<T>() on 1, 2, 4... up to that many threads
+ *   at once and reports the throughput of each
+ * - log: compares the caller's time per message of a synchronous and an
+ *   async Logger, writing to the console or ("sink": "null") nowhere
+ * - wait: runs the event loop, e.g. to let asynchronous deliveries finish;
+ *   with "topic", until a matching event is published, failing if none is
+ *   within "ms"
+ * - state: fails unless the plugin's lifecycle state is "expect" (unloaded,
+ *   loaded, initialized, started or error), e.g. to check that a plugin
+ *   whose required plugin started was not skipped; with "outOfProcess",
+ *   also unless the plugin runs (true) or does not run out of process
+ */
+class ScriptDriver
+{
+public:
+    ScriptDriver(ServiceRegistryImpl* registry, PluginManager* pluginManager);
+
+    /**
+     * @brief Run a script file
+     * @param path Script file
+     * @param resultPath If set, step timings are also written there as JSON
+     * @return true if every step succeeded
+     */
+    bool run(const QString& path, const QString& resultPath = {});
+
+private:
+    using Step = std::function<bool(const QJsonObject& step, int count)>;
+
+    bool publish(const QJsonObject& step, int count);
+    bool invoke(const QJsonObject& step, int count);
+    bool lookup(const QJsonObject& step, int count);
+    bool log(const QJsonObject& step, int count);
+    bool wait(const QJsonObject& step, int count);
+    bool state(const QJsonObject& step, int count);
+
+    QObject* findTarget(const QString& className, QString* pluginId) const;
+
+    ServiceRegistryImpl* m_registry;
+    PluginManager* m_pluginManager;
+    QHash<QString, Step> m_ops;
+};
+
+} // namespace mpf
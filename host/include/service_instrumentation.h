@@ -0,0 +1,97 @@
+#pragma once
+
+#include "resource_monitor.h"
+
+#include <QString>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+class QObject;
+
+namespace mpf {
+
+/**
+ * @brief Per-method call statistics for host services
+ *
+ * Collects call counts, cumulative and percentile latency, and caller
+ * threads for every instrumented service method or property read.
+ * Disabled by default; when disabled a call scope costs one relaxed
+ * atomic load. Enabled through ServiceRegistryImpl.
+ */
+class ServiceInstrumentation
+{
+public:
+    static bool isEnabled() { return s_enabled.loadRelaxed() != 0; }
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Associate a service object with its interface name for reports
+     *
+     * Statistics are grouped by this name, so calls on a provider that
+     * replaced an unloaded one add to the same rows. The association is
+     * dropped when the object is destroyed.
+     */
+    static void setServiceName(const QObject* service, const QString& interfaceName);
+
+    /**
+     * @brief Record one completed call
+     * @param service Service object the call was made on
+     * @param member Method or property name (string literal)
+     * @param elapsedNs Call duration
+     */
+    static void record(const QObject* service, const char* member, qint64 elapsedNs);
+
+    /**
+     * @brief Format collected statistics, most expensive methods first
+     */
+    static QString report();
+
+    /**
+     * @brief Discard collected statistics
+     */
+    static void reset();
+
+private:
+    static QAtomicInt s_enabled;
+};
+
+/**
+ * @brief RAII timer recording one service call
+ */
+class ServiceCallScope
+{
+public:
+    ServiceCallScope(const QObject* service, const char* member)
+        : m_service(service)
+        , m_member(member)
+        , m_active(ServiceInstrumentation::isEnabled())
+    {
+        if (m_active) {
+            m_timer.start();
+        }
+    }
+
+    ~ServiceCallScope()
+    {
+        if (m_active) {
+            ServiceInstrumentation::record(m_service, m_member, m_timer.nsecsElapsed());
+        }
+    }
+
+    ServiceCallScope(const ServiceCallScope&) = delete;
+    ServiceCallScope& operator=(const ServiceCallScope&) = delete;
+
+private:
+    const QObject* m_service;
+    const char* m_member;
+    bool m_active;
+    QElapsedTimer m_timer;
+};
+
+} // namespace mpf
+
+// Instrument the enclosing service method (member must be a string literal)
+// and charge its CPU time to the calling plugin, if any
+#define MPF_SERVICE_CALL(member) \
+    mpf::ServiceCallScope _mpfServiceCall(this, member); \
+    mpf::ResourceScope _mpfServiceResources(mpf::ResourceCategory::Service)
@@ -1,15 +1,41 @@
 #pragma once
 
 #include <mpf/service_registry.h>
+#include "plugin_context.h"
 #include <QObject>
 #include <QString>
 #include <QHash>
 #include <QMutex>
+#include <QList>
+#include <QByteArray>
+#include <QAtomicPointer>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QPromise>
 #include <typeinfo>
 #include <memory>
+#include <optional>
+#include <vector>
+#include <functional>
 
 namespace mpf {
 
+struct ServiceFactoryState;
+
+/**
+ * @brief Factory used to construct a service on first access
+ */
+using ServiceFactory = std::function<QObject*()>;
+
+/**
+ * @brief Called when a lookup finds no provider
+ *
+ * Returns true if it made the service available (e.g. by loading a
+ * deferred plugin), in which case the lookup is retried once.
+ */
+using ServiceMissHandler = std::function<bool(const char* typeName)>;
+
 /**
  * @brief Service registration entry
  */
@@ -19,6 +45,20 @@ struct ServiceEntry
     int version;
     QObject* instance;
     QString providerId;  // Plugin that provides this service
+    int rank = 0;        // Higher rank wins when several providers exist
+    std::shared_ptr<ServiceFactoryState> factory;  // Set for lazily constructed services
+    std::shared_ptr<QAtomicInteger<qint64>> lastReported;  // Last usage report (ms), plugin providers only
+};
+
+/**
+ * @brief Construction timing of a lazily registered service
+ */
+struct ServiceFactoryTiming
+{
+    QString interfaceName;
+    QString providerId;
+    bool constructed = false;
+    qint64 elapsedNs = 0;       ///< Time spent inside the factory (0 if not constructed)
 };
 
 /**
@@ -26,6 +66,19 @@ struct ServiceEntry
  * 
  * Inherits from SDK's abstract ServiceRegistry for plugin compatibility
  * and QObject for Qt signals.
+ *
+ * Each interface may have several providers, kept ordered by rank; lookups
+ * return the highest-ranked provider. Changing the ranking (adding a higher
+ * ranked provider, removing the current one or setRank()) emits
+ * serviceProviderChanged() and bumps generation(), which ServiceRef caches
+ * check to re-resolve.
+ *
+ * Lookups are lock-free: every registration change builds a new immutable
+ * service table and publishes it atomically, so readers only perform an
+ * acquire load. Writers serialize on a mutex. A superseded table is freed
+ * by a later registration change once no lookup that may still read it is
+ * in progress (epoch-based reclamation: each lookup marks its thread's own
+ * slot, so lookups on different threads do not contend).
  */
 class ServiceRegistryImpl : public QObject, public ServiceRegistry
 {
@@ -34,26 +87,57 @@ class ServiceRegistryImpl : public QObject, public ServiceRegistry
 public:
     explicit ServiceRegistryImpl(QObject* parent = nullptr);
     ~ServiceRegistryImpl() override;
-
+    
     /**
      * @brief Register a service implementation
      * @tparam T Interface type
      * @param instance Service instance (must outlive registry)
      * @param version API version
      * @param providerId ID of plugin providing this service
+     * @param rank Provider rank; the highest-ranked provider is returned by get<T>()
      * @return true if registration succeeded
      */
     template<typename T>
-    bool add(T* instance, int version = 1, const QString& providerId = {})
+    bool add(T* instance, int version = 1, const QString& providerId = {}, int rank = 0)
     {
         // Service instance must be convertible to QObject*
         QObject* obj = dynamic_cast<QObject*>(instance);
         if (!obj) {
             obj = reinterpret_cast<QObject*>(instance);
         }
-        return addService(typeid(T).name(), obj, version, providerId);
+        return addRankedService(typeid(T).name(), obj, version, providerId, rank);
     }
-
+    
+    /**
+     * @brief Register a service that is constructed on first access
+     *
+     * The factory runs exactly once, on the thread of the first get<T>()
+     * that needs the instance; concurrent callers block until it finishes.
+     * The created object is moved to the registry's thread and owned by the
+     * registry. A factory must not (directly or indirectly) request its own
+     * interface.
+     *
+     * @tparam T Interface type
+     * @param factory Callable returning a new instance convertible to T*
+     * @param version API version
+     * @param providerId ID of plugin providing this service
+     * @param rank Provider rank
+     * @return true if registration succeeded
+     */
+    template<typename T, typename Factory>
+    bool addFactory(Factory factory, int version = 1, const QString& providerId = {}, int rank = 0)
+    {
+        ServiceFactory create = [factory = std::move(factory)]() -> QObject* {
+            T* instance = factory();
+            QObject* obj = dynamic_cast<QObject*>(instance);
+            if (!obj) {
+                obj = reinterpret_cast<QObject*>(instance);
+            }
+            return obj;
+        };
+        return addServiceFactory(typeid(T).name(), std::move(create), version, providerId, rank);
+    }
+    
     /**
      * @brief Get a service implementation
      * @tparam T Interface type
@@ -66,7 +150,7 @@ public:
         QObject* obj = getService(typeid(T).name(), minVersion);
         return dynamic_cast<T*>(obj);
     }
-
+    
     /**
      * @brief Check if a service is available
      * @tparam T Interface type
@@ -78,7 +162,7 @@ public:
     {
         return hasService(typeid(T).name(), minVersion);
     }
-
+    
     /**
      * @brief Get service version
      * @tparam T Interface type
@@ -89,9 +173,9 @@ public:
     {
         return serviceVersion(typeid(T).name());
     }
-
+    
     /**
-     * @brief Remove a service
+     * @brief Remove a service (all of its providers)
      * @tparam T Interface type
      */
     template<typename T>
@@ -99,20 +183,108 @@ public:
     {
         removeService(typeid(T).name());
     }
+    
+    /**
+     * @brief Remove one provider of a service
+     * @tparam T Interface type
+     * @param providerId Provider to remove
+     * @return true if the provider was registered
+     */
+    template<typename T>
+    bool removeProvider(const QString& providerId)
+    {
+        return removeServiceProvider(QByteArray(typeid(T).name()), providerId);
+    }
+    
+    /**
+     * @brief Change the rank of a provider, possibly switching the active one
+     * @tparam T Interface type
+     * @param providerId Provider to re-rank
+     * @param rank New rank
+     * @return true if the provider was registered
+     */
+    template<typename T>
+    bool setRank(const QString& providerId, int rank)
+    {
+        return setProviderRank(QByteArray(typeid(T).name()), providerId, rank);
+    }
+    
+    /**
+     * @brief Get all providers of a service
+     * @tparam T Interface type
+     * @return Entries ordered by rank, highest first
+     */
+    template<typename T>
+    QList<ServiceEntry> providers() const
+    {
+        return providers(QString::fromLatin1(typeid(T).name()));
+    }
+    
+    /**
+     * @brief Get all providers of a service by interface name
+     */
+    QList<ServiceEntry> providers(const QString& interfaceName) const;
+    
+    /**
+     * @brief Remove every service registered by a provider
+     * @param providerId Provider (usually a plugin ID)
+     * @return Number of registrations removed
+     */
+    int removeProviders(const QString& providerId);
+    
+    quint64 generation() const override;
+
+    /**
+     * @brief Install the handler consulted when get() finds no provider
+     * @note Set once during startup, before plugins run
+     */
+    void setMissHandler(ServiceMissHandler handler);
 
+    /**
+     * @brief Install the handler told about lookups served by a plugin
+     *
+     * Called at most once per usageReportInterval() for each provider, so
+     * lookups do not pay for it; lookups served by the host are not reported.
+     *
+     * @note Set once during startup, before plugins run
+     */
+    void setUsageHandler(PluginUsageHandler handler);
+    static constexpr qint64 usageReportInterval() { return 1000; }
+    
     /**
      * @brief Get all registered service names
      * @return List of service type names
      */
     QStringList registeredServices() const;
-
+    
     /**
-     * @brief Get service entry details
+     * @brief Get details of the highest-ranked provider
      * @param interfaceName Type name of interface
-     * @return Service entry or nullptr if not found
+     * @return Copy of the service entry, or nothing if not found
      */
-    const ServiceEntry* entry(const QString& interfaceName) const;
-
+    std::optional<ServiceEntry> entry(const QString& interfaceName) const;
+    
+    /**
+     * @brief Get construction timings of all factory-registered services
+     * @return One entry per factory, in registration order
+     */
+    QList<ServiceFactoryTiming> factoryTimings() const;
+    
+    /**
+     * @brief Enable per-method call instrumentation of host services
+     *
+     * Records call counts, latency percentiles and caller threads for every
+     * instrumented service method (see MPF_SERVICE_CALL). Negligible cost
+     * while disabled.
+     */
+    void setInstrumentationEnabled(bool enabled);
+    bool isInstrumentationEnabled() const;
+    
+    /**
+     * @brief Format the collected service call statistics
+     */
+    QString instrumentationReport() const;
+    
     /**
      * @brief Get service as QObject* directly (for QML exposure)
      *
@@ -129,23 +301,74 @@ public:
         return getService(typeid(T).name(), minVersion);
     }
 
+    /**
+     * @brief Get a service by interface name, as listed by registeredServices()
+     * @param interfaceName Type name of interface
+     * @param minVersion Minimum required version
+     * @return QObject* or nullptr if not found
+     */
+    QObject* object(const QString& interfaceName, int minVersion = 0);
+
 signals:
     void serviceAdded(const QString& interfaceName);
     void serviceRemoved(const QString& interfaceName);
+    
+    /**
+     * @brief Emitted when the provider returned by get() changes
+     */
+    void serviceProviderChanged(const QString& interfaceName);
 
 protected:
     // ServiceRegistry interface implementation
     QObject* getService(const char* typeName, int minVersion) override;
+    QList<QObject*> getServices(const char* typeName, int minVersion) override;
     bool addService(const char* typeName, QObject* instance, 
                     int version, const QString& providerId) override;
+    bool addRankedService(const char* typeName, QObject* instance,
+                          int version, const QString& providerId, int rank) override;
     bool hasService(const char* typeName, int minVersion) const override;
+    QFuture<QObject*> serviceAvailable(const char* typeName, int minVersion) override;
 
 private:
+    using ProviderList = QList<ServiceEntry>;                 // Ordered by rank, highest first
+    using ServiceTable = QHash<QByteArray, ProviderList>;
+    
+    struct PendingService {
+        QByteArray typeName;
+        int minVersion;
+        std::shared_ptr<QPromise<QObject*>> promise;
+    };
+    
+    struct RetiredTable {
+        std::unique_ptr<const ServiceTable> table;
+        quint64 epoch;                  // Reclamation epoch it was superseded in
+    };
+    
+    const ServiceTable* table() const { return m_table.loadAcquire(); }
+    void publish(ServiceTable table);  // Must be called with m_mutex held
+    void reclaimRetiredTables();       // Must be called with m_mutex held
+    
+    bool insertProvider(const char* typeName, ServiceEntry entry);
+    bool addServiceFactory(const char* typeName, ServiceFactory factory,
+                           int version, const QString& providerId, int rank);
+    QObject* resolve(const ServiceEntry& entry);
+    QObject* construct(const QString& name, const std::shared_ptr<ServiceFactoryState>& state);
     int serviceVersion(const char* typeName) const;
     void removeService(const char* typeName);
-
-    mutable QMutex m_mutex;
-    QHash<QString, ServiceEntry> m_services;
+    bool removeServiceProvider(const QByteArray& typeName, const QString& providerId);
+    bool setProviderRank(const QByteArray& typeName, const QString& providerId, int rank);
+    void resolvePending(const char* typeName, int version);
+    
+    mutable QMutex m_mutex;                                   // Serializes writers only
+    QAtomicPointer<const ServiceTable> m_table;
+    QAtomicInteger<quint64> m_generation = 0;
+    std::vector<RetiredTable> m_retiredTables;
+    QList<std::shared_ptr<ServiceFactoryState>> m_factories;  // Registration order
+    QList<QObject*> m_constructed;                            // Owned, construction order
+    QList<PendingService> m_pending;                          // whenAvailable() waiters
+    ServiceMissHandler m_missHandler;
+    PluginUsageHandler m_usageHandler;
+    QElapsedTimer m_clock;                                    // Time base of usage reports
 };
 
 } // namespace mpf
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QString>
+#include <QAtomicInt>
+
+namespace mpf {
+
+/**
+ * @brief Records nested startup spans and exports them as a Chrome trace
+ *
+ * Enabled by setting MPF_STARTUP_TRACE to an output file path. Spans may
+ * be recorded from any thread; each thread gets its own track. Open the
+ * written file in chrome://tracing or https://ui.perfetto.dev.
+ * Disabled by default; a disabled scope costs one relaxed atomic load
+ * (MPF_PROFILE_SCOPE builds the span name only while recording).
+ * Recording stops once the final trace is written.
+ */
+class StartupProfiler
+{
+public:
+    /**
+     * @brief Enable recording if MPF_STARTUP_TRACE is set
+     *
+     * Timestamps are relative to this call.
+     */
+    static void enableFromEnvironment();
+
+    static bool isEnabled() { return s_enabled.loadRelaxed() != 0; }
+
+    /**
+     * @brief Record one completed span
+     * @param name Span name
+     * @param category Trace category, e.g. "app", "plugin", "qml"
+     * @param startNs Start time from now()
+     * @param endNs End time from now()
+     */
+    static void record(const QString& name, const char* category, qint64 startNs, qint64 endNs);
+
+    /**
+     * @brief Nanoseconds since recording was enabled
+     */
+    static qint64 now();
+
+    /**
+     * @brief Write recorded spans to the MPF_STARTUP_TRACE file
+     *
+     * Unless @p keepRecording, this is the final trace: recording stops and
+     * the spans are released, since later ones (reloads, plugins loaded on
+     * first use) would never be written.
+     *
+     * @return true if the trace was written
+     */
+    static bool write(bool keepRecording = false);
+
+private:
+    static QAtomicInt s_enabled;
+};
+
+/**
+ * @brief RAII span recorded by StartupProfiler
+ *
+ * Takes the span name as a callable returning it, so that names built
+ * from strings cost nothing while the profiler is disabled.
+ */
+class ProfileScope
+{
+public:
+    template<typename NameFn>
+    ProfileScope(NameFn&& name, const char* category)
+        : m_active(StartupProfiler::isEnabled())
+    {
+        if (m_active) {
+            m_name = name();
+            m_category = category;
+            m_startNs = StartupProfiler::now();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_active) {
+            StartupProfiler::record(m_name, m_category, m_startNs, StartupProfiler::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool m_active;
+    QString m_name;
+    const char* m_category = nullptr;
+    qint64 m_startNs = 0;
+};
+
+} // namespace mpf
+
+#define MPF_PROFILE_CONCAT_INNER(a, b) a##b
+#define MPF_PROFILE_CONCAT(a, b) MPF_PROFILE_CONCAT_INNER(a, b)
+
+#define MPF_PROFILE_EXPAND(x) x
+#define MPF_PROFILE_SELECT(_1, _2, macro, ...) macro
+#define MPF_PROFILE_SCOPE_1(name) MPF_PROFILE_SCOPE_2(name, "app")
+#define MPF_PROFILE_SCOPE_2(name, category) \
+    mpf::ProfileScope MPF_PROFILE_CONCAT(_mpfProfileScope, __LINE__)( \
+        [&]() -> QString { return name; }, category)
+
+// Record the enclosing scope as a startup span: MPF_PROFILE_SCOPE(name[, category]).
+// The name expression is only evaluated while recording.
+#define MPF_PROFILE_SCOPE(...) \
+    MPF_PROFILE_EXPAND(MPF_PROFILE_SELECT(__VA_ARGS__, MPF_PROFILE_SCOPE_2, MPF_PROFILE_SCOPE_1)(__VA_ARGS__))
@@ -0,0 +1,277 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import MPF.Services
+
+// Per-plugin resource usage from the Diagnostics (ResourceMonitor) service
+// and navigation percentiles from NavigationTimings
+Page {
+    id: page
+
+    property string pageTitle: qsTr("Diagnostics")
+    property string route: ""
+    property var rows: []
+    property var navigationRows: []
+
+    background: Rectangle {
+        color: Theme ? Theme.backgroundColor : "#FFFFFF"
+    }
+
+    function refresh() {
+        rows = Diagnostics ? Diagnostics.snapshot() : []
+    }
+
+    function refreshNavigation() {
+        navigationRows = NavigationTimings ? NavigationTimings.summary() : []
+    }
+
+    function formatBytes(bytes) {
+        if (Math.abs(bytes) >= 1048576)
+            return (bytes / 1048576).toFixed(1) + " MiB"
+        return (bytes / 1024).toFixed(1) + " KiB"
+    }
+
+    Component.onCompleted: {
+        refresh()
+        refreshNavigation()
+    }
+
+    Connections {
+        target: NavigationTimings
+        enabled: page.visible
+
+        function onRecorded() {
+            page.refreshNavigation()
+        }
+    }
+
+    // The page is cached while hidden; catch up when it is shown again
+    onVisibleChanged: {
+        if (visible)
+            refreshNavigation()
+    }
+
+    Timer {
+        interval: 1000
+        repeat: true
+        running: page.visible && Diagnostics && Diagnostics.enabled
+        onTriggered: page.refresh()
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 24
+        spacing: 16
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 12
+
+            Switch {
+                text: qsTr("Record resource usage")
+                checked: Diagnostics ? Diagnostics.enabled : false
+                enabled: Diagnostics !== null
+                onToggled: Diagnostics.enabled = checked
+            }
+
+            Item {
+                Layout.fillWidth: true
+            }
+
+            Button {
+                text: qsTr("Reset")
+                enabled: Diagnostics !== null
+                onClicked: {
+                    Diagnostics.reset()
+                    page.refresh()
+                }
+            }
+        }
+
+        Label {
+            visible: Diagnostics && !Diagnostics.heapAccounting
+            text: qsTr("Heap figures need a host built with MPF_HEAP_ACCOUNTING=ON.")
+            font.pixelSize: 12
+            color: Theme ? Theme.textSecondaryColor : "#757575"
+        }
+
+        // Column headers
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 8
+
+            Repeater {
+                model: [qsTr("Plugin"), qsTr("CPU (ms)"), qsTr("Lifecycle"), qsTr("Services"),
+                    qsTr("Events"), qsTr("Heap net"), qsTr("Published"), qsTr("Delivered"),
+                    qsTr("Subscriptions")]
+
+                Label {
+                    Layout.fillWidth: true
+                    Layout.preferredWidth: index === 0 ? 3 : 1
+                    text: modelData
+                    font.pixelSize: 12
+                    font.bold: true
+                    color: Theme ? Theme.textSecondaryColor : "#757575"
+                }
+            }
+        }
+
+        ListView {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            Layout.preferredHeight: 2
+            clip: true
+            model: page.rows
+
+            delegate: Rectangle {
+                required property var modelData
+                required property int index
+
+                width: ListView.view.width
+                height: 32
+                color: index % 2 ? "transparent" : (Theme ? Theme.surfaceColor : "#F5F5F5")
+
+                RowLayout {
+                    anchors.fill: parent
+                    anchors.leftMargin: 4
+                    anchors.rightMargin: 4
+                    spacing: 8
+
+                    Repeater {
+                        model: [modelData.id,
+                            modelData.cpuMs.toFixed(2),
+                            modelData.lifecycleMs.toFixed(2),
+                            modelData.serviceMs.toFixed(2),
+                            modelData.eventMs.toFixed(2),
+                            Diagnostics && Diagnostics.heapAccounting ? page.formatBytes(modelData.heapNet) : "-",
+                            modelData.published,
+                            modelData.delivered,
+                            modelData.subscriptions]
+
+                        Label {
+                            Layout.fillWidth: true
+                            Layout.preferredWidth: index === 0 ? 3 : 1
+                            text: modelData
+                            font.pixelSize: 13
+                            elide: Text.ElideRight
+                            color: Theme ? Theme.textColor : "#212121"
+                        }
+                    }
+                }
+            }
+
+            Label {
+                anchors.centerIn: parent
+                visible: page.rows.length === 0
+                text: Diagnostics && Diagnostics.enabled
+                      ? qsTr("No plugin activity recorded yet.")
+                      : qsTr("Enable recording to attribute CPU time, heap and events to plugins.")
+                color: Theme ? Theme.textSecondaryColor : "#757575"
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 12
+
+            Label {
+                text: qsTr("Navigation (ms, first frame)")
+                font.pixelSize: 14
+                font.bold: true
+                color: Theme ? Theme.textColor : "#212121"
+            }
+
+            Label {
+                text: NavigationTimings
+                      ? qsTr("%1 of the last %2 navigations").arg(NavigationTimings.count).arg(NavigationTimings.capacity)
+                      : ""
+                font.pixelSize: 12
+                color: Theme ? Theme.textSecondaryColor : "#757575"
+            }
+
+            Item {
+                Layout.fillWidth: true
+            }
+
+            Button {
+                text: qsTr("Reset")
+                enabled: NavigationTimings !== null
+                onClicked: NavigationTimings.reset()
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 8
+
+            Repeater {
+                model: [qsTr("Route"), qsTr("Count"), qsTr("p50"), qsTr("p90"), qsTr("p99"),
+                    qsTr("Max"), qsTr("Resolve p90"), qsTr("Compile p90"), qsTr("Create p90"),
+                    qsTr("Frame p90")]
+
+                Label {
+                    Layout.fillWidth: true
+                    Layout.preferredWidth: index === 0 ? 3 : 1
+                    text: modelData
+                    font.pixelSize: 12
+                    font.bold: true
+                    color: Theme ? Theme.textSecondaryColor : "#757575"
+                }
+            }
+        }
+
+        ListView {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            Layout.preferredHeight: 1
+            clip: true
+            model: page.navigationRows
+
+            delegate: Rectangle {
+                required property var modelData
+                required property int index
+
+                width: ListView.view.width
+                height: 32
+                color: index % 2 ? "transparent" : (Theme ? Theme.surfaceColor : "#F5F5F5")
+
+                RowLayout {
+                    anchors.fill: parent
+                    anchors.leftMargin: 4
+                    anchors.rightMargin: 4
+                    spacing: 8
+
+                    Repeater {
+                        model: [modelData.route,
+                            modelData.failed > 0 ? qsTr("%1 (%2 failed)").arg(modelData.count).arg(modelData.failed)
+                                                 : modelData.count,
+                            modelData.totalP50Ms.toFixed(1),
+                            modelData.totalP90Ms.toFixed(1),
+                            modelData.totalP99Ms.toFixed(1),
+                            modelData.totalMaxMs.toFixed(1),
+                            modelData.resolveP90Ms.toFixed(1),
+                            modelData.compileP90Ms.toFixed(1),
+                            modelData.createP90Ms.toFixed(1),
+                            modelData.frameP90Ms.toFixed(1)]
+
+                        Label {
+                            Layout.fillWidth: true
+                            Layout.preferredWidth: index === 0 ? 3 : 1
+                            text: modelData
+                            font.pixelSize: 13
+                            elide: Text.ElideRight
+                            color: Theme ? Theme.textColor : "#212121"
+                        }
+                    }
+                }
+            }
+
+            Label {
+                anchors.centerIn: parent
+                visible: page.navigationRows.length === 0
+                text: qsTr("No navigation recorded yet.")
+                color: Theme ? Theme.textSecondaryColor : "#757575"
+            }
+        }
+    }
+}
@@ -13,7 +13,21 @@ ApplicationWindow {
     color: Theme ? Theme.backgroundColor : "#FFFFFF"
 
     // Track current route for menu highlighting
-    property string currentRoute: ""
+    readonly property string currentRoute: PageCache ? PageCache.currentRoute : ""
+
+    // Show the page of a route; pages are created asynchronously and
+    // kept by the page cache, so coming back to one is instant
+    function navigate(route) {
+        if (PageCache) {
+            PageCache.show(route)
+        }
+    }
+
+    function prefetch(route) {
+        if (PageCache && route) {
+            PageCache.prefetch(route)
+        }
+    }
 
     RowLayout {
         anchors.fill: parent
@@ -26,15 +40,14 @@ ApplicationWindow {
             currentRoute: root.currentRoute
 
             onItemClicked: function (id, route) {
-                // Get the page URL from Navigation service
-                if (Navigation && route) {
-                    var pageUrl = Navigation.getPageUrl(route)
-                    if (pageUrl) {
-                        contentLoader.loadPage(pageUrl)
-                        root.currentRoute = route
-                    }
+                if (route) {
+                    root.navigate(route)
                 }
             }
+
+            onItemHovered: function (route) {
+                root.prefetch(route)
+            }
         }
 
         // Separator
@@ -66,10 +79,7 @@ ApplicationWindow {
                         visible: root.currentRoute !== ""
                         text: "🏠"
                         font.pixelSize: 20
-                        onClicked: {
-                            contentLoader.goHome()
-                            root.currentRoute = ""
-                        }
+                        onClicked: root.navigate("")
 
                         background: Rectangle {
                             color: parent.hovered ? Qt.alpha(
@@ -81,15 +91,30 @@ ApplicationWindow {
 
                     // Page title
                     Label {
-                        text: contentLoader.item ? (contentLoader.item.pageTitle
-                                                           || contentLoader.item.title
-                                                           || "Home") : "Home"
+                        text: PageCache && PageCache.currentItem
+                              ? (PageCache.currentItem.pageTitle
+                                 || PageCache.currentItem.title || "Home") : "Home"
                         font.pixelSize: 20
                         font.weight: Font.Medium
                         color: Theme ? Theme.textColor : "#212121"
                         Layout.fillWidth: true
                     }
 
+                    // Per-plugin resource usage
+                    ToolButton {
+                        visible: App.hasService("Diagnostics")
+                        text: "📊"
+                        font.pixelSize: 18
+                        onClicked: root.navigate("diagnostics")
+
+                        background: Rectangle {
+                            color: parent.hovered ? Qt.alpha(
+                                                        Theme ? Theme.textColor : "#212121",
+                                                        0.1) : "transparent"
+                            radius: 4
+                        }
+                    }
+
                     // Plugin count badge
                     Rectangle {
                         visible: AppMenu && AppMenu.count > 0
@@ -117,35 +142,38 @@ ApplicationWindow {
                 color: Theme ? Qt.darker(Theme.surfaceColor, 1.1) : "#E0E0E0"
             }
 
-            // Content area - simple Loader (no StackView)
-            Loader {
-                id: contentLoader
-                objectName: "contentLoader"
+            // Content area - route pages are parented here by the page cache
+            Item {
+                id: pageHost
+                objectName: "pageHost"
                 Layout.fillWidth: true
                 Layout.fillHeight: true
+                clip: true
                 
-                // Default to welcome page
-                sourceComponent: WelcomePage {}
-                
-                // Load plugin page by URL
-                function loadPage(url) {
-                    if (url && url.toString().length > 0) {
-                        source = url
-                    } else {
-                        sourceComponent = WelcomePage
+                Component.onCompleted: {
+                    if (PageCache) {
+                        PageCache.container = pageHost
                     }
                 }
                 
-                // Go back to welcome page
-                function goHome() {
-                    source = ""
-                    sourceComponent = WelcomePage
+                // Welcome page while no route is shown
+                Loader {
+                    anchors.fill: parent
+                    active: root.currentRoute === ""
+                    sourceComponent: WelcomePage {}
                 }
                 
-                onStatusChanged: {
-                    if (status === Loader.Error) {
-                        console.error("Failed to load page:", source)
-                        console.error("Error:", contentLoader.sourceComponent)
+                BusyIndicator {
+                    anchors.centerIn: parent
+                    running: PageCache ? PageCache.loading : false
+                }
+
+                Connections {
+                    target: PageCache
+
+                    function onLoadFailed(route, error) {
+                        console.error("Failed to load page:", route)
+                        console.error("Error:", error)
                     }
                 }
             }
@@ -282,15 +310,25 @@ ApplicationWindow {
                                     text: (modelData.icon
                                            || "") + " " + (modelData.label
                                                            || "")
+                                    onHoveredChanged: {
+                                        if (hovered) {
+                                            hoverTimer.restart()
+                                        } else {
+                                            hoverTimer.stop()
+                                        }
+                                    }
                                     onClicked: {
-                                        if (Navigation && modelData.route) {
-                                            var pageUrl = Navigation.getPageUrl(modelData.route)
-                                            if (pageUrl) {
-                                                contentLoader.loadPage(pageUrl)
-                                                root.currentRoute = modelData.route
-                                            }
+                                        if (modelData.route) {
+                                            root.navigate(modelData.route)
                                         }
                                     }
+
+                                    // Same hover intent as the side menu: ignore the pointer passing over
+                                    Timer {
+                                        id: hoverTimer
+                                        interval: 150
+                                        onTriggered: root.prefetch(modelData.route)
+                                    }
                                 }
                             }
                         }
@@ -320,7 +358,7 @@ ApplicationWindow {
                         }
                         ServiceLabel {
                             name: "Settings"
-                            status: Settings ? "✓" : "✗"
+                            status: App.hasService("Settings") ? "✓" : "✗"
                         }
                         ServiceLabel {
                             name: "Theme"
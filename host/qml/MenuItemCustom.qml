@@ -18,6 +18,7 @@ Rectangle {
     property bool expanded: true
     
     signal clicked()
+    signal hoverIntent()     // The pointer rested on the item; it is likely to be clicked
     
     implicitHeight: 48
     radius: Theme ? Theme.radiusSmall : 4
@@ -55,6 +56,21 @@ Rectangle {
                 root.clicked()
             }
         }
+        
+        onContainsMouseChanged: {
+            if (containsMouse && root.enabled) {
+                hoverTimer.restart()
+            } else {
+                hoverTimer.stop()
+            }
+        }
+    }
+    
+    // Ignore the pointer just passing over the item
+    Timer {
+        id: hoverTimer
+        interval: 150
+        onTriggered: root.hoverIntent()
     }
     
     RowLayout {
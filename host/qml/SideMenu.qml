@@ -15,6 +15,7 @@ Rectangle {
     property string currentRoute: ""
     
     signal itemClicked(string id, string route)
+    signal itemHovered(string route)      // Hover rested on an item: prefetch its page
     
     implicitWidth: expanded ? expandedWidth : collapsedWidth
     color: Theme ? Theme.surfaceColor : "#F5F5F5"
@@ -109,6 +110,12 @@ Rectangle {
                 onClicked: {
                     root.itemClicked(modelData.id, modelData.route)
                 }
+                
+                onHoverIntent: {
+                    if (modelData.route) {
+                        root.itemHovered(modelData.route)
+                    }
+                }
             }
             
             // Empty state
@@ -8,6 +8,13 @@
 #include "menu_service.h"
 #include "event_bus_service.h"
 #include "qml_context.h"
+#include "startup_profiler.h"
+#include "resource_monitor.h"
+#include "remote_plugin.h"
+#include "qml_resource_index.h"
+#include "qml_url_interceptor.h"
+#include "page_cache.h"
+#include "script_driver.h"
 
 #include "service_registry.h"
 #include "logger.h"
@@ -17,8 +24,12 @@
 #include <mpf/interfaces/itheme.h>
 #include <mpf/interfaces/imenu.h>
 #include <mpf/interfaces/ieventbus.h>
+#include <mpf/interfaces/iqmlresources.h>
 
 #include <QQmlContext>
+#include <QQmlComponent>
+#include <QQuickWindow>
+#include <QTimer>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
@@ -34,11 +45,40 @@ namespace mpf {
 
 Application* Application::s_instance = nullptr;
 
+namespace {
+
+// Decided before the QCoreApplication exists, so argv is scanned directly
+bool headlessRequested(int argc, char** argv)
+{
+    if (qEnvironmentVariableIntValue("MPF_HEADLESS") > 0) {
+        return true;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 Application::Application(int& argc, char** argv)
 {
     s_instance = this;
+    m_startupTimer.start();
     
-    m_app = std::make_unique<QGuiApplication>(argc, argv);
+    // MPF_STARTUP_TRACE=<file>: record startup spans as a Chrome trace
+    StartupProfiler::enableFromEnvironment();
+    
+    m_headless = headlessRequested(argc, argv);
+    if (m_headless) {
+        MPF_PROFILE_SCOPE("QCoreApplication");
+        m_app = std::make_unique<QCoreApplication>(argc, argv);
+    } else {
+        MPF_PROFILE_SCOPE("QGuiApplication");
+        m_app = std::make_unique<QGuiApplication>(argc, argv);
+    }
     m_app->setOrganizationName("MPF");
     m_app->setApplicationName("QtModularPluginFramework");
     m_app->setApplicationVersion("1.0.0");
@@ -58,38 +98,119 @@ Application::~Application()
 
 bool Application::initialize()
 {
+    MPF_PROFILE_SCOPE("Application::initialize");
+    
     setupPaths();
     setupLogging();
     
     // Create service registry
     m_registry = std::make_unique<ServiceRegistryImpl>(this);
     
-    // Create and register core services
-    auto* navigation = new NavigationService(nullptr, this);
-    auto* settings = new SettingsService(m_configPath, this);
-    auto* theme = new ThemeService(this);
-    auto* menu = new MenuService(this);
-    auto* eventBus = new EventBusService(this);
-
-    m_registry->add<INavigation>(navigation, INavigation::apiVersion(), "host");
-    m_registry->add<ISettings>(settings, ISettings::apiVersion(), "host");
-    m_registry->add<ITheme>(theme, ITheme::apiVersion(), "host");
-    m_registry->add<IMenu>(menu, IMenu::apiVersion(), "host");
-    m_registry->add<ILogger>(m_logger.get(), ILogger::apiVersion(), "host");
-    m_registry->add<IEventBus>(eventBus, IEventBus::apiVersion(), "host");
+    // MPF_SERVICE_STATS=1: record per-method service call statistics,
+    // dumped when the application quits
+    if (qEnvironmentVariableIntValue("MPF_SERVICE_STATS") > 0) {
+        m_registry->setInstrumentationEnabled(true);
+    }
     
-    // Create QML engine
-    m_engine = std::make_unique<QQmlApplicationEngine>();
+    // --script <file> / --script-results <file>: run a script once plugins are up,
+    // in headless and GUI mode alike, then quit with its result
+    const QStringList args = m_app->arguments();
+    m_scriptPath = qEnvironmentVariable("MPF_SCRIPT");
+    m_scriptResultPath = qEnvironmentVariable("MPF_SCRIPT_RESULTS");
+    for (int i = 1; i + 1 < args.size(); ++i) {
+        if (args.at(i) == QLatin1String("--script")) {
+            m_scriptPath = args.at(i + 1);
+        } else if (args.at(i) == QLatin1String("--script-results")) {
+            m_scriptResultPath = args.at(i + 1);
+        }
+    }
+    
+    // Create QML engine (needed by the navigation service factory); a
+    // headless host has none, and navigation only records routes
+    if (!m_headless) {
+        MPF_PROFILE_SCOPE("QQmlApplicationEngine");
+        m_engine = std::make_unique<QQmlApplicationEngine>();
+    } else {
+        qInfo() << "Running headless: no QML engine, plugins skip their QML types";
+    }
     
-    // Update navigation with engine reference
-    static_cast<NavigationService*>(navigation)->~NavigationService();
-    new (navigation) NavigationService(m_engine.get(), this);
+    // Register core services lazily: each is constructed on first lookup,
+    // so startup only pays for services that are actually used
+    m_registry->addFactory<INavigation>([this]() {
+        auto* navigation = new NavigationService(m_engine.get());
+        // Unknown routes may belong to a plugin that is loaded on first use
+        navigation->setRouteActivationHandler([this](const QString& route) {
+            return m_pluginManager && m_pluginManager->loadForRoute(route);
+        });
+        navigation->setRouteUsageHandler([this](const QString& pluginId) {
+            markPluginUsed(pluginId);
+        });
+        return navigation;
+    }, INavigation::apiVersion(), "host");
+    m_registry->addFactory<ISettings>([this]() {
+        return new SettingsService(m_configPath);
+    }, ISettings::apiVersion(), "host");
+    m_registry->addFactory<ITheme>([]() {
+        return new ThemeService();
+    }, ITheme::apiVersion(), "host");
+    m_registry->addFactory<IMenu>([]() {
+        return new MenuService();
+    }, IMenu::apiVersion(), "host");
+    m_registry->addFactory<IEventBus>([this]() {
+        auto* eventBus = new EventBusService();
+        eventBus->setDeliveryHandler([this](const QString& pluginId) {
+            markPluginUsed(pluginId);
+        });
+        return eventBus;
+    }, IEventBus::apiVersion(), "host");
+    m_registry->add<ILogger>(m_logger.get(), ILogger::apiVersion(), "host");
+    m_registry->addFactory<IQmlResources>([this]() {
+        return new QmlResourceIndex(qmlSearchPaths());
+    }, IQmlResources::apiVersion(), "host");
+    m_registry->addFactory<ResourceMonitor>([]() {
+        return new ResourceMonitor();
+    }, 1, "host");
+    
+    // MPF_RESOURCE_MONITOR=1: account CPU time, heap and event bus usage per
+    // plugin from the start, dumped when the application quits
+    if (qEnvironmentVariableIntValue("MPF_RESOURCE_MONITOR") > 0) {
+        m_registry->get<ResourceMonitor>()->setEnabled(true);
+    }
     
-    setupQmlContext();
+    // Services nobody has registered may come from a deferred plugin
+    m_registry->setMissHandler([this](const char* typeName) {
+        return m_pluginManager && m_pluginManager->loadForService(typeName);
+    });
+    m_registry->setUsageHandler([this](const QString& providerId) {
+        markPluginUsed(providerId);
+    });
+    
+    if (!m_headless) {
+        setupQmlContext();
+    }
     loadPlugins();
+    m_pluginsReadyMs = m_startupTimer.elapsed();
     
-    if (!loadMainQml()) {
-        return false;
+    if (m_headless) {
+        qInfo() << "Time to plugins ready (headless):" << m_pluginsReadyMs << "ms";
+        // Nothing to draw first: bring up the remaining plugins right away
+        if (!m_pluginManager->warmUpQueue().isEmpty()) {
+            m_pluginManager->warmUp();
+        }
+    } else {
+        if (!loadMainQml()) {
+            return false;
+        }
+        reportStartupTimes();
+    }
+    
+    for (const ServiceFactoryTiming& timing : m_registry->factoryTimings()) {
+        if (timing.constructed) {
+            qDebug() << "Service" << timing.interfaceName << "constructed in"
+                     << QString::number(timing.elapsedNs / 1.0e6, 'f', 2) << "ms";
+        } else {
+            qDebug() << "Service" << timing.interfaceName << "not constructed (unused)";
+        }
     }
     
     emit initialized();
@@ -98,13 +219,65 @@ bool Application::initialize()
 
 int Application::run()
 {
+    // Plugins still warming up add spans: write now and finally once done
+    if (m_pluginManager->warmUpQueue().isEmpty()) {
+        StartupProfiler::write();
+    } else {
+        StartupProfiler::write(true);
+        connect(m_pluginManager.get(), &PluginManager::warmUpFinished, this, []() {
+            StartupProfiler::write();
+        }, Qt::SingleShotConnection);
+    }
+    
     connect(m_app.get(), &QCoreApplication::aboutToQuit, this, [this]() {
         emit aboutToQuit();
+        
+        // Queued log messages come before the reports
+        if (m_logger->isAsync()) {
+            m_logger->flush();
+            if (m_logger->droppedCount() > 0) {
+                qInfo() << "Logger:" << m_logger->droppedCount() << "messages dropped (log queue full)";
+            }
+        }
+        
+        if (m_registry && m_registry->isInstrumentationEnabled()) {
+            qInfo().noquote() << m_registry->instrumentationReport();
+        }
+        
+        if (m_registry && ResourceMonitor::isEnabled()) {
+            qInfo().noquote() << m_registry->get<ResourceMonitor>()->report();
+        }
+        
+        // MPF_NAVIGATION_TIMINGS=<file>: dump the recorded navigations
+        const QString timingsPath = qEnvironmentVariable("MPF_NAVIGATION_TIMINGS");
+        if (m_pageCache && !timingsPath.isEmpty()) {
+            qInfo().noquote() << m_pageCache->timings()->report();
+            m_pageCache->timings()->write(timingsPath);
+        }
     });
     
+    if (!m_scriptPath.isEmpty()) {
+        // Run from the event loop so queued deliveries and timers work;
+        // the script's result becomes the exit code
+        QTimer::singleShot(0, this, [this]() {
+            m_app->exit(runScript());
+        });
+    }
+    
     return m_app->exec();
 }
 
+int Application::runScript()
+{
+    // Finish a warm-up that is still in progress so the script sees every plugin
+    while (!m_pluginManager->warmUpQueue().isEmpty()) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    
+    ScriptDriver driver(m_registry.get(), m_pluginManager.get());
+    return driver.run(m_scriptPath, m_scriptResultPath) ? 0 : 1;
+}
+
 QStringList Application::arguments() const
 {
     return m_app->arguments();
@@ -112,6 +285,7 @@ QStringList Application::arguments() const
 
 void Application::setupPaths()
 {
+    MPF_PROFILE_SCOPE("setupPaths");
     QString appDir = QCoreApplication::applicationDirPath();
     
     // SDK detection priority:
@@ -220,15 +394,40 @@ void Application::setupPaths()
     }
 }
 
+QStringList Application::qmlSearchPaths() const
+{
+    // The order plugins used to probe in: SDK, QML_IMPORT_PATH, then next to the executable
+    QStringList paths;
+    QString sdkRoot = qEnvironmentVariable("MPF_SDK_ROOT");
+    if (!sdkRoot.isEmpty()) {
+        paths << QDir(sdkRoot).filePath("qml");
+    }
+    paths << qEnvironmentVariable("QML_IMPORT_PATH").split(QDir::listSeparator(), Qt::SkipEmptyParts);
+    
+    QString appDir = QCoreApplication::applicationDirPath();
+    paths << appDir + "/../qml" << appDir + "/qml";
+    paths << m_qmlPath << m_extraQmlPaths;
+    return paths;
+}
+
 void Application::setupLogging()
 {
+    MPF_PROFILE_SCOPE("setupLogging");
     m_logger = std::make_unique<Logger>(this);
     m_logger->setFormat("[%time%] [%level%] [%tag%] %message%");
     m_logger->setMinLevel(ILogger::Level::Debug);
+    
+    // MPF_LOG_ASYNC=1: format and write log messages on a background thread
+    // instead of the caller's; MPF_LOG_QUEUE=<messages> sets the queue size
+    if (qEnvironmentVariableIntValue("MPF_LOG_ASYNC") > 0) {
+        int queueSize = qEnvironmentVariableIntValue("MPF_LOG_QUEUE");
+        m_logger->enableAsync(queueSize > 0 ? queueSize : 8192);
+    }
 }
 
 void Application::setupQmlContext()
 {
+    MPF_PROFILE_SCOPE("setupQmlContext");
     // Add QML import paths
     m_engine->addImportPath(m_qmlPath);
     m_engine->addImportPath("qrc:/");
@@ -258,15 +457,41 @@ void Application::setupQmlContext()
         m_engine->addImportPath(hostQmlDir);
     }
     
+    // Load the ahead-of-time compiled copies of files found on the import paths
+    m_urlInterceptor = std::make_unique<QmlUrlInterceptor>(qmlSearchPaths());
+    m_engine->addUrlInterceptor(m_urlInterceptor.get());
+    if (!QmlUrlInterceptor::preferResources()) {
+        qDebug() << "MPF_QML_FROM_DISK set: loading QML from disk, compiled resources are ignored";
+    }
+    
     // Create and setup QML context helper
-    auto* qmlContext = new QmlContext(m_registry.get(), this);
-    qmlContext->setup(m_engine.get());
+    m_qmlContext = new QmlContext(m_registry.get(), this);
+    m_qmlContext->setup(m_engine.get());
+    
+    // Route pages are created asynchronously and kept for the next visit;
+    // MPF_PAGE_CACHE_MB=<megabytes> sets the memory budget (0 keeps only
+    // the page shown). The shell navigates from its first frame, so GUI
+    // mode creates INavigation here.
+    auto* navigation = qobject_cast<NavigationService*>(m_registry->getObject<INavigation>());
+    m_pageCache = std::make_unique<PageCache>(m_engine.get(), navigation);
+    if (qEnvironmentVariableIsSet("MPF_PAGE_CACHE_MB")) {
+        m_pageCache->setBudget(qint64(qEnvironmentVariableIntValue("MPF_PAGE_CACHE_MB")) * 1024 * 1024);
+    }
+    // Plugin pages find Settings and EventBus in the root context
+    connect(m_pageCache.get(), &PageCache::aboutToCompile,
+            m_qmlContext, &QmlContext::exposePluginServices);
+    m_engine->rootContext()->setContextProperty("PageCache", m_pageCache.get());
+    m_engine->rootContext()->setContextProperty("NavigationTimings", m_pageCache->timings());
+    if (navigation) {
+        navigation->registerRoute("diagnostics", "qrc:/MPF/Host/DiagnosticsPage.qml");
+    }
     
     qDebug() << "QML import paths:" << m_engine->importPathList();
 }
 
 void Application::loadPlugins()
 {
+    MPF_PROFILE_SCOPE("loadPlugins");
     m_pluginManager = std::make_unique<PluginManager>(m_registry.get(), this);
     
     // Connect signals for logging
@@ -279,21 +504,47 @@ void Application::loadPlugins()
                 qWarning() << "Plugin error:" << id << "-" << err; 
             });
     
-    // Discover plugins from extra paths first (development overrides, higher priority)
-    // This allows linked source plugins to override SDK binary plugins
+    // Remember plugin metadata between runs so unchanged binaries are not reopened
+    m_pluginManager->setMetadataCache(QDir(m_configPath).filePath("plugin-metadata-cache.json"));
+    
+    // Extra paths come first (development overrides, higher priority) so linked
+    // source plugins override SDK binary plugins and plugins linked into the
+    // host; the default path is the fallback
     int count = 0;
-    for (const QString& path : m_extraPluginPaths) {
-        int found = m_pluginManager->discover(path);
-        qDebug() << "Discovered" << found << "plugins from development path:" << path;
-        count += found;
+    if (!m_extraPluginPaths.isEmpty()) {
+        count += m_pluginManager->discover(m_extraPluginPaths);
     }
-    
-    // Then discover from default plugin path (SDK fallback)
-    int defaultCount = m_pluginManager->discover(m_pluginPath);
-    qDebug() << "Discovered" << defaultCount << "plugins from default path:" << m_pluginPath;
-    count += defaultCount;
+    count += m_pluginManager->discoverStatic();
+    count += m_pluginManager->discover(m_pluginPath);
     
     qDebug() << "Total discovered" << count << "plugins";
+    m_pluginManager->saveMetadataCache();
+    
+    // Pages of a plugin must go before its library does
+    connect(m_pluginManager.get(), &PluginManager::pluginAboutToUnload,
+            this, &Application::releasePluginPage);
+    connect(m_pluginManager.get(), &PluginManager::pluginReloaded, this, [this]() {
+        if (m_engine) {
+            m_engine->trimComponentCache();
+        }
+    });
+    
+    // MPF_CRITICAL_STARTUP=1: show the window with only "critical" plugins;
+    // the other startup plugins come up after the first frame
+    if (qEnvironmentVariableIntValue("MPF_CRITICAL_STARTUP") > 0) {
+        m_pluginManager->setCriticalOnly(true);
+    }
+    
+    // MPF_PARALLEL_STARTUP=1: initialize/start independent thread-safe plugins concurrently
+    if (qEnvironmentVariableIntValue("MPF_PARALLEL_STARTUP") > 0) {
+        m_pluginManager->setExecutionMode(PluginManager::ExecutionMode::Parallel);
+    }
+    
+    // MPF_OUT_OF_PROCESS=<id>,...: run these plugins in mpf-plugin-host processes
+    QString outOfProcess = qEnvironmentVariable("MPF_OUT_OF_PROCESS");
+    if (!outOfProcess.isEmpty()) {
+        m_pluginManager->setOutOfProcess(outOfProcess.split(',', Qt::SkipEmptyParts));
+    }
     
     // Load, initialize, and start
     if (m_pluginManager->loadAll()) {
@@ -302,47 +553,148 @@ void Application::loadPlugins()
         }
     }
     
+    QStringList deferred = m_pluginManager->deferredPlugins();
+    if (!deferred.isEmpty()) {
+        qDebug() << "Plugins loaded on demand:" << deferred;
+    }
+    
+    // MPF_PLUGIN_WATCH=1: reload plugins in place when their binaries are rebuilt
+    if (qEnvironmentVariableIntValue("MPF_PLUGIN_WATCH") > 0) {
+        m_pluginManager->setWatchEnabled(true);
+    }
+    
+    // MPF_PLUGIN_IDLE_TIMEOUT=<seconds>: unload plugins unused for that long;
+    // they load again on next use. The plugin whose page is shown never idles.
+    int idleTimeout = qEnvironmentVariableIntValue("MPF_PLUGIN_IDLE_TIMEOUT");
+    if (idleTimeout > 0) {
+        m_pluginManager->setIdleUnloadFilter([this](const QString& pluginId) {
+            return pluginId != currentPagePlugin();
+        });
+        m_pluginManager->setIdleTimeout(qint64(idleTimeout) * 1000);
+    }
+    
     // Register plugin QML modules
     for (const QString& uri : m_pluginManager->qmlModuleUris()) {
         qDebug() << "Plugin QML module:" << uri;
     }
+    
+    // MPF_REMOTE_BENCHMARK=<iterations>: compare service calls from an
+    // out-of-process plugin with in-process calls
+    int benchmarkIterations = qEnvironmentVariableIntValue("MPF_REMOTE_BENCHMARK");
+    if (benchmarkIterations > 0) {
+        RemotePlugin::runBenchmark(m_registry.get(), benchmarkIterations);
+    }
+}
+
+void Application::markPluginUsed(const QString& pluginId)
+{
+    if (m_pluginManager && !pluginId.isEmpty()) {
+        m_pluginManager->markUsed(pluginId);
+    }
+}
+
+QString Application::currentPagePlugin() const
+{
+    auto* navigation = qobject_cast<NavigationService*>(m_registry->getObject<INavigation>());
+    if (!m_pageCache || !navigation) {
+        return QString();
+    }
+    
+    QString route = m_pageCache->currentRoute();
+    return route.isEmpty() ? QString() : navigation->routeOwner(route);
+}
+
+void Application::releasePluginPage(const QString& pluginId)
+{
+    // Cached pages hold objects of the plugin too; none may survive the unload
+    if (m_pageCache) {
+        m_pageCache->releasePlugin(pluginId);
+    }
+}
+
+void Application::reportStartupTimes()
+{
+    auto* window = qobject_cast<QQuickWindow*>(m_engine->rootObjects().value(0));
+    if (!window) {
+        return;
+    }
+    
+    // frameSwapped comes from the render thread; the context object queues it here
+    connect(window, &QQuickWindow::frameSwapped, this, [this]() {
+        qInfo() << "Time to first frame:" << m_startupTimer.elapsed() << "ms";
+        if (m_pluginManager->warmUpQueue().isEmpty()) {
+            qInfo() << "Time to fully loaded:" << m_pluginsReadyMs << "ms";
+            return;
+        }
+        m_pluginManager->warmUp();
+    }, Qt::SingleShotConnection);
+    
+    connect(m_pluginManager.get(), &PluginManager::warmUpFinished, this, [this](int started) {
+        qInfo() << "Time to fully loaded:" << m_startupTimer.elapsed() << "ms ("
+                << started << "plugins warmed up after the first frame)";
+    });
 }
 
 bool Application::loadMainQml()
 {
+    MPF_PROFILE_SCOPE("loadMainQml");
     // Try to find entry QML from plugins first
     QString entryQml;
     for (auto* loader : m_pluginManager->plugins()) {
         QString pluginEntry = m_pluginManager->entryQml(loader->metadata().id());
         if (!pluginEntry.isEmpty()) {
             entryQml = pluginEntry;
+            m_qmlContext->exposePluginServices();
             break;
         }
     }
     
     // Fall back to host's Main.qml
     if (entryQml.isEmpty()) {
-        // Try filesystem path first (development), then qrc (release)
+        // The compiled copy in the resources first; the filesystem copy only
+        // when editing QML in place (MPF_QML_FROM_DISK=1)
         // Note: QT_RESOURCE_ALIAS flattens paths, so no /qml/ subdirectory
         QString fsPath = m_qmlPath + "/MPF/Host/Main.qml";
-        if (QFile::exists(fsPath)) {
-            entryQml = QUrl::fromLocalFile(fsPath).toString();
-        } else {
+        if (QmlUrlInterceptor::preferResources() || !QFile::exists(fsPath)) {
             // RESOURCE_PREFIX "/" + QT_RESOURCE_ALIAS means qrc:/MPF/Host/Main.qml
             entryQml = "qrc:/MPF/Host/Main.qml";
+        } else {
+            entryQml = QUrl::fromLocalFile(fsPath).toString();
         }
     }
     
     qDebug() << "Loading main QML:" << entryQml;
     
-    m_engine->load(QUrl(entryQml));
+    // Compile first so the trace separates compilation from object creation;
+    // the engine's type cache reuses the compiled component in load()
+    {
+        MPF_PROFILE_SCOPE("compile " + QUrl(entryQml).fileName(), "qml");
+        QQmlComponent component(m_engine.get(), QUrl(entryQml), QQmlComponent::PreferSynchronous);
+    }
+    
+    {
+        MPF_PROFILE_SCOPE("create " + QUrl(entryQml).fileName(), "qml");
+        m_engine->load(QUrl(entryQml));
+    }
     
     if (m_engine->rootObjects().isEmpty()) {
         qCritical() << "Failed to load main QML";
         return false;
     }
     
+    reportQmlCompilation();
     return true;
 }
 
+void Application::reportQmlCompilation()
+{
+    QStringList disk = m_urlInterceptor->diskLoaded();
+    qInfo().noquote() << QString("QML components at startup: %1 served from qrc, %2 loaded from disk")
+        .arg(m_urlInterceptor->resourceCount())
+        .arg(disk.size());
+    for (const QString& url : std::as_const(disk)) {
+        qDebug() << "  Loaded from disk:" << url;
+    }
+}
+
 } // namespace mpf
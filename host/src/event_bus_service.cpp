@@ -1,5 +1,7 @@
 #include "event_bus_service.h"
 #include "cross_dll_safety.h"
+#include "service_instrumentation.h"
+#include "resource_monitor.h"
 
 #include <QDateTime>
 #include <QMetaObject>
@@ -23,6 +25,7 @@ int EventBusService::publish(const QString& topic,
                               const QVariantMap& data,
                               const QString& senderId)
 {
+    MPF_SERVICE_CALL("publish");
     Event event;
     event.topic = topic;
     event.senderId = senderId;
@@ -36,6 +39,7 @@ int EventBusService::publishSync(const QString& topic,
                                   const QVariantMap& data,
                                   const QString& senderId)
 {
+    MPF_SERVICE_CALL("publishSync");
     Event event;
     event.topic = topic;
     event.senderId = senderId;
@@ -49,6 +53,10 @@ int EventBusService::deliverEvent(const Event& event, bool synchronous)
 {
     QList<const Subscription*> matches;
 
+    // Publishing plugin, for resource accounting
+    const QString publisher = event.senderId.isEmpty() ? PluginContext::current() : event.senderId;
+    ResourceMonitor::recordPublished(publisher);
+
     {
         QMutexLocker locker(&m_mutex);
 
@@ -81,15 +89,23 @@ int EventBusService::deliverEvent(const Event& event, bool synchronous)
         }
 
         notified++;
+        ResourceMonitor::recordDelivered(sub->subscriberId);
+        if (m_deliveryHandler) {
+            m_deliveryHandler(sub->subscriberId);
+        }
     }
 
-    // Emit signal for subscribers
+    // Emit signal for subscribers. Handlers all run inside one emission and
+    // none of them is known to belong to a subscription, so their CPU time
+    // goes to a row of its own instead of the publisher's.
     if (synchronous) {
         // Direct emission (blocking)
+        ResourceScope resources(ResourceMonitor::eventHandlersId(), ResourceCategory::Event);
         emit eventPublished(event.topic, event.data, event.senderId);
     } else {
         // Queued emission (async)
         QMetaObject::invokeMethod(this, [this, event]() {
+            ResourceScope resources(ResourceMonitor::eventHandlersId(), ResourceCategory::Event);
             emit eventPublished(event.topic, event.data, event.senderId);
         }, Qt::QueuedConnection);
     }
@@ -101,6 +117,7 @@ QString EventBusService::subscribe(const QString& pattern,
                                     const QString& subscriberId,
                                     const SubscriptionOptions& options)
 {
+    MPF_SERVICE_CALL("subscribe");
     Subscription sub;
     sub.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
     // Deep copy strings from plugin to ensure they're in host's heap
@@ -114,6 +131,7 @@ QString EventBusService::subscribe(const QString& pattern,
         m_subscriptions.insert(sub.id, sub);
         m_subscriberIndex[sub.subscriberId].append(sub.id);
     }
+    ResourceMonitor::recordSubscriptions(sub.subscriberId, 1);
 
     qDebug() << "EventBus: Subscribed" << subscriberId << "to" << pattern
              << "id:" << sub.id;
@@ -128,6 +146,7 @@ QString EventBusService::subscribe(const QString& pattern,
 
 bool EventBusService::unsubscribe(const QString& subscriptionId)
 {
+    MPF_SERVICE_CALL("unsubscribe");
     QString subscriberId;
 
     {
@@ -146,6 +165,7 @@ bool EventBusService::unsubscribe(const QString& subscriptionId)
             m_subscriberIndex.remove(subscriberId);
         }
     }
+    ResourceMonitor::recordSubscriptions(subscriberId, -1);
 
     qDebug() << "EventBus: Unsubscribed" << subscriptionId;
 
@@ -158,6 +178,7 @@ bool EventBusService::unsubscribe(const QString& subscriptionId)
 
 void EventBusService::unsubscribeAll(const QString& subscriberId)
 {
+    MPF_SERVICE_CALL("unsubscribeAll");
     QStringList ids;
 
     {
@@ -169,6 +190,8 @@ void EventBusService::unsubscribeAll(const QString& subscriberId)
         }
     }
 
+    ResourceMonitor::recordSubscriptions(subscriberId, -int(ids.size()));
+
     for (const QString& id : ids) {
         emit subscriptionRemoved(id);
     }
@@ -183,6 +206,7 @@ void EventBusService::unsubscribeAll(const QString& subscriberId)
 
 int EventBusService::subscriberCount(const QString& topic) const
 {
+    MPF_SERVICE_CALL("subscriberCount");
     QMutexLocker locker(&m_mutex);
 
     int count = 0;
@@ -196,6 +220,7 @@ int EventBusService::subscriberCount(const QString& topic) const
 
 QStringList EventBusService::activeTopics() const
 {
+    MPF_SERVICE_CALL("activeTopics");
     QMutexLocker locker(&m_mutex);
 
     QSet<QString> patterns;
@@ -207,6 +232,7 @@ QStringList EventBusService::activeTopics() const
 
 TopicStats EventBusService::topicStats(const QString& topic) const
 {
+    MPF_SERVICE_CALL("topicStats");
     QMutexLocker locker(&m_mutex);
 
     TopicStats stats;
@@ -232,12 +258,14 @@ TopicStats EventBusService::topicStats(const QString& topic) const
 
 QStringList EventBusService::subscriptionsFor(const QString& subscriberId) const
 {
+    MPF_SERVICE_CALL("subscriptionsFor");
     QMutexLocker locker(&m_mutex);
     return deepCopy(m_subscriberIndex.value(subscriberId));
 }
 
 bool EventBusService::matchesTopic(const QString& topic, const QString& pattern) const
 {
+    MPF_SERVICE_CALL("matchesTopic");
     QRegularExpression regex = compilePattern(pattern);
     return regex.match(topic).hasMatch();
 }
@@ -258,6 +286,11 @@ int EventBusService::totalSubscribers() const
     return m_subscriptions.size();
 }
 
+void EventBusService::setDeliveryHandler(PluginUsageHandler handler)
+{
+    m_deliveryHandler = std::move(handler);
+}
+
 QRegularExpression EventBusService::compilePattern(const QString& pattern) const
 {
     // Convert topic pattern to regex:
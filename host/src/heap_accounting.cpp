@@ -0,0 +1,112 @@
+// Global operator new/delete replacements feeding ResourceMonitor's
+// per-plugin heap counters. Only compiled with MPF_HEAP_ACCOUNTING=ON.
+//
+// On ELF platforms plugins bind to these definitions too, since the
+// executable's operator new interposes the one in libstdc++. Aligned
+// overloads are left to the runtime.
+
+#include "resource_monitor.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define MPF_USABLE_SIZE(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define MPF_USABLE_SIZE(p) malloc_size(p)
+#else
+#include <malloc.h>
+#define MPF_USABLE_SIZE(p) malloc_usable_size(p)
+#endif
+
+namespace {
+
+void* allocate(std::size_t size)
+{
+    void* p = std::malloc(size ? size : 1);
+    if (p) {
+        if (mpf::HeapCounters* counters = mpf::ResourceMonitor::s_heapCounters) {
+            counters->allocated.fetchAndAddRelaxed(qint64(MPF_USABLE_SIZE(p)));
+        }
+    }
+    return p;
+}
+
+void deallocate(void* p) noexcept
+{
+    if (!p) {
+        return;
+    }
+    if (mpf::HeapCounters* counters = mpf::ResourceMonitor::s_heapCounters) {
+        counters->freed.fetchAndAddRelaxed(qint64(MPF_USABLE_SIZE(p)));
+    }
+    std::free(p);
+}
+
+void* allocateOrThrow(std::size_t size)
+{
+    for (;;) {
+        if (void* p = allocate(size)) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    deallocate(p);
+}
@@ -0,0 +1,86 @@
+#include "lifecycle_watchdog.h"
+
+#include <QThread>
+#include <QDeadlineTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+namespace mpf {
+
+LifecycleWatchdog::LifecycleWatchdog()
+{
+    m_thread.reset(QThread::create([this]() { run(); }));
+    m_thread->setObjectName("LifecycleWatchdog");
+    m_thread->start(QThread::LowPriority);
+}
+
+LifecycleWatchdog::~LifecycleWatchdog()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_changed.wakeAll();
+    }
+    m_thread->wait();
+}
+
+qint64 LifecycleWatchdog::defaultBudgetMs(const QString& phase)
+{
+    return phase == QLatin1String("stop") ? 2000 : 5000;
+}
+
+quint64 LifecycleWatchdog::arm(const QString& pluginId, const QString& phase, qint64 budgetMs)
+{
+    if (budgetMs <= 0) {
+        return 0;  // Unlimited
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    quint64 token = m_nextToken++;
+    Watch& watch = m_watches[token];
+    watch.pluginId = pluginId;
+    watch.phase = phase;
+    watch.budgetMs = budgetMs;
+    watch.nextReportMs = budgetMs;
+    watch.timer.start();
+    m_changed.wakeAll();
+    return token;
+}
+
+void LifecycleWatchdog::disarm(quint64 token)
+{
+    if (token == 0) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    m_watches.remove(token);
+}
+
+void LifecycleWatchdog::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_quit) {
+        // Report overruns and find the next deadline
+        qint64 waitMs = std::numeric_limits<qint64>::max();
+        for (Watch& watch : m_watches) {
+            qint64 elapsed = watch.timer.elapsed();
+            if (elapsed >= watch.nextReportMs) {
+                qWarning().noquote() << QString("Plugin %1 still in %2() after %3 ms (budget %4 ms)")
+                    .arg(watch.pluginId, watch.phase).arg(elapsed).arg(watch.budgetMs);
+                watch.nextReportMs *= 2;
+            }
+            waitMs = std::min(waitMs, watch.nextReportMs - elapsed);
+        }
+        
+        if (waitMs == std::numeric_limits<qint64>::max()) {
+            m_changed.wait(&m_mutex);
+        } else {
+            m_changed.wait(&m_mutex, QDeadlineTimer(std::max<qint64>(waitMs, 1)));
+        }
+    }
+}
+
+} // namespace mpf
@@ -1,11 +1,199 @@
 #include "logger.h"
+#include "cross_dll_safety.h"
+#include <QAtomicInteger>
+#include <QDeadlineTimer>
+#include <QSemaphore>
+#include <QThread>
 #include <QDebug>
 #include <QDateTime>
+#include <cstdio>
 
 namespace mpf {
 
 Logger* Logger::s_instance = nullptr;
 
+namespace {
+
+constexpr int kIdleWaitMs = 50;
+
+struct LogRecord
+{
+    ILogger::Level level = ILogger::Level::Debug;
+    QString tag;
+    QString message;
+    qint64 time = 0;    // Milliseconds since the epoch
+};
+
+QtMessageHandler s_previousHandler = nullptr;
+
+// Write what async loggers have queued before a fatal message aborts
+void flushOnFatal(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    if (type == QtFatalMsg) {
+        if (Logger* logger = Logger::instance()) {
+            logger->flush();
+        }
+    }
+    
+    if (s_previousHandler) {
+        s_previousHandler(type, context, message);
+    } else {
+        fprintf(stderr, "%s\n", qPrintable(qFormatLogMessage(type, context, message)));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Bounded MPSC queue of log records and the thread writing them
+ *
+ * Each slot carries a sequence number telling producers and the writer
+ * whose turn it is (Vyukov's bounded queue): a producer claims a slot by
+ * advancing the enqueue position with one compare-and-swap, and nobody
+ * waits for a lock. A full queue drops the record.
+ */
+class AsyncLogWriter
+{
+public:
+    using Sink = std::function<void(const LogRecord&)>;
+
+    AsyncLogWriter(int queueSize, Sink sink)
+        : m_capacity(qNextPowerOfTwo(quint32(qMax(2, queueSize) - 1)))
+        , m_slots(new Slot[m_capacity])
+        , m_sink(std::move(sink))
+    {
+        for (quint64 i = 0; i < m_capacity; ++i) {
+            m_slots[i].sequence.storeRelaxed(i);
+        }
+        m_thread.reset(QThread::create([this]() { run(); }));
+        m_thread->setObjectName("Logger");
+        m_thread->start(QThread::LowPriority);
+    }
+
+    ~AsyncLogWriter()
+    {
+        // The writer drains the queue before it quits
+        m_quit.storeRelease(1);
+        m_wakeup.release();
+        m_thread->wait();
+    }
+
+    bool push(LogRecord&& record)
+    {
+        quint64 pos = m_enqueuePos.loadRelaxed();
+        Slot* slot = nullptr;
+        for (;;) {
+            slot = &m_slots[pos & (m_capacity - 1)];
+            qint64 diff = qint64(slot->sequence.loadAcquire() - pos);
+            if (diff == 0) {
+                // On contention pos is reloaded with the current position
+                if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1, pos)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The writer has not emptied this slot yet: the queue is full
+                m_dropped.fetchAndAddRelaxed(1);
+                return false;
+            } else {
+                pos = m_enqueuePos.loadRelaxed();
+            }
+        }
+        
+        slot->record = std::move(record);
+        slot->sequence.storeRelease(pos + 1);
+        wake();
+        return true;
+    }
+
+    bool flush(int timeoutMs)
+    {
+        // The writer would wait for itself
+        if (QThread::currentThread() == m_thread.get()) {
+            return false;
+        }
+        
+        const quint64 target = m_enqueuePos.loadAcquire();
+        QDeadlineTimer deadline(timeoutMs);
+        while (m_written.loadAcquire() < target) {
+            if (deadline.hasExpired()) {
+                return false;
+            }
+            wake();
+            QThread::usleep(100);
+        }
+        return true;
+    }
+
+    quint64 dropped() const { return m_dropped.loadRelaxed(); }
+
+private:
+    struct Slot {
+        QAtomicInteger<quint64> sequence;
+        LogRecord record;
+    };
+
+    bool pop(LogRecord& record)
+    {
+        Slot& slot = m_slots[m_dequeuePos & (m_capacity - 1)];
+        // Empty, or the producer that claimed the slot is still filling it
+        if (slot.sequence.loadAcquire() != m_dequeuePos + 1) {
+            return false;
+        }
+        record = std::move(slot.record);
+        slot.sequence.storeRelease(m_dequeuePos + m_capacity);
+        ++m_dequeuePos;
+        return true;
+    }
+
+    // A wake-up lost to a race only delays writing until the idle wait times out
+    void wake()
+    {
+        if (m_idle.loadRelaxed() && m_idle.testAndSetRelaxed(1, 0)) {
+            m_wakeup.release();
+        }
+    }
+
+    void run()
+    {
+        quint64 reportedDrops = 0;
+        LogRecord record;
+        for (;;) {
+            while (pop(record)) {
+                m_sink(record);
+                m_written.storeRelease(m_dequeuePos);
+            }
+            
+            quint64 dropped = m_dropped.loadRelaxed();
+            if (dropped != reportedDrops) {
+                m_sink(LogRecord{ILogger::Level::Warning, "Logger",
+                                 QString("%1 messages dropped, log queue full").arg(dropped - reportedDrops),
+                                 QDateTime::currentMSecsSinceEpoch()});
+                reportedDrops = dropped;
+            }
+            
+            if (m_quit.loadAcquire() && m_dequeuePos == m_enqueuePos.loadAcquire()) {
+                return;
+            }
+            m_idle.storeRelaxed(1);
+            m_wakeup.tryAcquire(1, kIdleWaitMs);
+            m_idle.storeRelaxed(0);
+        }
+    }
+
+    const quint64 m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    Sink m_sink;
+    std::unique_ptr<QThread> m_thread;
+
+    QAtomicInteger<quint64> m_enqueuePos = 0;   // Next slot producers claim
+    QAtomicInteger<quint64> m_written = 0;      // Records passed to the sink
+    QAtomicInteger<quint64> m_dropped = 0;
+    quint64 m_dequeuePos = 0;                   // Writer thread only
+    QAtomicInt m_idle = 0;
+    QAtomicInt m_quit = 0;
+    QSemaphore m_wakeup;
+};
+
 Logger::Logger(QObject* parent)
     : QObject(parent)
 {
@@ -16,6 +204,9 @@ Logger::Logger(QObject* parent)
 
 Logger::~Logger()
 {
+    // Stop the writer before anything it writes with goes away
+    m_async.reset();
+    
     if (s_instance == this) {
         s_instance = nullptr;
     }
@@ -27,14 +218,29 @@ void Logger::log(Level level, const QString& tag, const QString& message)
         return;
     }
 
-    QMutexLocker locker(&m_mutex);
+    if (m_async) {
+        // Copy into the host's heap: the caller may be a plugin that is
+        // unloaded before the writer gets to the message
+        m_async->push(LogRecord{level, deepCopy(tag), deepCopy(message), QDateTime::currentMSecsSinceEpoch()});
+        if (level == Level::Error) {
+            flush();
+        }
+        return;
+    }
     
+    QMutexLocker locker(&m_mutex);
+    write(level, tag, message, QDateTime::currentDateTime());
+}
+
+void Logger::write(Level level, const QString& tag, const QString& message, const QDateTime& time)
+{
+    // Note: must be called with m_mutex held
     if (m_handler) {
         m_handler(level, tag, message);
         return;
     }
     
-    QString formatted = formatMessage(level, tag, message);
+    QString formatted = formatMessage(level, tag, message, time);
     
     switch (level) {
     case Level::Trace:
@@ -71,6 +277,34 @@ void Logger::setHandler(LogHandler handler)
     m_handler = std::move(handler);
 }
 
+void Logger::enableAsync(int queueSize)
+{
+    if (m_async) {
+        return;
+    }
+    
+    m_async = std::make_unique<AsyncLogWriter>(queueSize, [this](const LogRecord& record) {
+        QMutexLocker locker(&m_mutex);
+        write(record.level, record.tag, record.message, QDateTime::fromMSecsSinceEpoch(record.time));
+    });
+    
+    static const bool fatalHandlerInstalled = []() {
+        s_previousHandler = qInstallMessageHandler(flushOnFatal);
+        return true;
+    }();
+    Q_UNUSED(fatalHandlerInstalled);
+}
+
+bool Logger::flush(int timeoutMs)
+{
+    return !m_async || m_async->flush(timeoutMs);
+}
+
+quint64 Logger::droppedCount() const
+{
+    return m_async ? m_async->dropped() : 0;
+}
+
 void Logger::setFormat(const QString& format)
 {
     QMutexLocker locker(&m_mutex);
@@ -93,14 +327,14 @@ void Logger::setInstance(Logger* logger)
     s_instance = logger;
 }
 
-QString Logger::formatMessage(Level level, const QString& tag, const QString& message)
+QString Logger::formatMessage(Level level, const QString& tag, const QString& message, const QDateTime& time)
 {
     QString result = m_format;
     result.replace("%level%", levelToString(level));
     result.replace("%tag%", tag);
     result.replace("%message%", message);
-    result.replace("%time%", QDateTime::currentDateTime().toString("hh:mm:ss.zzz"));
-    result.replace("%date%", QDateTime::currentDateTime().toString("yyyy-MM-dd"));
+    result.replace("%time%", time.toString("hh:mm:ss.zzz"));
+    result.replace("%date%", time.toString("yyyy-MM-dd"));
     return result;
 }
 
@@ -1,4 +1,5 @@
 #include "application.h"
+#include <mpf/static_plugins.h>
 #include <QDebug>
 #include <QQuickStyle>
 
@@ -1,6 +1,8 @@
 #include "menu_service.h"
 #include "cross_dll_safety.h"
+#include "service_instrumentation.h"
 #include <algorithm>
+#include <QThread>
 #include <QDebug>
 
 namespace mpf {
@@ -32,6 +34,7 @@ MenuService::~MenuService() = default;
 
 bool MenuService::registerItem(const MenuItem& item)
 {
+    MPF_SERVICE_CALL("registerItem");
     if (item.id.isEmpty()) {
         qWarning() << "MenuService: Cannot register item with empty ID";
         return false;
@@ -57,12 +60,13 @@ bool MenuService::registerItem(const MenuItem& item)
     locker.unlock();
     
     qDebug() << "MenuService: Registered" << item.id << "from" << item.pluginId;
-    emit menuChanged();
+    notifyChanged();
     return true;
 }
 
 void MenuService::unregisterItem(const QString& id)
 {
+    MPF_SERVICE_CALL("unregisterItem");
     QMutexLocker locker(&m_mutex);
     
     auto it = std::find_if(m_items.begin(), m_items.end(),
@@ -79,12 +83,13 @@ void MenuService::unregisterItem(const QString& id)
         }
         
         locker.unlock();
-        emit menuChanged();
+        notifyChanged();
     }
 }
 
 void MenuService::unregisterPlugin(const QString& pluginId)
 {
+    MPF_SERVICE_CALL("unregisterPlugin");
     QMutexLocker locker(&m_mutex);
     
     auto it = std::remove_if(m_items.begin(), m_items.end(),
@@ -100,12 +105,13 @@ void MenuService::unregisterPlugin(const QString& pluginId)
         }
         
         locker.unlock();
-        emit menuChanged();
+        notifyChanged();
     }
 }
 
 bool MenuService::updateItem(const QString& id, const QVariantMap& updates)
 {
+    MPF_SERVICE_CALL("updateItem");
     QMutexLocker locker(&m_mutex);
     
     if (!m_indexMap.contains(id)) {
@@ -132,7 +138,7 @@ bool MenuService::updateItem(const QString& id, const QVariantMap& updates)
     if (updates.contains("group")) item.group = updates["group"].toString();
     
     locker.unlock();
-    emit menuChanged();
+    notifyChanged();
     return true;
 }
 
@@ -148,6 +154,7 @@ void MenuService::setEnabled(const QString& id, bool enabled)
 
 QList<MenuItem> MenuService::items() const
 {
+    MPF_SERVICE_CALL("items");
     QMutexLocker locker(&m_mutex);
     // Deep copy each item before returning
     QList<MenuItem> result;
@@ -160,6 +167,7 @@ QList<MenuItem> MenuService::items() const
 
 QVariantList MenuService::itemsAsVariant() const
 {
+    MPF_SERVICE_CALL("itemsAsVariant");
     QMutexLocker locker(&m_mutex);
     QVariantList result;
     for (const MenuItem& item : m_items) {
@@ -171,6 +179,7 @@ QVariantList MenuService::itemsAsVariant() const
 
 QVariantList MenuService::itemsInGroup(const QString& group) const
 {
+    MPF_SERVICE_CALL("itemsInGroup");
     QMutexLocker locker(&m_mutex);
     QVariantList result;
     for (const MenuItem& item : m_items) {
@@ -183,6 +192,7 @@ QVariantList MenuService::itemsInGroup(const QString& group) const
 
 QStringList MenuService::groups() const
 {
+    MPF_SERVICE_CALL("groups");
     QMutexLocker locker(&m_mutex);
     QSet<QString> groupSet;
     for (const MenuItem& item : m_items) {
@@ -195,10 +205,22 @@ QStringList MenuService::groups() const
 
 int MenuService::count() const
 {
+    MPF_SERVICE_CALL("count");
     QMutexLocker locker(&m_mutex);
     return m_items.size();
 }
 
+void MenuService::notifyChanged()
+{
+    // QML bindings on menuChanged() must run on our thread; thread-safe
+    // plugins register items from pool threads during parallel startup
+    if (QThread::currentThread() == thread()) {
+        emit menuChanged();
+    } else {
+        QMetaObject::invokeMethod(this, &MenuService::menuChanged, Qt::QueuedConnection);
+    }
+}
+
 void MenuService::sortItems()
 {
     std::stable_sort(m_items.begin(), m_items.end(),
@@ -1,6 +1,9 @@
 #include "navigation_service.h"
 #include "cross_dll_safety.h"
+#include "service_instrumentation.h"
+#include "plugin_context.h"
 #include <QQmlApplicationEngine>
+#include <QThread>
 #include <QDebug>
 
 namespace mpf {
@@ -17,37 +20,127 @@ NavigationService::~NavigationService() = default;
 
 void NavigationService::registerRoute(const QString& route, const QString& qmlPageUrl)
 {
-    // Deep copy strings from plugin to ensure they're in host's heap
-    RouteEntry entry{deepCopy(route), deepCopy(qmlPageUrl)};
-    m_routes.append(entry);
+    MPF_SERVICE_CALL("registerRoute");
+    QString pluginId = PluginContext::current();
+    {
+        // Deep copy strings from plugin to ensure they're in host's heap
+        QMutexLocker locker(&m_mutex);
+        m_routes.insert(deepCopy(route), deepCopy(qmlPageUrl), pluginId);
+    }
     qDebug() << "NavigationService: Registered route" << route << "->" << qmlPageUrl;
 }
 
 QString NavigationService::getPageUrl(const QString& route) const
 {
-    for (const RouteEntry& entry : m_routes) {
-        if (entry.pattern == route) {
-            qDebug() << "NavigationService: getPageUrl" << route << "->" << entry.pageUrl;
-            // Deep copy before returning to ensure caller gets memory from host's heap
-            return deepCopy(entry.pageUrl);
+    MPF_SERVICE_CALL("getPageUrl");
+    QString pageUrl;
+    QString pluginId;
+    bool found = findRoute(route, &pageUrl, &pluginId);
+    
+    // The route may belong to a plugin that is loaded on first use
+    if (!found && m_routeActivationHandler && m_routeActivationHandler(route)) {
+        found = findRoute(route, &pageUrl, &pluginId);
+    }
+    
+    if (found) {
+        if (m_routeUsageHandler && !pluginId.isEmpty()) {
+            m_routeUsageHandler(pluginId);
         }
+        // Deep copy before returning to ensure caller gets memory from host's heap
+        return deepCopy(pageUrl);
     }
     
     qWarning() << "NavigationService: No page URL found for route:" << route;
     return QString();
 }
 
+bool NavigationService::findRoute(const QString& route, QString* pageUrl, QString* pluginId,
+                                  QVariantMap* params, QString* pattern) const
+{
+    // The match points into the table, so copy out while it is locked
+    QMutexLocker locker(&m_mutex);
+    RouteTable::Match match = m_routes.match(route);
+    if (!match.route) {
+        return false;
+    }
+    if (pageUrl) *pageUrl = match.route->pageUrl;
+    if (pluginId) *pluginId = match.route->pluginId;
+    if (params) *params = match.params;
+    if (pattern) *pattern = match.route->pattern;
+    return true;
+}
+
+void NavigationService::setRouteActivationHandler(RouteActivationHandler handler)
+{
+    m_routeActivationHandler = std::move(handler);
+}
+
+void NavigationService::setRouteUsageHandler(PluginUsageHandler handler)
+{
+    m_routeUsageHandler = std::move(handler);
+}
+
+void NavigationService::unregisterPluginRoutes(const QString& pluginId)
+{
+    if (pluginId.isEmpty()) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    int removed = m_routes.removePlugin(pluginId);
+    locker.unlock();
+    if (removed > 0) {
+        qDebug() << "NavigationService: Removed" << removed << "routes of" << pluginId;
+    }
+}
+
+QString NavigationService::routeOwner(const QString& route) const
+{
+    QString pluginId;
+    findRoute(route, nullptr, &pluginId);
+    return pluginId;
+}
+
+QString NavigationService::routePattern(const QString& route) const
+{
+    QString pattern;
+    findRoute(route, nullptr, nullptr, nullptr, &pattern);
+    return pattern;
+}
+
+QVariantMap NavigationService::routeParams(const QString& route) const
+{
+    QVariantMap params;
+    findRoute(route, nullptr, nullptr, &params);
+    return params;
+}
+
 QString NavigationService::currentRoute() const
 {
+    MPF_SERVICE_CALL("currentRoute");
+    QMutexLocker locker(&m_mutex);
     return deepCopy(m_currentRoute);
 }
 
 void NavigationService::setCurrentRoute(const QString& route)
 {
+    MPF_SERVICE_CALL("setCurrentRoute");
     QString routeCopy = deepCopy(route);
-    if (m_currentRoute != routeCopy) {
-        m_currentRoute = routeCopy;
-        emit navigationChanged(routeCopy, {});
+    QMutexLocker locker(&m_mutex);
+    if (m_currentRoute == routeCopy) {
+        return;
+    }
+    m_currentRoute = routeCopy;
+    QVariantMap params = m_routes.match(routeCopy).params;
+    locker.unlock();
+    
+    // QML reacts to this; from a worker thread it is delivered on ours
+    if (QThread::currentThread() == thread()) {
+        emit navigationChanged(routeCopy, params);
+    } else {
+        QMetaObject::invokeMethod(this, [this, routeCopy, params]() {
+            emit navigationChanged(routeCopy, params);
+        }, Qt::QueuedConnection);
     }
 }
 
@@ -0,0 +1,198 @@
+#include "navigation_timings.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mpf {
+
+namespace {
+
+struct Phase
+{
+    const char* name;
+    qint64 NavigationTiming::*ns;
+};
+
+constexpr Phase kPhases[] = {
+    {"total", &NavigationTiming::totalNs},
+    {"resolve", &NavigationTiming::resolveNs},
+    {"compile", &NavigationTiming::compileNs},
+    {"create", &NavigationTiming::createNs},
+    {"frame", &NavigationTiming::frameNs},
+};
+
+double toMs(qint64 ns)
+{
+    return ns / 1.0e6;
+}
+
+// Nearest-rank percentile of sorted values
+qint64 percentile(const std::vector<qint64>& sorted, int p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = size_t(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+NavigationTimings::NavigationTimings(int capacity, QObject* parent)
+    : QObject(parent)
+    , m_ring(size_t(qMax(1, capacity)))
+{
+}
+
+void NavigationTimings::record(const NavigationTiming& timing)
+{
+    m_ring[size_t(m_next)] = timing;
+    m_next = (m_next + 1) % capacity();
+    m_size = qMin(m_size + 1, capacity());
+    emit recorded();
+}
+
+QList<NavigationTiming> NavigationTimings::recent() const
+{
+    QList<NavigationTiming> timings;
+    timings.reserve(m_size);
+    int first = (m_next - m_size + capacity()) % capacity();
+    for (int i = 0; i < m_size; ++i) {
+        timings.append(m_ring[size_t((first + i) % capacity())]);
+    }
+    return timings;
+}
+
+QVariantList NavigationTimings::history() const
+{
+    const QList<NavigationTiming> timings = recent();
+    
+    QVariantList entries;
+    entries.reserve(timings.size());
+    for (auto it = timings.crbegin(); it != timings.crend(); ++it) {
+        QVariantMap entry;
+        entry["route"] = it->route;
+        entry["pattern"] = it->pattern;
+        entry["timestamp"] = it->timestamp;
+        entry["cached"] = it->cached;
+        entry["failed"] = it->failed;
+        for (const Phase& phase : kPhases) {
+            entry[QString::fromLatin1(phase.name) + "Ms"] = toMs((*it).*phase.ns);
+        }
+        entries.append(entry);
+    }
+    return entries;
+}
+
+QVariantList NavigationTimings::summary() const
+{
+    // Concrete routes of one pattern (orders/1, orders/2) share a row
+    QHash<QString, QList<NavigationTiming>> byPattern;
+    for (const NavigationTiming& timing : recent()) {
+        byPattern[timing.pattern.isEmpty() ? timing.route : timing.pattern].append(timing);
+    }
+    
+    QVariantList rows;
+    for (auto it = byPattern.constBegin(); it != byPattern.constEnd(); ++it) {
+        QVariantMap row;
+        row["route"] = it.key();
+        row["count"] = it->size();
+        row["cached"] = int(std::count_if(it->begin(), it->end(), [](const NavigationTiming& t) {
+            return t.cached;
+        }));
+        row["failed"] = int(std::count_if(it->begin(), it->end(), [](const NavigationTiming& t) {
+            return t.failed;
+        }));
+        
+        for (const Phase& phase : kPhases) {
+            std::vector<qint64> values;
+            for (const NavigationTiming& timing : *it) {
+                if (!timing.failed) {
+                    values.push_back(timing.*phase.ns);
+                }
+            }
+            std::sort(values.begin(), values.end());
+            
+            QString name = QString::fromLatin1(phase.name);
+            row[name + "P50Ms"] = toMs(percentile(values, 50));
+            row[name + "P90Ms"] = toMs(percentile(values, 90));
+            row[name + "P99Ms"] = toMs(percentile(values, 99));
+            if (phase.ns == &NavigationTiming::totalNs) {
+                row["totalMaxMs"] = toMs(values.empty() ? 0 : values.back());
+            }
+        }
+        rows.append(row);
+    }
+    
+    std::sort(rows.begin(), rows.end(), [](const QVariant& a, const QVariant& b) {
+        return a.toMap()["totalP90Ms"].toDouble() > b.toMap()["totalP90Ms"].toDouble();
+    });
+    return rows;
+}
+
+void NavigationTimings::reset()
+{
+    std::fill(m_ring.begin(), m_ring.end(), NavigationTiming());
+    m_next = 0;
+    m_size = 0;
+    emit recorded();
+}
+
+QString NavigationTimings::report() const
+{
+    const QVariantList rows = summary();
+    
+    QStringList lines;
+    lines << QString("Navigation timings (%1 navigations, %2 route patterns, sorted by p90)")
+                 .arg(m_size).arg(rows.size());
+    lines << QString::asprintf("%6s %6s %6s %10s %10s %10s %10s %12s %12s %12s %12s  %s",
+                               "count", "cached", "failed", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)",
+                               "resolve p90", "compile p90", "create p90", "frame p90", "route");
+    
+    for (const QVariant& value : rows) {
+        QVariantMap row = value.toMap();
+        lines << QString::asprintf("%6d %6d %6d %10.2f %10.2f %10.2f %10.2f %12.2f %12.2f %12.2f %12.2f  ",
+                                   row["count"].toInt(),
+                                   row["cached"].toInt(),
+                                   row["failed"].toInt(),
+                                   row["totalP50Ms"].toDouble(),
+                                   row["totalP90Ms"].toDouble(),
+                                   row["totalP99Ms"].toDouble(),
+                                   row["totalMaxMs"].toDouble(),
+                                   row["resolveP90Ms"].toDouble(),
+                                   row["compileP90Ms"].toDouble(),
+                                   row["createP90Ms"].toDouble(),
+                                   row["frameP90Ms"].toDouble())
+                 + row["route"].toString();
+    }
+    
+    return lines.join('\n');
+}
+
+bool NavigationTimings::write(const QString& path) const
+{
+    QJsonObject root;
+    root["capacity"] = capacity();
+    root["navigations"] = QJsonArray::fromVariantList(history());
+    root["routes"] = QJsonArray::fromVariantList(summary());
+    
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write navigation timings:" << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    
+    qDebug() << "Navigation timings of" << m_size << "navigations written to" << path;
+    return true;
+}
+
+} // namespace mpf
@@ -0,0 +1,502 @@
+#include "page_cache.h"
+#include "navigation_service.h"
+#include "process_memory.h"
+
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQmlIncubator>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QDateTime>
+#include <QUrl>
+#include <QDebug>
+
+namespace mpf {
+
+namespace {
+
+// Resident memory grows in whole pages and often not at all for a small
+// page, so every page is assumed to cost at least this much
+constexpr qint64 kMinPageCost = 256 * 1024;
+
+QString errorString(const QList<QQmlError>& errors)
+{
+    QStringList messages;
+    for (const QQmlError& error : errors) {
+        messages.append(error.toString());
+    }
+    return messages.join('\n');
+}
+
+} // namespace
+
+/**
+ * @brief Incubator that hands finished pages back to the cache
+ */
+class PageIncubator : public QQmlIncubator
+{
+public:
+    PageIncubator(PageCache* cache, const QVariantMap& routeParams)
+        : QQmlIncubator(Asynchronous)
+        , m_cache(cache)
+        , m_routeParams(routeParams)
+    {
+    }
+
+protected:
+    void setInitialState(QObject* object) override
+    {
+        // Parameters of the route ("orders/:id"), for pages that declare
+        // property var routeParams
+        if (object->metaObject()->indexOfProperty("routeParams") >= 0) {
+            object->setProperty("routeParams", m_routeParams);
+        }
+    }
+
+    void statusChanged(Status status) override
+    {
+        // The incubator must not be destroyed inside its own callback
+        if (status == Ready || status == Error) {
+            QMetaObject::invokeMethod(m_cache, [cache = m_cache]() { cache->incubated(); },
+                                      Qt::QueuedConnection);
+        }
+    }
+
+private:
+    PageCache* m_cache;
+    QVariantMap m_routeParams;
+};
+
+PageCache::PageCache(QQmlEngine* engine, NavigationService* navigation, QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_navigation(navigation)
+    , m_budget(64 * 1024 * 1024)
+    , m_timings(new NavigationTimings(256, this))
+{
+    // A route set elsewhere (e.g. by a plugin) is shown as well
+    if (m_navigation) {
+        connect(m_navigation, &NavigationService::navigationChanged, this, [this](const QString& route) {
+            if (route != m_currentRoute) {
+                show(route);
+            }
+        });
+    }
+}
+
+PageCache::~PageCache()
+{
+    cancelJob();
+    for (const Page& page : std::as_const(m_pages)) {
+        delete page.item;
+    }
+    for (const CachedComponent& cached : std::as_const(m_components)) {
+        delete cached.component;
+    }
+}
+
+void PageCache::setContainer(QQuickItem* container)
+{
+    if (m_container == container) {
+        return;
+    }
+    
+    if (m_container) {
+        disconnect(m_container, nullptr, this, nullptr);
+    }
+    m_container = container;
+    if (m_container) {
+        connect(m_container, &QQuickItem::widthChanged, this, &PageCache::fitToContainer);
+        connect(m_container, &QQuickItem::heightChanged, this, &PageCache::fitToContainer);
+    }
+    
+    for (const Page& page : std::as_const(m_pages)) {
+        page.item->setParentItem(m_container);
+    }
+    fitToContainer();
+    emit containerChanged();
+}
+
+qint64 PageCache::memoryUsed() const
+{
+    qint64 used = 0;
+    for (const Page& page : m_pages) {
+        used += page.cost;
+    }
+    return used;
+}
+
+void PageCache::setBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(0, bytes);
+    evict();
+}
+
+void PageCache::show(const QString& route)
+{
+    if (route != m_currentRoute) {
+        m_currentRoute = route;
+        emit currentRouteChanged();
+    }
+    if (m_navigation) {
+        m_navigation->setCurrentRoute(route);
+    }
+    
+    if (route.isEmpty()) {
+        m_measurement.reset();
+        setCurrentItem(nullptr);
+        setLoading(false);
+        return;
+    }
+    
+    beginMeasurement(route);
+    
+    qsizetype index = indexOf(route);
+    if (index >= 0) {
+        m_pages.move(index, 0);
+        setCurrentItem(m_pages.first().item);
+        setLoading(false);
+        qDebug() << "PageCache: Showing cached page" << route;
+        m_measurement->timing.cached = true;
+        awaitFrame();
+        return;
+    }
+    
+    setCurrentItem(nullptr);
+    setLoading(true);
+    if (!m_job || m_job->route != route) {
+        enqueue(route, true);
+    }
+    startNext();
+}
+
+void PageCache::prefetch(const QString& route)
+{
+    if (route.isEmpty() || indexOf(route) >= 0 || m_queue.contains(route)
+        || (m_job && m_job->route == route)) {
+        return;
+    }
+    
+    enqueue(route, false);
+    startNext();
+}
+
+void PageCache::releasePlugin(const QString& pluginId)
+{
+    if (pluginId.isEmpty()) {
+        return;
+    }
+    
+    // Leave the plugin's page (shown or still being created) so nothing
+    // shown refers to it
+    qsizetype current = indexOf(m_currentRoute);
+    bool showing = current >= 0 ? m_pages.at(current).pluginId == pluginId
+                                : m_job && m_job->pluginId == pluginId && m_job->route == m_currentRoute;
+    if (m_job && m_job->pluginId == pluginId) {
+        cancelJob();
+    }
+    if (showing) {
+        show(QString());
+    }
+    
+    int released = 0;
+    for (qsizetype i = m_pages.size() - 1; i >= 0; --i) {
+        if (m_pages.at(i).pluginId == pluginId) {
+            destroyPage(m_pages.takeAt(i));
+            released++;
+        }
+    }
+    for (auto it = m_components.begin(); it != m_components.end();) {
+        if (it->pluginId == pluginId) {
+            delete it->component;
+            it = m_components.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    if (released > 0) {
+        qDebug() << "PageCache: Released" << released << "pages of" << pluginId;
+        emit pagesChanged();
+    }
+    m_engine->collectGarbage();
+    startNext();
+}
+
+qsizetype PageCache::indexOf(const QString& route) const
+{
+    for (qsizetype i = 0; i < m_pages.size(); ++i) {
+        if (m_pages.at(i).route == route) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PageCache::enqueue(const QString& route, bool urgent)
+{
+    m_queue.removeAll(route);
+    if (urgent) {
+        m_queue.prepend(route);
+    } else {
+        m_queue.append(route);
+    }
+}
+
+void PageCache::startNext()
+{
+    while (!m_job && !m_queue.isEmpty()) {
+        QString route = m_queue.takeFirst();
+        if (indexOf(route) >= 0) {
+            continue;
+        }
+        
+        // May load the plugin that owns the route
+        QElapsedTimer timer;
+        timer.start();
+        QString url = m_navigation ? m_navigation->getPageUrl(route) : QString();
+        if (url.isEmpty()) {
+            fail(route, "No page registered for route");
+            continue;
+        }
+        
+        m_job = std::make_unique<Job>();
+        m_job->route = route;
+        m_job->url = url;
+        m_job->pluginId = m_navigation->routeOwner(route);
+        m_job->residentBefore = residentMemory();
+        m_job->timer = timer;
+        m_job->resolveNs = timer.nsecsElapsed();
+        
+        CachedComponent& cached = m_components[url];
+        if (!cached.component) {
+            emit aboutToCompile(url);
+            cached.component = new QQmlComponent(m_engine, QUrl(url), QQmlComponent::Asynchronous);
+            cached.pluginId = m_job->pluginId;
+        }
+        m_job->component = cached.component;
+        
+        if (cached.component->isLoading()) {
+            QQmlComponent* component = cached.component;
+            connect(component, &QQmlComponent::statusChanged, this, [this, component]() {
+                if (m_job && m_job->component == component && !component->isLoading()) {
+                    createPage();
+                }
+            });
+        } else {
+            createPage();
+        }
+    }
+}
+
+void PageCache::createPage()
+{
+    QQmlComponent* component = m_job->component;
+    disconnect(component, &QQmlComponent::statusChanged, this, nullptr);
+    m_job->compileNs = m_job->timer.nsecsElapsed() - m_job->resolveNs;
+    
+    if (component->isError()) {
+        // Compile again next time, the file may have been fixed
+        QString route = m_job->route;
+        QString error = errorString(component->errors());
+        m_components.remove(m_job->url);
+        m_job.reset();
+        component->deleteLater();
+        fail(route, error);
+        startNext();
+        return;
+    }
+    
+    QVariantMap params = m_navigation ? m_navigation->routeParams(m_job->route) : QVariantMap();
+    m_job->incubator = std::make_unique<PageIncubator>(this, params);
+    component->create(*m_job->incubator);
+}
+
+void PageCache::incubated()
+{
+    // Ignore notifications for a job that was cancelled meanwhile
+    if (!m_job || !m_job->incubator || m_job->incubator->isLoading() || m_job->incubator->isNull()) {
+        return;
+    }
+    
+    std::unique_ptr<Job> job = std::move(m_job);
+    if (job->incubator->isError()) {
+        fail(job->route, errorString(job->incubator->errors()));
+        startNext();
+        return;
+    }
+    
+    QObject* object = job->incubator->object();
+    auto* item = qobject_cast<QQuickItem*>(object);
+    if (!item) {
+        delete object;
+        fail(job->route, "Page root is not an Item");
+        startNext();
+        return;
+    }
+    
+    qint64 createNs = job->timer.nsecsElapsed() - job->resolveNs - job->compileNs;
+    QQmlEngine::setObjectOwnership(item, QQmlEngine::CppOwnership);
+    item->setVisible(false);
+    item->setParentItem(m_container);
+    
+    qint64 resident = residentMemory();
+    qint64 cost = job->residentBefore >= 0 && resident >= 0 ? resident - job->residentBefore : 0;
+    m_pages.prepend(Page{job->route, job->url, job->pluginId, item, qMax(cost, kMinPageCost)});
+    qDebug() << "PageCache: Created page" << job->route << "in"
+             << QString::number(job->timer.nsecsElapsed() / 1.0e6, 'f', 2) << "ms, ~"
+             << m_pages.first().cost / 1024 << "KiB";
+    
+    if (job->route == m_currentRoute) {
+        setCurrentItem(item);
+        setLoading(false);
+        if (m_measurement && m_measurement->timing.route == job->route) {
+            m_measurement->timing.resolveNs = job->resolveNs;
+            m_measurement->timing.compileNs = job->compileNs;
+            m_measurement->timing.createNs = createNs;
+            awaitFrame();
+        }
+    }
+    evict();
+    emit pagesChanged();
+    startNext();
+}
+
+void PageCache::fail(const QString& route, const QString& error)
+{
+    qWarning().noquote() << "PageCache: Failed to load page" << route << "-" << error;
+    if (route == m_currentRoute) {
+        setLoading(false);
+        if (m_measurement && m_measurement->timing.route == route) {
+            finishMeasurement(true);
+        }
+    }
+    emit loadFailed(route, error);
+}
+
+void PageCache::setCurrentItem(QQuickItem* item)
+{
+    if (m_currentItem == item) {
+        return;
+    }
+    
+    if (m_currentItem) {
+        m_currentItem->setVisible(false);
+    }
+    m_currentItem = item;
+    if (m_currentItem) {
+        fitToContainer();
+        m_currentItem->setVisible(true);
+    }
+    emit currentItemChanged();
+}
+
+void PageCache::setLoading(bool loading)
+{
+    if (m_loading != loading) {
+        m_loading = loading;
+        emit loadingChanged();
+    }
+}
+
+void PageCache::fitToContainer()
+{
+    if (m_container && m_currentItem) {
+        m_currentItem->setSize(m_container->size());
+    }
+}
+
+void PageCache::evict()
+{
+    // Evicted pages are deleted right away: none of them is the page shown,
+    // and a plugin library may be unloaded before a deferred delete runs
+    qint64 used = memoryUsed();
+    bool evicted = false;
+    for (qsizetype i = m_pages.size() - 1; i >= 0 && used > m_budget; --i) {
+        if (m_pages.at(i).item == m_currentItem) {
+            continue;
+        }
+        Page page = m_pages.takeAt(i);
+        used -= page.cost;
+        qDebug() << "PageCache: Evicted page" << page.route << "(" << page.cost / 1024 << "KiB )";
+        destroyPage(page);
+        evicted = true;
+    }
+    
+    if (evicted) {
+        emit pagesChanged();
+    }
+}
+
+void PageCache::destroyPage(const Page& page)
+{
+    page.item->setParentItem(nullptr);
+    delete page.item;
+}
+
+void PageCache::cancelJob()
+{
+    if (!m_job) {
+        return;
+    }
+    
+    // clear() aborts incubation but leaves an already created object alive
+    if (m_job->incubator && m_job->incubator->isReady()) {
+        delete m_job->incubator->object();
+    }
+    m_job.reset();
+}
+
+void PageCache::beginMeasurement(const QString& route)
+{
+    // A navigation that has not reached its frame yet is superseded and dropped
+    m_measurement = std::make_unique<Measurement>();
+    m_measurement->id = ++m_lastMeasurementId;
+    m_measurement->timing.route = route;
+    m_measurement->timing.timestamp = QDateTime::currentMSecsSinceEpoch();
+    m_measurement->timer.start();
+}
+
+void PageCache::awaitFrame()
+{
+    m_measurement->shownNs = m_measurement->timer.nsecsElapsed();
+    
+    QQuickWindow* window = m_container ? m_container->window() : nullptr;
+    if (!window || !window->isExposed()) {
+        finishMeasurement(false);
+        return;
+    }
+    
+    // frameSwapped comes from the render thread; the queued delivery adds a
+    // little to the frame phase but keeps the measurement on this thread
+    int id = m_measurement->id;
+    connect(window, &QQuickWindow::frameSwapped, this, [this, id]() {
+        if (m_measurement && m_measurement->id == id) {
+            finishMeasurement(false);
+        }
+    }, Qt::SingleShotConnection);
+    window->update();
+}
+
+void PageCache::finishMeasurement(bool failed)
+{
+    std::unique_ptr<Measurement> measurement = std::move(m_measurement);
+    NavigationTiming& timing = measurement->timing;
+    timing.totalNs = measurement->timer.nsecsElapsed();
+    timing.frameNs = failed ? 0 : timing.totalNs - measurement->shownNs;
+    timing.failed = failed;
+    timing.pattern = m_navigation ? m_navigation->routePattern(timing.route) : QString();
+    m_timings->record(timing);
+    
+    if (!failed) {
+        qDebug().noquote() << "PageCache: Navigated to" << timing.route << "in"
+                           << QString::number(timing.totalNs / 1.0e6, 'f', 2) << "ms (resolve"
+                           << QString::number(timing.resolveNs / 1.0e6, 'f', 2) << "/ compile"
+                           << QString::number(timing.compileNs / 1.0e6, 'f', 2) << "/ create"
+                           << QString::number(timing.createNs / 1.0e6, 'f', 2) << "/ frame"
+                           << QString::number(timing.frameNs / 1.0e6, 'f', 2) << "ms"
+                           << (timing.cached ? ", cached)" : ")");
+    }
+}
+
+} // namespace mpf
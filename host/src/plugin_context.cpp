@@ -0,0 +1,12 @@
+#include "plugin_context.h"
+
+namespace mpf {
+
+thread_local QString PluginContext::s_current;
+
+QString PluginContext::current()
+{
+    return s_current;
+}
+
+} // namespace mpf
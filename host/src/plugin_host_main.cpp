@@ -0,0 +1,129 @@
+// mpf-plugin-host: runs a single plugin outside the host process (see RemotePlugin)
+
+#include "remote_channel.h"
+#include "remote_service_proxies.h"
+#include <mpf/interfaces/iplugin.h>
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QPluginLoader>
+#include <QDebug>
+
+namespace {
+
+QVariantMap runBenchmark(mpf::RemoteChannel* channel, mpf::ServiceRegistry* registry, int iterations)
+{
+    auto* settings = registry->get<mpf::ISettings>();
+    auto* eventBus = registry->get<mpf::IEventBus>();
+    
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        settings->value("benchmark", "key");
+    }
+    qint64 callNs = timer.nsecsElapsed();
+    
+    // Large enough to go through shared memory
+    QVariantMap payload{{"blob", QByteArray(256 * 1024, 'x')}};
+    qint64 transfersBefore = channel->sharedMemoryTransfers();
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        eventBus->publish("benchmark/payload", payload, "benchmark");
+    }
+    qint64 payloadNs = timer.nsecsElapsed();
+    
+    return {
+        {"callNs", callNs},
+        {"payloadNs", payloadNs},
+        {"sharedTransfers", channel->sharedMemoryTransfers() - transfersBefore}
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // Plugins may create QML or GUI objects, but nothing is shown from here
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.addOption({"server", "Local server of the host process.", "name"});
+    parser.addOption({"plugin", "Plugin library to run.", "path"});
+    parser.addOption({"benchmark", "Serve call latency benchmarks instead of a plugin."});
+    parser.process(app);
+    
+    auto* socket = new QLocalSocket;
+    socket->connectToServer(parser.value("server"));
+    if (!socket->waitForConnected(10000)) {
+        qCritical() << "mpf-plugin-host: Cannot connect to" << parser.value("server") << socket->errorString();
+        return 1;
+    }
+    
+    mpf::RemoteChannel channel(socket);
+    mpf::RemoteServiceRegistry registry(&channel);
+    QObject::connect(&channel, &mpf::RemoteChannel::disconnected, &app, &QCoreApplication::quit);
+    
+    mpf::IPlugin* plugin = nullptr;
+    QPluginLoader loader(parser.value("plugin"));
+    if (parser.isSet("plugin")) {
+        plugin = qobject_cast<mpf::IPlugin*>(loader.instance());
+        if (!plugin && loader.instance()) {
+            // Built against the previous SDK ABI, whose vtable slots are kept
+            plugin = static_cast<mpf::IPlugin*>(loader.instance()->qt_metacast(MPF_IPlugin_iid_v1));
+        }
+        if (!plugin) {
+            qCritical() << "mpf-plugin-host: Cannot load" << loader.fileName() << loader.errorString();
+            return 1;
+        }
+    }
+    
+    channel.setNotificationHandler([&registry](const QString& service, const QString& method,
+                                               const QVariantList& args) {
+        if (service == "IEventBus" && method == "eventPublished") {
+            registry.eventBus()->deliver(args.value(0).toString(), args.value(1).toMap(),
+                                         args.value(2).toString());
+        }
+        return QVariant();
+    });
+    
+    channel.setCallHandler([&](const QString& service, const QString& method,
+                               const QVariantList& args) -> QVariant {
+        if (service == "Benchmark" && method == "run" && parser.isSet("benchmark")) {
+            return runBenchmark(&channel, &registry, args.value(0).toInt());
+        }
+        if (service != "Plugin" || !plugin) {
+            qWarning() << "mpf-plugin-host: Unknown call" << service + "::" + method;
+            return QVariant();
+        }
+        
+        if (method == "initialize") {
+            bool ok = plugin->initialize(&registry);
+            return QVariantMap{
+                {"ok", ok},
+                {"qmlModuleUri", plugin->qmlModuleUri()},
+                {"entryQml", plugin->entryQml()}
+            };
+        }
+        if (method == "start") {
+            return plugin->start();
+        }
+        if (method == "stop") {
+            plugin->stop();
+            return true;    // An invalid reply means the host gave up waiting
+        }
+        return QVariant();
+    });
+    
+    int result = app.exec();
+    
+    // The plugin's objects must go before its library
+    if (plugin) {
+        loader.unload();
+    }
+    return result;
+}
@@ -1,6 +1,8 @@
 #include "plugin_loader.h"
 #include <mpf/interfaces/iplugin.h>
 #include "plugin_metadata.h"
+#include "remote_plugin.h"
+#include "startup_profiler.h"
 
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -8,6 +10,26 @@
 
 namespace mpf {
 
+namespace {
+
+// What a plugin would offer only inside its plugin host: services it
+// registers, and QML types it registers from C++. Its QML modules render
+// here from the mapped library, so a plugin that declares "outOfProcess"
+// itself (and keeps its QML free of C++ types) may list them.
+QString outOfProcessLimitation(const PluginMetadata& metadata)
+{
+    if (!metadata.provides().isEmpty()) {
+        return QString("provides services (%1)").arg(metadata.provides().join(", "));
+    }
+    if (!metadata.qmlModules().isEmpty() && !metadata.outOfProcess()) {
+        return QString("declares QML modules (%1) without \"outOfProcess\" in its metadata")
+            .arg(metadata.qmlModules().join(", "));
+    }
+    return QString();
+}
+
+} // namespace
+
 PluginLoader::PluginLoader(const QString& path, QObject* parent)
     : QObject(parent)
     , m_path(path)
@@ -16,6 +38,14 @@ PluginLoader::PluginLoader(const QString& path, QObject* parent)
 {
 }
 
+PluginLoader::PluginLoader(const QStaticPlugin& plugin, QObject* parent)
+    : QObject(parent)
+    , m_path("static:" + plugin.metaData().value("className").toString())
+    , m_staticPlugin(plugin)
+    , m_metadata(std::make_unique<PluginMetadata>())
+{
+}
+
 PluginLoader::~PluginLoader()
 {
     if (isLoaded()) {
@@ -29,9 +59,14 @@ bool PluginLoader::load()
         return true;
     }
 
-    // Load metadata from plugin
-    QJsonObject metaJson = m_loader->metaData().value("MetaData").toObject();
-    *m_metadata = PluginMetadata(metaJson);
+    MPF_PROFILE_SCOPE("load " + QFileInfo(m_path).fileName(), "plugin");
+    
+    // Load metadata from plugin unless discovery already provided it
+    if (!m_metadata->isValid()) {
+        QJsonObject rawMetaData = m_loader ? m_loader->metaData() : m_staticPlugin->metaData();
+        QJsonObject metaJson = rawMetaData.value("MetaData").toObject();
+        *m_metadata = PluginMetadata(metaJson);
+    }
     
     // Validate metadata
     QStringList errors = m_metadata->validate();
@@ -42,29 +77,63 @@ bool PluginLoader::load()
         return false;
     }
 
-    // Load the plugin
-    if (!m_loader->load()) {
+    if (m_metadata->outOfProcess() && !isStatic() && !isOutOfProcess()) {
+        qWarning().noquote() << QString("Plugin %1 asks to run out of process but %2; running it in process")
+            .arg(m_metadata->id(), outOfProcessLimitation(*m_metadata));
+    }
+
+    // Load the plugin (static plugins are already part of the executable)
+    bool loaded = true;
+    if (m_loader) {
+        MPF_PROFILE_SCOPE("dlopen " + QFileInfo(m_path).fileName(), "plugin");
+        loaded = m_loader->load();
+    }
+    if (!loaded) {
         m_errorString = m_loader->errorString();
         m_state = State::Error;
         emit errorOccurred(m_errorString);
         return false;
     }
 
+    // Out of process: the library stays mapped only for its QML resources
+    if (isOutOfProcess()) {
+        m_remote = std::make_unique<RemotePlugin>(m_path, m_metadata->toJson());
+        m_plugin = m_remote.get();
+        m_state = State::Loaded;
+        emit stateChanged(m_state);
+        return true;
+    }
+    
     // Get the plugin instance
-    QObject* instance = m_loader->instance();
+    QObject* instance;
+    {
+        MPF_PROFILE_SCOPE("instantiate " + QFileInfo(m_path).fileName(), "plugin");
+        instance = m_loader ? m_loader->instance() : m_staticPlugin->instance();
+    }
     if (!instance) {
         m_errorString = "Failed to get plugin instance";
         m_state = State::Error;
-        m_loader->unload();
+        if (m_loader) {
+            m_loader->unload();
+        }
         emit errorOccurred(m_errorString);
         return false;
     }
 
     m_plugin = qobject_cast<IPlugin*>(instance);
     if (!m_plugin) {
-        m_errorString = "Plugin does not implement IPlugin interface";
+        // Built against the previous SDK ABI, whose vtable slots are kept
+        m_plugin = static_cast<IPlugin*>(instance->qt_metacast(MPF_IPlugin_iid_v1));
+    }
+    if (!m_plugin) {
+        // E.g. built against a newer SDK than the host's
+        QJsonObject raw = m_loader ? m_loader->metaData() : m_staticPlugin->metaData();
+        m_errorString = QString("Plugin does not implement a supported IPlugin interface (%1, host supports %2)")
+            .arg(raw.value("IID").toString(), QLatin1String(MPF_IPlugin_iid));
         m_state = State::Error;
-        m_loader->unload();
+        if (m_loader) {
+            m_loader->unload();
+        }
         emit errorOccurred(m_errorString);
         return false;
     }
@@ -74,6 +143,32 @@ bool PluginLoader::load()
     return true;
 }
 
+void PluginLoader::setMetadata(const PluginMetadata& metadata)
+{
+    *m_metadata = metadata;
+}
+
+void PluginLoader::setOutOfProcess(bool outOfProcess)
+{
+    if (outOfProcess && isStatic()) {
+        qWarning() << "Plugin linked into the host cannot run out of process:" << m_path;
+        return;
+    }
+    QString limitation = outOfProcessLimitation(*m_metadata);
+    if (outOfProcess && !limitation.isEmpty()) {
+        qWarning().noquote() << QString("Plugin %1 cannot run out of process: it %2, which would exist "
+                                        "only in its plugin host").arg(m_metadata->id(), limitation);
+        return;
+    }
+    m_outOfProcess = outOfProcess;
+}
+
+bool PluginLoader::isOutOfProcess() const
+{
+    return !isStatic() && (m_outOfProcess || m_metadata->outOfProcess())
+        && outOfProcessLimitation(*m_metadata).isEmpty();
+}
+
 bool PluginLoader::unload()
 {
     if (m_state == State::Unloaded) {
@@ -81,8 +176,10 @@ bool PluginLoader::unload()
     }
 
     m_plugin = nullptr;
+    m_remote.reset();   // Stops the plugin host process
     
-    if (!m_loader->unload()) {
+    // A static plugin's instance lives as long as the process
+    if (m_loader && !m_loader->unload()) {
         m_errorString = m_loader->errorString();
         emit errorOccurred(m_errorString);
         return false;
@@ -2,19 +2,39 @@
 #include "plugin_loader.h"
 #include "service_registry.h"
 #include "plugin_metadata.h"
+#include "plugin_metadata_cache.h"
+#include "startup_profiler.h"
+#include "plugin_context.h"
+#include "navigation_service.h"
+#include "process_memory.h"
+#include "resource_monitor.h"
+#include "lifecycle_watchdog.h"
 #include <mpf/interfaces/iplugin.h>
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/ieventbus.h>
+#include <mpf/interfaces/inavigation.h>
 
 #include <QDir>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QThread>
+#include <QSet>
+#include <QTimer>
+#include <QFileSystemWatcher>
 #include <QDebug>
 #include <algorithm>
+#include <cctype>
+#include <utility>
 
 namespace mpf {
 
 PluginManager::PluginManager(ServiceRegistry* registry, QObject* parent)
     : QObject(parent)
     , m_registry(registry)
+    , m_watchdog(std::make_unique<LifecycleWatchdog>())
 {
+    m_clock.start();
 }
 
 PluginManager::~PluginManager()
@@ -23,70 +43,237 @@ PluginManager::~PluginManager()
     unloadAll();
 }
 
-int PluginManager::discover(const QString& path)
+namespace {
+
+// Lifecycle budget from metadata "timeouts", else the host default
+qint64 phaseBudgetMs(const PluginMetadata& metadata, const QString& phase)
 {
-    QDir dir(path);
-    if (!dir.exists()) {
-        qWarning() << "Plugin directory does not exist:" << path;
-        return 0;
-    }
+    qint64 budget = metadata.timeoutMs(phase);
+    return budget >= 0 ? budget : LifecycleWatchdog::defaultBudgetMs(phase);
+}
 
-    int count = 0;
-    
-    // Platform-specific plugin patterns
+// Platform-specific plugin patterns
+QStringList pluginFilters()
+{
 #if defined(Q_OS_WIN)
-    QStringList filters = {"*.dll"};
+    return {"*.dll"};
 #elif defined(Q_OS_MACOS)
-    QStringList filters = {"*.dylib", "*.bundle"};
+    return {"*.dylib", "*.bundle"};
 #else
-    QStringList filters = {"*.so"};
+    return {"*.so"};
 #endif
+}
 
-    for (const QFileInfo& info : dir.entryInfoList(filters, QDir::Files)) {
-        QString pluginPath = info.absoluteFilePath();
-        
-        auto loader = std::make_unique<PluginLoader>(pluginPath, this);
-        
-        // Try to read metadata without fully loading
-        QPluginLoader tempLoader(pluginPath);
-        QJsonObject meta = tempLoader.metaData().value("MetaData").toObject();
-        
-        if (meta.isEmpty()) {
-            qDebug() << "Skipping non-MPF plugin:" << info.fileName();
+// A plugin file found during discovery and its parsed metadata
+struct DiscoveryCandidate
+{
+    QFileInfo info;
+    int pathIndex = 0;
+    QJsonObject meta;
+    PluginMetadata metadata;
+};
+
+} // namespace
+
+int PluginManager::discover(const QString& path)
+{
+    return discover(QStringList{path});
+}
+
+int PluginManager::discover(const QStringList& paths)
+{
+    MPF_PROFILE_SCOPE("discover", "plugin");
+    QElapsedTimer timer;
+    timer.start();
+    
+    m_searchPaths.append(paths);
+    
+    // List candidate files in precedence order (earlier paths win)
+    std::vector<DiscoveryCandidate> candidates;
+    for (int i = 0; i < paths.size(); ++i) {
+        QDir dir(paths.at(i));
+        if (!dir.exists()) {
+            qWarning() << "Plugin directory does not exist:" << paths.at(i);
             continue;
         }
+        for (const QFileInfo& info : dir.entryInfoList(pluginFilters(), QDir::Files)) {
+            DiscoveryCandidate candidate;
+            candidate.info = info;
+            candidate.pathIndex = i;
+            candidates.push_back(std::move(candidate));
+        }
+    }
 
-        PluginMetadata metadata(meta);
-        if (!metadata.isValid()) {
-            qWarning() << "Invalid plugin metadata:" << info.fileName();
+    // Read and parse metadata on worker threads; each task owns one slot
+    QThreadPool pool;
+    for (DiscoveryCandidate& candidate : candidates) {
+        pool.start([this, &candidate]() {
+            candidate.meta = readMetaData(candidate.info);
+            if (!candidate.meta.isEmpty()) {
+                candidate.metadata = PluginMetadata(candidate.meta);
+            }
+        });
+    }
+    pool.waitForDone();
+    
+    // Merge serially in listing order so registration is deterministic
+    QList<int> perPath(paths.size(), 0);
+    int count = 0;
+    for (const DiscoveryCandidate& candidate : candidates) {
+        if (candidate.meta.isEmpty()) {
+            qDebug() << "Skipping non-MPF plugin:" << candidate.info.fileName();
             continue;
         }
 
-        QString id = metadata.id();
+        if (!candidate.metadata.isValid()) {
+            qWarning() << "Invalid plugin metadata:" << candidate.info.fileName();
+            continue;
+        }
+
+        QString id = candidate.metadata.id();
         
         if (m_pluginMap.contains(id)) {
             qWarning() << "Duplicate plugin ID:" << id;
             continue;
         }
 
+        auto loader = std::make_unique<PluginLoader>(candidate.info.absoluteFilePath(), this);
+        loader->setMetadata(candidate.metadata);
+        
         m_pluginMap[id] = loader.get();
         m_loaders.push_back(std::move(loader));
+        invalidateLoadOrder();
+        m_lastUsed.insert(id, std::make_shared<QAtomicInteger<qint64>>(m_clock.elapsed()));
         
         emit pluginDiscovered(id);
+        perPath[candidate.pathIndex]++;
         count++;
     }
 
+    for (int i = 0; i < paths.size(); ++i) {
+        qDebug() << "Discovered" << perPath.at(i) << "plugins in" << paths.at(i);
+    }
+    qDebug() << "Plugin discovery:" << candidates.size() << "files scanned in"
+             << QString::number(timer.nsecsElapsed() / 1.0e6, 'f', 2) << "ms using"
+             << pool.maxThreadCount() << "threads";
+    
+    return count;
+}
+
+int PluginManager::discoverStatic()
+{
+    MPF_PROFILE_SCOPE("discover static", "plugin");
+    int count = 0;
+    
+    for (const QStaticPlugin& plugin : QPluginLoader::staticPlugins()) {
+        QJsonObject raw = plugin.metaData();
+        QString iid = raw.value("IID").toString();
+        if (iid != QLatin1String(MPF_IPlugin_iid) && iid != QLatin1String(MPF_IPlugin_iid_v1)) {
+            continue;  // Some other static Qt plugin (platform, image format, ...)
+        }
+        
+        PluginMetadata metadata(raw.value("MetaData").toObject());
+        if (!metadata.isValid()) {
+            qWarning() << "Invalid static plugin metadata:" << raw.value("className").toString();
+            continue;
+        }
+        
+        QString id = metadata.id();
+        if (m_pluginMap.contains(id)) {
+            qDebug() << "Static plugin" << id << "overridden by" << m_pluginMap.value(id)->path();
+            continue;
+        }
+        
+        auto loader = std::make_unique<PluginLoader>(plugin, this);
+        loader->setMetadata(metadata);
+        
+        m_pluginMap[id] = loader.get();
+        m_loaders.push_back(std::move(loader));
+        invalidateLoadOrder();
+        m_lastUsed.insert(id, std::make_shared<QAtomicInteger<qint64>>(m_clock.elapsed()));
+        
+        emit pluginDiscovered(id);
+        count++;
+    }
+    
+    qDebug() << "Discovered" << count << "static plugins";
     return count;
 }
 
+QJsonObject PluginManager::readMetaData(const QFileInfo& info) const
+{
+    // Read metadata without loading; the cache avoids opening unchanged binaries
+    if (m_metadataCache) {
+        return m_metadataCache->metaData(info);
+    }
+    
+    QPluginLoader tempLoader(info.absoluteFilePath());
+    return tempLoader.metaData().value("MetaData").toObject();
+}
+
+void PluginManager::setMetadataCache(const QString& filePath)
+{
+    m_metadataCache = std::make_unique<PluginMetadataCache>(filePath);
+    m_metadataCache->load();
+}
+
+void PluginManager::saveMetadataCache()
+{
+    if (!m_metadataCache) {
+        return;
+    }
+    
+    m_metadataCache->save();
+    qDebug() << "Plugin metadata cache:" << m_metadataCache->hits() << "hits,"
+             << m_metadataCache->misses() << "misses"
+             << QString("(%1% hit rate)").arg(m_metadataCache->hitRate() * 100.0, 0, 'f', 1);
+}
+
 bool PluginManager::loadAll()
 {
+    MPF_PROFILE_SCOPE("loadAll", "plugin");
     QStringList order = computeLoadOrder();
     
-    bool allLoaded = true;
+    // Plugins marked loadOnStartup=false stay unloaded unless an eager plugin needs them;
+    // in critical-only startup so do startup plugins not marked critical
+    auto isEager = [this](const PluginMetadata& metadata) {
+        return metadata.loadOnStartup() && (!m_criticalOnly || metadata.critical());
+    };
+    QSet<QString> required;
+    for (auto it = order.crbegin(); it != order.crend(); ++it) {
+        PluginLoader* loader = m_pluginMap.value(*it);
+        if (!loader || (!isEager(loader->metadata()) && !required.contains(*it))) continue;
+        required.insert(*it);
+        for (const PluginDependency& dep : loader->metadata().requires()) {
+            if (dep.type == PluginDependency::Type::Plugin) {
+                required.insert(dep.id);
+            }
+        }
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    int loadedCount = 0;
+    int staticCount = 0;
+    
+    // Plugins in a dependency cycle are left out of the order; say so
+    bool allLoaded = m_cyclic.isEmpty();
+    for (const QString& id : std::as_const(m_cyclic)) {
+        emit pluginError(id, QString("Not loaded: circular dependency among %1").arg(m_cyclic.join(", ")));
+    }
+    
+    m_warmUpQueue.clear();
     for (const QString& id : order) {
         PluginLoader* loader = m_pluginMap.value(id);
         if (!loader) continue;
+        
+        if (!required.contains(id)) {
+            deferPlugin(id);
+            if (loader->metadata().loadOnStartup()) {
+                m_warmUpQueue.append(id);
+            }
+            continue;
+        }
 
         // Check dependencies
         QStringList unsatisfied = checkDependencies(loader->metadata());
@@ -103,61 +290,778 @@ bool PluginManager::loadAll()
             continue;
         }
 
+        loadedCount++;
+        staticCount += loader->isStatic() ? 1 : 0;
         emit pluginLoaded(id);
     }
 
+    qDebug() << "Loaded" << loadedCount << "plugins (" << staticCount << "linked statically) in"
+             << QString::number(timer.nsecsElapsed() / 1.0e6, 'f', 2) << "ms";
     return allLoaded;
 }
 
-bool PluginManager::initializeAll()
+void PluginManager::deferPlugin(const QString& id)
 {
-    QStringList order = computeLoadOrder();
+    PluginLoader* loader = m_pluginMap.value(id);
+    m_deferred.insert(id);
     
-    bool allInitialized = true;
-    for (const QString& id : order) {
-        PluginLoader* loader = m_pluginMap.value(id);
-        if (!loader || !loader->isLoaded()) continue;
-        if (loader->state() >= PluginLoader::State::Initialized) continue;
+    // Show the plugin's declared menu entries; selecting one activates its route
+    QJsonArray menuItems = loader->metadata().menuItems();
+    IMenu* menu = menuItems.isEmpty() ? nullptr : m_registry->get<IMenu>();
+    if (menu) {
+        for (const auto& value : menuItems) {
+            QJsonObject json = value.toObject();
+            MenuItem item;
+            item.id = json.value("id").toString();
+            item.label = json.value("label").toString();
+            item.icon = json.value("icon").toString();
+            item.route = json.value("route").toString();
+            item.group = json.value("group").toString();
+            item.order = json.value("order").toInt();
+            item.pluginId = id;
+            menu->registerItem(item);
+        }
+    }
+    
+    qDebug() << "Deferred plugin" << id << "until first use, routes:"
+             << loader->metadata().routes();
+}
+
+void PluginManager::setCriticalOnly(bool criticalOnly)
+{
+    m_criticalOnly = criticalOnly;
+}
 
-        IPlugin* plugin = loader->plugin();
-        if (!plugin) continue;
+void PluginManager::warmUp()
+{
+    if (!m_warmUpTimer) {
+        // A zero timer fires once pending events are processed
+        m_warmUpTimer = new QTimer(this);
+        m_warmUpTimer->setInterval(0);
+        connect(m_warmUpTimer, &QTimer::timeout, this, &PluginManager::warmUpNext);
+    }
+    
+    m_warmUpStarted = 0;
+    m_warmUpTimer->start();
+}
 
-        if (!plugin->initialize(m_registry)) {
-            emit pluginError(id, "Initialization failed");
-            allInitialized = false;
-            continue;
+void PluginManager::warmUpNext()
+{
+    // Plugins brought up on demand in the meantime are skipped
+    while (!m_warmUpQueue.isEmpty()) {
+        QString id = m_warmUpQueue.takeFirst();
+        if (!m_deferred.contains(id)) continue;
+        
+        MPF_PROFILE_SCOPE("warm up " + id, "plugin");
+        if (ensureLoaded(id)) {
+            m_warmUpStarted++;
+            markUsed(id);
         }
+        return;  // Back to the event loop before the next one
+    }
+    
+    m_warmUpTimer->stop();
+    emit warmUpFinished(m_warmUpStarted);
+}
 
+bool PluginManager::ensureLoaded(const QString& id)
+{
+    PluginLoader* loader = m_pluginMap.value(id);
+    if (!loader) {
+        return false;
+    }
+    if (loader->state() == PluginLoader::State::Started) {
+        return true;
+    }
+    if (!m_deferred.contains(id) || m_activating.contains(id)) {
+        return false;
+    }
+    
+    // Lifecycle calls touch QML and the GUI; never run them from a worker
+    if (QThread::currentThread() != thread()) {
+        qWarning() << "Deferred plugin" << id << "can only be loaded from the GUI thread";
+        return false;
+    }
+    
+    MPF_PROFILE_SCOPE("ensureLoaded " + id, "plugin");
+    QElapsedTimer timer;
+    timer.start();
+    m_activating.insert(id);
+    
+    bool ok = true;
+    for (const PluginDependency& dep : loader->metadata().requires()) {
+        if (dep.type == PluginDependency::Type::Plugin && m_pluginMap.contains(dep.id)) {
+            ok = ok && (m_pluginMap.value(dep.id)->state() == PluginLoader::State::Started
+                        || ensureLoaded(dep.id));
+        }
+    }
+    
+    // The plugin registers its real menu entries when it starts
+    if (ok && !loader->metadata().menuItems().isEmpty()) {
+        if (IMenu* menu = m_registry->get<IMenu>()) {
+            menu->unregisterPlugin(id);
+        }
+    }
+    
+    ok = ok && bringUp(id);
+    
+    m_activating.remove(id);
+    if (ok) {
+        m_deferred.remove(id);
+        qDebug() << "Loaded deferred plugin" << id << "on demand in"
+                 << QString::number(timer.nsecsElapsed() / 1.0e6, 'f', 2) << "ms";
+    }
+    return ok;
+}
+
+bool PluginManager::bringUp(const QString& id)
+{
+    PluginLoader* loader = m_pluginMap.value(id);
+    
+    if (!loader->isLoaded()) {
+        if (!loader->load()) {
+            emit pluginError(id, loader->errorString());
+            return false;
+        }
+        emit pluginLoaded(id);
+    }
+    
+    bool ok = true;
+    qint64 elapsedNs = 0;
+    if (isReady(loader, Phase::Initialize)) {
+        ok = finishPhase(id, Phase::Initialize, invokePhase(loader, Phase::Initialize, &elapsedNs),
+                         elapsedNs, false);
+    }
+    if (ok && isReady(loader, Phase::Start)) {
+        ok = finishPhase(id, Phase::Start, invokePhase(loader, Phase::Start, &elapsedNs),
+                         elapsedNs, false);
+    }
+    return ok;
+}
+
+void PluginManager::teardown(const QString& id)
+{
+    PluginLoader* loader = m_pluginMap.value(id);
+    if (!loader || !loader->isLoaded()) {
+        return;
+    }
+    
+    emit pluginAboutToUnload(id);
+    
+    if (loader->state() == PluginLoader::State::Started) {
+        invokeStop(id, loader);
         loader->setState(PluginLoader::State::Initialized);
-        emit pluginInitialized(id);
+        emit pluginStopped(id);
     }
+    
+    releaseRegistrations(id);
+    
+    loader->unload();
+    emit pluginUnloaded(id);
+}
 
-    return allInitialized;
+void PluginManager::releaseRegistrations(const QString& id)
+{
+    // Nothing the plugin registered may outlive its library
+    if (IEventBus* eventBus = m_registry->get<IEventBus>()) {
+        eventBus->unsubscribeAll(id);
+    }
+    if (IMenu* menu = m_registry->get<IMenu>()) {
+        menu->unregisterPlugin(id);
+    }
+    if (auto* registry = dynamic_cast<ServiceRegistryImpl*>(m_registry)) {
+        if (auto* navigation = qobject_cast<NavigationService*>(registry->getObject<INavigation>())) {
+            navigation->unregisterPluginRoutes(id);
+        }
+        registry->removeProviders(id);
+    }
 }
 
-bool PluginManager::startAll()
+QStringList PluginManager::dependants(const QString& id) const
+{
+    // Plugins that (transitively) require id, in load order
+    QSet<QString> affected{id};
+    QStringList result;
+    for (const QString& candidate : computeLoadOrder()) {
+        if (candidate == id) continue;
+        for (const PluginDependency& dep : m_pluginMap.value(candidate)->metadata().requires()) {
+            if (dep.type == PluginDependency::Type::Plugin && affected.contains(dep.id)) {
+                affected.insert(candidate);
+                result.append(candidate);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+bool PluginManager::reload(const QString& id)
+{
+    PluginLoader* loader = m_pluginMap.value(id);
+    if (!loader) {
+        qWarning() << "Cannot reload unknown plugin:" << id;
+        return false;
+    }
+    
+    MPF_PROFILE_SCOPE("reload " + id, "plugin");
+    QElapsedTimer timer;
+    timer.start();
+    
+    QStringList affected = dependants(id);
+    affected.prepend(id);
+    
+    // Only plugins that were running come back up
+    QStringList running;
+    for (const QString& pluginId : std::as_const(affected)) {
+        if (m_pluginMap.value(pluginId)->isLoaded()) {
+            running.append(pluginId);
+        }
+    }
+    
+    // Tear down dependants first
+    for (auto it = running.crbegin(); it != running.crend(); ++it) {
+        teardown(*it);
+    }
+    
+    // Pick up metadata of the new binary; a static plugin is just restarted
+    if (!loader->isStatic()) {
+        PluginMetadata metadata(readMetaData(QFileInfo(loader->path())));
+        if (!metadata.isValid() || metadata.id() != id) {
+            qWarning() << "Reloaded binary of" << id << "has invalid or different metadata";
+            emit pluginError(id, "Invalid metadata after reload");
+            return false;
+        }
+        loader->setMetadata(metadata);
+        invalidateLoadOrder();
+    }
+    
+    // Bring back up in dependency order; skip dependants of plugins that failed
+    bool allOk = true;
+    QSet<QString> failed;
+    for (const QString& pluginId : std::as_const(running)) {
+        bool blocked = false;
+        for (const PluginDependency& dep : m_pluginMap.value(pluginId)->metadata().requires()) {
+            blocked = blocked || (dep.type == PluginDependency::Type::Plugin && failed.contains(dep.id));
+        }
+        if (blocked || !bringUp(pluginId)) {
+            failed.insert(pluginId);
+            allOk = false;
+        }
+    }
+    
+    qDebug() << "Reloaded plugin" << id << "(" << running.size() << "plugins restarted) in"
+             << QString::number(timer.nsecsElapsed() / 1.0e6, 'f', 2) << "ms";
+    emit pluginReloaded(id);
+    return allOk;
+}
+
+void PluginManager::setWatchEnabled(bool enabled)
+{
+    if (!enabled) {
+        m_watcher.reset();
+        return;
+    }
+    if (m_watcher) {
+        return;
+    }
+    
+    m_watcher = std::make_unique<QFileSystemWatcher>();
+    for (const auto& loader : m_loaders) {
+        if (loader->isStatic()) continue;
+        m_watcher->addPath(loader->path());
+        m_fileStamps.insert(loader->path(), QFileInfo(loader->path()).lastModified());
+    }
+    for (const QString& path : std::as_const(m_searchPaths)) {
+        m_watcher->addPath(path);
+    }
+    
+    // Builds often replace the file (delete + create), which only shows up as a
+    // directory change; both paths funnel into the same debounced check
+    connect(m_watcher.get(), &QFileSystemWatcher::fileChanged,
+            this, &PluginManager::checkPluginFile);
+    connect(m_watcher.get(), &QFileSystemWatcher::directoryChanged, this, [this](const QString& dir) {
+        for (const auto& loader : m_loaders) {
+            if (!loader->isStatic() && QFileInfo(loader->path()).absolutePath() == QDir(dir).absolutePath()) {
+                checkPluginFile(loader->path());
+            }
+        }
+    });
+    
+    if (!m_reloadTimer) {
+        m_reloadTimer = new QTimer(this);
+        m_reloadTimer->setSingleShot(true);
+        m_reloadTimer->setInterval(500);
+        connect(m_reloadTimer, &QTimer::timeout, this, &PluginManager::reloadChanged);
+    }
+    
+    qDebug() << "Watching" << m_loaders.size() << "plugin files for changes";
+}
+
+void PluginManager::checkPluginFile(const QString& path)
+{
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return;  // Being replaced; the directory change brings it back
+    }
+    
+    // A replaced file drops out of the watch list
+    if (!m_watcher->files().contains(path)) {
+        m_watcher->addPath(path);
+    }
+    
+    if (info.lastModified() == m_fileStamps.value(path)) {
+        return;
+    }
+    m_fileStamps.insert(path, info.lastModified());
+    
+    for (auto it = m_pluginMap.constBegin(); it != m_pluginMap.constEnd(); ++it) {
+        if (it.value()->path() == path) {
+            m_pendingReloads.insert(it.key());
+        }
+    }
+    
+    // Wait for the build to finish writing before reloading
+    m_reloadTimer->start();
+}
+
+void PluginManager::reloadChanged()
+{
+    QSet<QString> pending = std::exchange(m_pendingReloads, {});
+    QSet<QString> done;
+    
+    for (const QString& id : computeLoadOrder()) {
+        if (!pending.contains(id) || done.contains(id)) continue;
+        
+        qDebug() << "Plugin binary changed, reloading:" << id;
+        reload(id);
+        done.insert(id);
+        for (const QString& dependant : dependants(id)) {
+            done.insert(dependant);
+        }
+    }
+}
+
+void PluginManager::markUsed(const QString& id)
+{
+    // Read-only hash access: safe from any thread once discovery is done
+    auto it = m_lastUsed.constFind(id);
+    if (it != m_lastUsed.constEnd()) {
+        (*it)->storeRelaxed(m_clock.elapsed());
+    }
+}
+
+qint64 PluginManager::idleTime(const QString& id) const
+{
+    auto it = m_lastUsed.constFind(id);
+    if (it == m_lastUsed.constEnd()) {
+        return -1;
+    }
+    return m_clock.elapsed() - (*it)->loadRelaxed();
+}
+
+void PluginManager::setIdleTimeout(qint64 timeoutMs)
+{
+    m_idleTimeoutMs = timeoutMs;
+    
+    if (timeoutMs <= 0) {
+        if (m_idleTimer) {
+            m_idleTimer->stop();
+        }
+        return;
+    }
+    
+    if (!m_idleTimer) {
+        m_idleTimer = new QTimer(this);
+        connect(m_idleTimer, &QTimer::timeout, this, &PluginManager::unloadIdlePlugins);
+    }
+    m_idleTimer->start(static_cast<int>(qBound<qint64>(1000, timeoutMs / 4, 60000)));
+    qDebug() << "Unloading plugins idle for more than" << timeoutMs / 1000.0 << "s";
+}
+
+void PluginManager::setIdleUnloadFilter(std::function<bool(const QString& id)> canUnload)
+{
+    m_idleUnloadFilter = std::move(canUnload);
+}
+
+bool PluginManager::canUnloadIdle(const QString& id) const
+{
+    // Static plugin code stays mapped, so unloading one frees little
+    PluginLoader* loader = m_pluginMap.value(id);
+    if (!loader || loader->isStatic() || loader->state() != PluginLoader::State::Started) {
+        return false;
+    }
+    
+    // It must be able to come back on demand
+    const PluginMetadata& metadata = loader->metadata();
+    if (metadata.routes().isEmpty() && metadata.provides().isEmpty()) {
+        return false;
+    }
+    
+    for (const QString& dependant : dependants(id)) {
+        if (m_pluginMap.value(dependant)->isLoaded()) {
+            return false;
+        }
+    }
+    
+    return !m_idleUnloadFilter || m_idleUnloadFilter(id);
+}
+
+int PluginManager::unloadIdlePlugins()
 {
+    if (m_idleTimeoutMs <= 0) {
+        return 0;
+    }
+    
+    int count = 0;
+    
+    // Dependants first, so their dependencies may become idle-unloadable too
     QStringList order = computeLoadOrder();
+    for (auto it = order.crbegin(); it != order.crend(); ++it) {
+        const QString& id = *it;
+        qint64 idle = idleTime(id);
+        if (idle < m_idleTimeoutMs || !canUnloadIdle(id)) continue;
+        
+        qint64 before = residentMemory();
+        teardown(id);
+        trimHeap();
+        qint64 freed = (before >= 0) ? before - residentMemory() : -1;
+        
+        deferPlugin(id);
+        markUsed(id);  // Restart the idle clock for when it comes back
+        
+        qDebug().noquote() << QString("Unloaded plugin %1 after %2 s idle, freed %3 KiB resident memory")
+            .arg(id)
+            .arg(idle / 1000.0, 0, 'f', 1)
+            .arg(freed >= 0 ? QString::number(freed / 1024) : QString("?"));
+        emit pluginIdleUnloaded(id, freed);
+        count++;
+    }
     
-    bool allStarted = true;
-    for (const QString& id : order) {
-        PluginLoader* loader = m_pluginMap.value(id);
-        if (!loader || loader->state() != PluginLoader::State::Initialized) continue;
+    return count;
+}
 
-        IPlugin* plugin = loader->plugin();
-        if (!plugin) continue;
+bool PluginManager::loadForRoute(const QString& route)
+{
+    // Declared routes may be patterns ("orders/:id")
+    auto declares = [&route](const QStringList& routes) {
+        return std::any_of(routes.begin(), routes.end(), [&route](const QString& pattern) {
+            return RouteTable::matches(pattern, route);
+        });
+    };
+    
+    for (const QString& id : computeLoadOrder()) {
+        if (m_deferred.contains(id) && declares(m_pluginMap.value(id)->metadata().routes())) {
+            return ensureLoaded(id);
+        }
+    }
+    return false;
+}
 
-        if (!plugin->start()) {
-            emit pluginError(id, "Start failed");
-            allStarted = false;
-            continue;
+// Whether a compiler type name (Itanium or MSVC) names the given interface
+static bool typeNameMatches(const QByteArray& typeName, const QString& provided)
+{
+    QByteArray name = provided.toLatin1();
+    if (name.isEmpty()) {
+        return false;
+    }
+    if (typeName == name) {
+        return true;
+    }
+    
+    // Itanium: N3mpf11INavigationE; MSVC: class mpf::INavigation
+    QByteArray itanium = QByteArray::number(name.size()) + name;
+    qsizetype pos = typeName.indexOf(itanium);
+    if (pos >= 0 && (pos == 0 || !std::isdigit(static_cast<unsigned char>(typeName.at(pos - 1))))
+        && pos + itanium.size() >= typeName.size() - 1) {
+        return true;
+    }
+    return typeName.endsWith("::" + name) || typeName.endsWith(" " + name);
+}
+
+bool PluginManager::loadForService(const char* typeName)
+{
+    QByteArray name(typeName);
+    for (const QString& id : computeLoadOrder()) {
+        if (!m_deferred.contains(id)) continue;
+        for (const QString& provided : m_pluginMap.value(id)->metadata().provides()) {
+            if (typeNameMatches(name, provided)) {
+                return ensureLoaded(id);
+            }
+        }
+    }
+    return false;
+}
+
+QStringList PluginManager::deferredPlugins() const
+{
+    QStringList result;
+    for (const QString& id : computeLoadOrder()) {
+        if (m_deferred.contains(id)) {
+            result.append(id);
         }
+    }
+    return result;
+}
+
+bool PluginManager::initializeAll()
+{
+    return runPhase(Phase::Initialize);
+}
+
+bool PluginManager::startAll()
+{
+    return runPhase(Phase::Start);
+}
 
+bool PluginManager::isReady(PluginLoader* loader, Phase phase) const
+{
+    if (!loader || !loader->plugin()) {
+        return false;
+    }
+    if (phase == Phase::Initialize) {
+        return loader->isLoaded() && loader->state() < PluginLoader::State::Initialized;
+    }
+    return loader->state() == PluginLoader::State::Initialized;
+}
+
+bool PluginManager::invokePhase(PluginLoader* loader, Phase phase, qint64* elapsedNs) const
+{
+    // Note: may run on a worker thread (threadSafe plugins). The plugin may
+    // call host services, which are thread-safe, but must not create
+    // QObjects here (see IPlugin)
+    const QString phaseName = (phase == Phase::Initialize) ? "initialize" : "start";
+    PluginContextScope context(loader->metadata().id());
+    ResourceScope resources(loader->metadata().id(), ResourceCategory::Lifecycle);
+    WatchdogScope watchdog(m_watchdog.get(), loader->metadata().id(), phaseName,
+                           phaseBudgetMs(loader->metadata(), phaseName));
+    MPF_PROFILE_SCOPE(QString("%1 %2").arg(phaseName, loader->metadata().id()), "plugin");
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = (phase == Phase::Initialize)
+        ? loader->plugin()->initialize(m_registry)
+        : loader->plugin()->start();
+    *elapsedNs = timer.nsecsElapsed();
+    return ok;
+}
+
+bool PluginManager::finishPhase(const QString& id, Phase phase, bool ok, qint64 elapsedNs, bool threaded)
+{
+    PluginTiming& timing = m_timings[id];
+    timing.id = id;
+    timing.threaded = timing.threaded || threaded;
+    if (phase == Phase::Initialize) {
+        timing.initializeNs = elapsedNs;
+    } else {
+        timing.startNs = elapsedNs;
+    }
+
+    if (!ok) {
+        emit pluginError(id, phase == Phase::Initialize ? "Initialization failed" : "Start failed");
+        return false;
+    }
+    
+    // A late call has done its work, but the plugin may be declared failed for it
+    PluginLoader* loader = m_pluginMap.value(id);
+    const QString phaseName = (phase == Phase::Initialize) ? "initialize" : "start";
+    qint64 budgetMs = phaseBudgetMs(loader->metadata(), phaseName);
+    if (budgetMs > 0 && elapsedNs > budgetMs * 1000000) {
+        timing.slow = true;
+        QString message = QString("%1() took %2 ms, budget %3 ms")
+            .arg(phaseName).arg(elapsedNs / 1000000).arg(budgetMs);
+        if (loader->metadata().failOnTimeout()) {
+            emit pluginError(id, message);
+            return false;
+        }
+        qWarning().noquote() << "Slow plugin" << id + ":" << message;
+    }
+    
+    if (phase == Phase::Initialize) {
+        loader->setState(PluginLoader::State::Initialized);
+        emit pluginInitialized(id);
+    } else {
         loader->setState(PluginLoader::State::Started);
         emit pluginStarted(id);
     }
+    return true;
+}
+
+QString PluginManager::blockingDependency(PluginLoader* loader, Phase phase) const
+{
+    // Plugins only run once the plugins they require have done the same phase
+    for (const PluginDependency& dep : loader->metadata().requires()) {
+        if (dep.type != PluginDependency::Type::Plugin || dep.optional) continue;
+        
+        PluginLoader* dependency = m_pluginMap.value(dep.id);
+        if (!dependency) continue;  // Reported by checkDependencies()
+        
+        bool done = (phase == Phase::Initialize)
+            ? dependency->state() >= PluginLoader::State::Initialized
+                && dependency->state() != PluginLoader::State::Error
+            : dependency->state() == PluginLoader::State::Started;
+        if (!done) {
+            return dep.id;
+        }
+    }
+    return QString();
+}
+
+void PluginManager::invokeStop(const QString& id, PluginLoader* loader)
+{
+    IPlugin* plugin = loader->plugin();
+    if (!plugin) {
+        return;
+    }
+    
+    PluginContextScope context(id);
+    ResourceScope resources(id, ResourceCategory::Lifecycle);
+    qint64 budgetMs = phaseBudgetMs(loader->metadata(), "stop");
+    WatchdogScope watchdog(m_watchdog.get(), id, "stop", budgetMs);
+    QElapsedTimer timer;
+    timer.start();
+    plugin->stop();
+    
+    PluginTiming& timing = m_timings[id];
+    timing.id = id;
+    timing.stopNs = timer.nsecsElapsed();
+    if (budgetMs > 0 && timing.stopNs > budgetMs * 1000000) {
+        timing.slow = true;
+        qWarning().noquote() << QString("Slow plugin %1: stop() took %2 ms, budget %3 ms")
+            .arg(id).arg(timing.stopNs / 1000000).arg(budgetMs);
+    }
+}
+
+bool PluginManager::runPhase(Phase phase)
+{
+    const char* phaseName = (phase == Phase::Initialize) ? "initialize" : "start";
+    MPF_PROFILE_SCOPE(phase == Phase::Initialize ? "initializeAll" : "startAll", "plugin");
+    bool parallel = (m_executionMode == ExecutionMode::Parallel);
+    
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    
+    // Serial mode treats the whole load order as a single level
+    QList<QStringList> levels = parallel ? loadLevels() : QList<QStringList>{computeLoadOrder()};
+    
+    QThreadPool pool;
+    bool allOk = true;
+    qint64 serialNs = 0;
+    
+    for (const QStringList& level : levels) {
+        struct Task {
+            QString id;
+            PluginLoader* loader;
+            bool ok = false;
+            qint64 elapsedNs = 0;
+        };
+        
+        // A failed or timed-out plugin takes its dependants down with it
+        auto blocked = [&](const Task& task) {
+            QString blocker = blockingDependency(task.loader, phase);
+            if (blocker.isEmpty()) {
+                return false;
+            }
+            emit pluginError(task.id, QString("Skipped: required plugin %1 did not %2").arg(blocker, phaseName));
+            allOk = false;
+            return true;
+        };
+        
+        std::vector<Task> threaded;
+        std::vector<Task> inlined;
+        for (const QString& id : level) {
+            PluginLoader* loader = m_pluginMap.value(id);
+            if (!isReady(loader, phase)) continue;
+            
+            // The channel to an out-of-process plugin belongs to the GUI thread
+            if (parallel && loader->metadata().threadSafe() && !loader->isOutOfProcess()) {
+                threaded.push_back({id, loader});
+            } else {
+                inlined.push_back({id, loader});
+            }
+        }
+        
+        // Thread-safe plugins of this level run on the pool; what they
+        // require is in an earlier level and has finished...
+        threaded.erase(std::remove_if(threaded.begin(), threaded.end(), blocked), threaded.end());
+        for (Task& task : threaded) {
+            pool.start([this, phase, &task]() {
+                task.ok = invokePhase(task.loader, phase, &task.elapsedNs);
+            });
+        }
+        
+        // ...while the rest run here on the GUI thread, in load order. In
+        // serial mode a plugin's dependencies are earlier in this same
+        // level, so they are checked only once those have run.
+        for (Task& task : inlined) {
+            if (blocked(task)) continue;
+            task.ok = invokePhase(task.loader, phase, &task.elapsedNs);
+            serialNs += task.elapsedNs;
+            allOk = finishPhase(task.id, phase, task.ok, task.elapsedNs, false) && allOk;
+        }
+        
+        // The next level depends on this one
+        pool.waitForDone();
+        for (const Task& task : threaded) {
+            serialNs += task.elapsedNs;
+            allOk = finishPhase(task.id, phase, task.ok, task.elapsedNs, true) && allOk;
+        }
+    }
+    
+    qint64 wallNs = wallTimer.nsecsElapsed();
+    for (const QString& id : computeLoadOrder()) {
+        auto it = m_timings.constFind(id);
+        if (it == m_timings.constEnd()) continue;
+        qint64 elapsed = (phase == Phase::Initialize) ? it->initializeNs : it->startNs;
+        if (elapsed < 0) continue;
+        qDebug().noquote() << QString("  %1 %2: %3 ms%4%5")
+            .arg(phaseName, id)
+            .arg(elapsed / 1.0e6, 0, 'f', 2)
+            .arg(it->threaded ? " (worker)" : "", it->slow ? " (slow)" : "");
+    }
+    qDebug().noquote() << QString("Plugin %1: %2 ms wall clock, %3 ms serial (%4 mode, %5 levels)")
+        .arg(phaseName)
+        .arg(wallNs / 1.0e6, 0, 'f', 2)
+        .arg(serialNs / 1.0e6, 0, 'f', 2)
+        .arg(parallel ? "parallel" : "serial")
+        .arg(levels.size());
+    
+    return allOk;
+}
 
-    return allStarted;
+QList<QStringList> PluginManager::loadLevels() const
+{
+    if (!m_loadOrderValid) {
+        buildLoadOrder();
+    }
+    return m_levels;
+}
+
+void PluginManager::setExecutionMode(ExecutionMode mode)
+{
+    m_executionMode = mode;
+}
+
+void PluginManager::setOutOfProcess(const QStringList& ids)
+{
+    for (const QString& id : ids) {
+        PluginLoader* loader = m_pluginMap.value(id);
+        if (!loader) {
+            qWarning() << "Cannot run unknown plugin out of process:" << id;
+            continue;
+        }
+        loader->setOutOfProcess(true);
+    }
+}
+
+QList<PluginTiming> PluginManager::timings() const
+{
+    QList<PluginTiming> result;
+    for (const QString& id : computeLoadOrder()) {
+        auto it = m_timings.constFind(id);
+        if (it != m_timings.constEnd()) {
+            result.append(*it);
+        }
+    }
+    return result;
 }
 
 void PluginManager::stopAll()
@@ -170,11 +1074,7 @@ void PluginManager::stopAll()
         PluginLoader* loader = m_pluginMap.value(id);
         if (!loader || loader->state() != PluginLoader::State::Started) continue;
 
-        IPlugin* plugin = loader->plugin();
-        if (plugin) {
-            plugin->stop();
-        }
-
+        invokeStop(id, loader);
         loader->setState(PluginLoader::State::Initialized);
         emit pluginStopped(id);
     }
@@ -196,6 +1096,7 @@ void PluginManager::unloadAll()
 
     m_pluginMap.clear();
     m_loaders.clear();
+    invalidateLoadOrder();
 }
 
 QList<PluginLoader*> PluginManager::plugins() const
@@ -251,8 +1152,8 @@ QStringList PluginManager::checkDependencies(const PluginMetadata& metadata) con
                     .arg(dep.id, dep.minVersion.toString()));
             }
         } else {
-            // Service dependency - check at runtime
-            // We can't fully check this until initialization
+            // Service dependency - may be provided by a plugin that has not
+            // initialized yet; plugins wait on ServiceRegistry::whenAvailable()
         }
     }
     
@@ -266,47 +1167,76 @@ QStringList PluginManager::loadOrder() const
 
 QStringList PluginManager::computeLoadOrder() const
 {
-    QStringList order;
-    QHash<QString, int> state; // 0=unvisited, 1=visiting, 2=visited
-    
-    for (auto it = m_pluginMap.begin(); it != m_pluginMap.end(); ++it) {
-        state[it.key()] = 0;
+    if (!m_loadOrderValid) {
+        buildLoadOrder();
     }
+    return m_loadOrder;
+}
+
+void PluginManager::invalidateLoadOrder()
+{
+    m_loadOrderValid = false;
+}
+
+void PluginManager::buildLoadOrder() const
+{
+    // Kahn's algorithm one level at a time: a plugin's level is one more than
+    // the deepest plugin it depends on
+    QHash<QString, int> pending;               // Plugin -> dependencies not yet placed
+    QHash<QString, QStringList> dependantsOf;
+    QStringList level;
     
-    for (auto it = m_pluginMap.begin(); it != m_pluginMap.end(); ++it) {
-        if (!topologicalSort(it.key(), state, order)) {
-            qWarning() << "Circular dependency detected involving:" << it.key();
+    for (auto it = m_pluginMap.constBegin(); it != m_pluginMap.constEnd(); ++it) {
+        int count = 0;
+        for (const PluginDependency& dep : it.value()->metadata().requires()) {
+            if (dep.type == PluginDependency::Type::Plugin && m_pluginMap.contains(dep.id)) {
+                dependantsOf[dep.id].append(it.key());
+                count++;
+            }
+        }
+        pending.insert(it.key(), count);
+        if (count == 0) {
+            level.append(it.key());
         }
     }
     
-    return order;
-}
+    auto byPriority = [this](const QString& a, const QString& b) {
+        int pa = m_pluginMap.value(a)->metadata().priority();
+        int pb = m_pluginMap.value(b)->metadata().priority();
+        return pa != pb ? pa < pb : a < b;
+    };
 
-bool PluginManager::topologicalSort(const QString& id, 
-                                     QHash<QString, int>& state, 
-                                     QStringList& order) const
-{
-    if (state.value(id) == 2) return true;  // Already visited
-    if (state.value(id) == 1) return false; // Circular dependency
+    m_levels.clear();
+    m_loadOrder.clear();
+    m_cyclic.clear();
+    while (!level.isEmpty()) {
+        std::sort(level.begin(), level.end(), byPriority);
+        m_levels.append(level);
+        m_loadOrder.append(level);
     
-    state[id] = 1; // Visiting
-    
-    PluginLoader* loader = m_pluginMap.value(id);
-    if (loader) {
-        for (const PluginDependency& dep : loader->metadata().requires()) {
-            if (dep.type == PluginDependency::Type::Plugin) {
-                if (m_pluginMap.contains(dep.id)) {
-                    if (!topologicalSort(dep.id, state, order)) {
-                        return false;
-                    }
+        QStringList next;
+        for (const QString& id : std::as_const(level)) {
+            for (const QString& dependant : dependantsOf.value(id)) {
+                if (--pending[dependant] == 0) {
+                    next.append(dependant);
                 }
             }
         }
+        level = std::move(next);
     }
     
-    state[id] = 2; // Visited
-    order.append(id);
-    return true;
+    // Whatever is left waits on itself, or on a plugin that does
+    if (m_loadOrder.size() < m_pluginMap.size()) {
+        for (auto it = pending.constBegin(); it != pending.constEnd(); ++it) {
+            if (it.value() > 0) {
+                m_cyclic.append(it.key());
+            }
+        }
+        m_cyclic.sort();
+        qWarning() << "Circular dependency detected involving:" << m_cyclic;
+    }
+    
+    m_loadOrderValid = true;
 }
 
 } // namespace mpf
@@ -73,9 +73,27 @@ void PluginMetadata::parse(const QJsonObject& json)
     
     m_entryQml = json.value("entryQml").toString();
     
+    QJsonArray routesArray = json.value("routes").toArray();
+    for (const auto& val : routesArray) {
+        m_routes.append(val.toString());
+    }
+    m_menuItems = json.value("menu").toArray();
+    
     // Loading hints
     m_priority = json.value("priority").toInt(0);
     m_loadOnStartup = json.value("loadOnStartup").toBool(true);
+    m_critical = json.value("critical").toBool(false);
+    m_threadSafe = json.value("threadSafe").toBool(false);
+    m_outOfProcess = json.value("outOfProcess").toBool(false);
+    
+    // Lifecycle budgets: {"initialize": ms, "start": ms, "stop": ms, "fail": bool}
+    QJsonObject timeouts = json.value("timeouts").toObject();
+    for (const char* phase : {"initialize", "start", "stop"}) {
+        if (timeouts.contains(phase)) {
+            m_timeouts.insert(phase, qMax<qint64>(0, timeouts.value(phase).toInteger()));
+        }
+    }
+    m_failOnTimeout = timeouts.value("fail").toBool(false);
 }
 
 QStringList PluginMetadata::validate() const
@@ -0,0 +1,186 @@
+#include "plugin_metadata_cache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QPluginLoader>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace mpf {
+
+// Bump when the entry layout changes; the Qt version guards the metadata format
+static constexpr int kCacheFormat = 1;
+
+PluginMetadataCache::PluginMetadataCache(const QString& filePath)
+    : m_filePath(filePath)
+{
+}
+
+void PluginMetadataCache::load()
+{
+    m_entries.clear();
+    m_used.clear();
+    m_dirty = false;
+    
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    QJsonParseError error;
+    QJsonObject root = QJsonDocument::fromJson(file.readAll(), &error).object();
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "Plugin metadata cache is corrupt, rebuilding:" << error.errorString();
+        m_dirty = true;
+        return;
+    }
+    
+    if (root.value("format").toInt() != kCacheFormat
+        || root.value("qt").toString() != QLatin1String(QT_VERSION_STR)) {
+        qDebug() << "Plugin metadata cache is from another version, rebuilding";
+        m_dirty = true;
+        return;
+    }
+    
+    QJsonObject plugins = root.value("plugins").toObject();
+    for (auto it = plugins.constBegin(); it != plugins.constEnd(); ++it) {
+        QJsonObject json = it.value().toObject();
+        Entry entry;
+        entry.size = json.value("size").toInteger(-1);
+        entry.modified = json.value("modified").toInteger();
+        entry.hash = json.value("sha1").toString().toLatin1();
+        entry.metaData = json.value("metaData").toObject();
+        m_entries.insert(it.key(), entry);
+    }
+}
+
+bool PluginMetadataCache::save()
+{
+    // Drop plugins that were not seen this run (removed or moved)
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!m_used.contains(it.key())) {
+            it = m_entries.erase(it);
+            m_dirty = true;
+        } else {
+            ++it;
+        }
+    }
+    
+    if (!m_dirty) {
+        return true;
+    }
+    
+    QJsonObject plugins;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        QJsonObject json;
+        json["size"] = it->size;
+        json["modified"] = it->modified;
+        json["sha1"] = QString::fromLatin1(it->hash);
+        json["metaData"] = it->metaData;
+        plugins[it.key()] = json;
+    }
+    
+    QJsonObject root;
+    root["format"] = kCacheFormat;
+    root["qt"] = QLatin1String(QT_VERSION_STR);
+    root["plugins"] = plugins;
+    
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write plugin metadata cache:" << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "Cannot write plugin metadata cache:" << file.errorString();
+        return false;
+    }
+    
+    m_dirty = false;
+    return true;
+}
+
+QJsonObject PluginMetadataCache::metaData(const QFileInfo& info)
+{
+    QString path = info.absoluteFilePath();
+    qint64 size = info.size();
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    
+    Entry cached;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_used.insert(path);
+        
+        auto it = m_entries.constFind(path);
+        if (it != m_entries.constEnd() && it->size == size) {
+            if (it->modified == modified) {
+                m_hits++;
+                return it->metaData;
+            }
+            cached = *it;
+        }
+    }
+    
+    // Timestamp moved but the size did not: the content hash decides
+    QByteArray hash = fileHash(path);
+    if (cached.size == size && !hash.isEmpty() && hash == cached.hash) {
+        QMutexLocker locker(&m_mutex);
+        m_entries[path].modified = modified;
+        m_dirty = true;
+        m_hits++;
+        return cached.metaData;
+    }
+    
+    QPluginLoader loader(path);
+    Entry entry;
+    entry.size = size;
+    entry.modified = modified;
+    entry.hash = hash;
+    entry.metaData = loader.metaData().value("MetaData").toObject();
+    
+    QMutexLocker locker(&m_mutex);
+    m_entries.insert(path, entry);
+    m_dirty = true;
+    m_misses++;
+    
+    return entry.metaData;
+}
+
+int PluginMetadataCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int PluginMetadataCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+double PluginMetadataCache::hitRate() const
+{
+    QMutexLocker locker(&m_mutex);
+    int lookups = m_hits + m_misses;
+    return lookups > 0 ? double(m_hits) / lookups : 0.0;
+}
+
+QByteArray PluginMetadataCache::fileHash(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return hash.result().toHex();
+}
+
+} // namespace mpf
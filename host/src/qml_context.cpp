@@ -1,5 +1,6 @@
 #include "qml_context.h"
 #include "service_registry.h"
+#include "resource_monitor.h"
 #include <mpf/version.h>
 #include <mpf/interfaces/inavigation.h>
 #include <mpf/interfaces/isettings.h>
@@ -9,6 +10,7 @@
 
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QJSValue>
 
 namespace mpf {
 
@@ -22,15 +24,80 @@ QmlContext::~QmlContext() = default;
 
 void QmlContext::setup(QQmlApplicationEngine* engine)
 {
+    m_engine = engine;
+    
     // Register this as "App" singleton
     engine->rootContext()->setContextProperty("App", this);
     
-    // Expose services to QML (as QObject*)
-    engine->rootContext()->setContextProperty("Navigation", navigation());
-    engine->rootContext()->setContextProperty("Settings", settings());
-    engine->rootContext()->setContextProperty("Theme", theme());
-    engine->rootContext()->setContextProperty("AppMenu", appMenu());
-    engine->rootContext()->setContextProperty("EventBus", eventBus());
+    updateContextProperties();
+    registerSingletons();
+    
+    // Re-expose services when a provider takes over, arrives or goes away
+    // (a removed last provider must not stay reachable from QML)
+    auto refresh = [this]() {
+        updateContextProperties();
+        emit servicesChanged();
+    };
+    connect(m_registry, &ServiceRegistryImpl::serviceProviderChanged, this, refresh);
+    connect(m_registry, &ServiceRegistryImpl::serviceAdded, this, refresh);
+    connect(m_registry, &ServiceRegistryImpl::serviceRemoved, this, refresh);
+}
+
+void QmlContext::updateContextProperties()
+{
+    // The shell draws its first frame with these, so they are created
+    // (and exposed to QML as QObject*) up front
+    m_engine->rootContext()->setContextProperty("Navigation", navigation());
+    m_engine->rootContext()->setContextProperty("Theme", theme());
+    m_engine->rootContext()->setContextProperty("AppMenu", appMenu());
+    
+    if (m_pluginServicesExposed) {
+        m_engine->rootContext()->setContextProperty("Settings", settings());
+        m_engine->rootContext()->setContextProperty("EventBus", eventBus());
+    }
+}
+
+void QmlContext::exposePluginServices()
+{
+    if (m_pluginServicesExposed || !m_engine) {
+        return;
+    }
+    m_pluginServicesExposed = true;
+    
+    // Plugin pages have always found these in the root context
+    m_engine->rootContext()->setContextProperty("Settings", settings());
+    m_engine->rootContext()->setContextProperty("EventBus", eventBus());
+}
+
+void QmlContext::registerSingletons()
+{
+    // Created when QML first uses them (Settings and EventBus may already
+    // be, see exposePluginServices())
+    auto expose = [this](const char* name, QObject* (QmlContext::*getter)() const) {
+        qmlRegisterSingletonType("MPF.Services", 1, 0, name, [this, getter](QQmlEngine* engine, QJSEngine*) {
+            QObject* service = (this->*getter)();
+            if (!service) {
+                return QJSValue(QJSValue::NullValue);
+            }
+            // The registry owns the service, not the engine
+            QQmlEngine::setObjectOwnership(service, QQmlEngine::CppOwnership);
+            return engine->newQObject(service);
+        });
+    };
+    expose("Settings", &QmlContext::settings);
+    expose("EventBus", &QmlContext::eventBus);
+    expose("Diagnostics", &QmlContext::diagnostics);
+}
+
+bool QmlContext::hasService(const QString& name) const
+{
+    if (name == QLatin1String("Navigation")) return m_registry->has<INavigation>();
+    if (name == QLatin1String("Settings")) return m_registry->has<ISettings>();
+    if (name == QLatin1String("Theme")) return m_registry->has<ITheme>();
+    if (name == QLatin1String("AppMenu")) return m_registry->has<IMenu>();
+    if (name == QLatin1String("EventBus")) return m_registry->has<IEventBus>();
+    if (name == QLatin1String("Diagnostics")) return m_registry->has<ResourceMonitor>();
+    return false;
 }
 
 QString QmlContext::version() const
@@ -65,4 +132,9 @@ QObject* QmlContext::eventBus() const
     return m_registry->getObject<IEventBus>();
 }
 
+QObject* QmlContext::diagnostics() const
+{
+    return m_registry->getObject<ResourceMonitor>();
+}
+
 } // namespace mpf
@@ -0,0 +1,114 @@
+#include "qml_resource_index.h"
+#include "startup_profiler.h"
+#include "qml_url_interceptor.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace mpf {
+
+QmlResourceIndex::QmlResourceIndex(const QStringList& searchPaths, QObject* parent)
+    : QObject(parent)
+    , m_preferResources(QmlUrlInterceptor::preferResources())
+{
+    for (const QString& path : searchPaths) {
+        QString clean = QDir::cleanPath(QDir(path).absolutePath());
+        if (!m_searchPaths.contains(clean) && QFileInfo(clean).isDir()) {
+            m_searchPaths.append(clean);
+        }
+    }
+}
+
+QString QmlResourceIndex::moduleDirectory(const QString& uri) const
+{
+    return module(uri).directory;
+}
+
+QString QmlResourceIndex::fileUrl(const QString& uri, const QString& fileName) const
+{
+    // Compiled copy linked into a binary (qt_add_qml_module with RESOURCE_PREFIX /);
+    // looking it up only walks the in-memory resource tree
+    if (m_preferResources) {
+        QString resource = '/' + QString(uri).replace('.', '/') + '/' + fileName;
+        if (QFile::exists(':' + resource)) {
+            return "qrc:" + resource;
+        }
+    }
+    
+    return module(uri).files.value(fileName);
+}
+
+int QmlResourceIndex::moduleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(std::count_if(m_modules.cbegin(), m_modules.cend(), [](const Module& module) {
+        return !module.directory.isEmpty();
+    }));
+}
+
+QmlResourceIndex::Module QmlResourceIndex::module(const QString& uri) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_modules.constFind(uri);
+    if (it == m_modules.constEnd()) {
+        // Unknown modules are remembered too, so each URI is scanned once
+        it = m_modules.insert(uri, scan(uri));
+    }
+    return *it;
+}
+
+QmlResourceIndex::Module QmlResourceIndex::scan(const QString& uri) const
+{
+    MPF_PROFILE_SCOPE("index QML module " + uri, "qml");
+    QElapsedTimer timer;
+    timer.start();
+    
+    // The first search path with the module directory wins, matching the
+    // order plugins used to probe in
+    Module module;
+    const QString relative = QString(uri).replace('.', '/');
+    for (const QString& root : m_searchPaths) {
+        QString directory = root + '/' + relative;
+        if (QFileInfo::exists(directory + "/qmldir")) {
+            module.directory = directory;
+            break;
+        }
+    }
+    if (module.directory.isEmpty()) {
+        qDebug() << "QML resource index: No module" << uri << "on" << m_searchPaths;
+        return module;
+    }
+    
+    // Walk only the module's own tree: a subdirectory with a qmldir is
+    // another module and indexed under its own URI
+    QStringList pending{module.directory};
+    while (!pending.isEmpty()) {
+        QDir dir(pending.takeLast());
+        const QFileInfoList entries = dir.entryInfoList({"*.qml"}, QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
+        for (const QFileInfo& entry : entries) {
+            if (entry.isDir()) {
+                if (!QFileInfo::exists(entry.filePath() + "/qmldir")) {
+                    pending.append(entry.filePath());
+                }
+            } else {
+                module.files.insert(entry.filePath().mid(module.directory.size() + 1),
+                                    QUrl::fromLocalFile(entry.filePath()).toString());
+            }
+        }
+    }
+    
+    qDebug().noquote() << QString("QML resource index: %1 (%2 files) from %3 in %4 ms")
+        .arg(uri)
+        .arg(module.files.size())
+        .arg(module.directory)
+        .arg(timer.nsecsElapsed() / 1.0e6, 0, 'f', 2);
+    return module;
+}
+
+} // namespace mpf
@@ -0,0 +1,75 @@
+#include "qml_url_interceptor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QUrl>
+
+namespace mpf {
+
+QmlUrlInterceptor::QmlUrlInterceptor(const QStringList& roots)
+    : m_redirect(preferResources())
+{
+    for (const QString& root : roots) {
+        QString clean = QDir::cleanPath(QDir(root).absolutePath());
+        if (!m_roots.contains(clean)) {
+            m_roots.append(clean);
+        }
+    }
+}
+
+bool QmlUrlInterceptor::preferResources()
+{
+    return qEnvironmentVariableIntValue("MPF_QML_FROM_DISK") <= 0;
+}
+
+QUrl QmlUrlInterceptor::intercept(const QUrl& url, DataType type)
+{
+    // qmldir files stay where they are: they may name plugin libraries
+    // relative to their directory
+    if (type != QmlFile && type != JavaScriptFile) {
+        return url;
+    }
+    
+    if (m_redirect && url.isLocalFile()) {
+        QString path = QDir::cleanPath(url.toLocalFile());
+        for (const QString& root : std::as_const(m_roots)) {
+            if (!path.startsWith(root + '/')) {
+                continue;
+            }
+            QString resource = path.mid(root.size());  // Keeps the leading '/'
+            if (QFile::exists(':' + resource)) {
+                QUrl redirected("qrc:" + resource);
+                record(redirected);
+                return redirected;
+            }
+        }
+    }
+    
+    record(url);
+    return url;
+}
+
+void QmlUrlInterceptor::record(const QUrl& url)
+{
+    bool resource = url.scheme() == QLatin1String("qrc");
+    
+    QMutexLocker locker(&m_mutex);
+    (resource ? m_resourceUrls : m_diskUrls).insert(url.toString());
+}
+
+int QmlUrlInterceptor::resourceCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_resourceUrls.size();
+}
+
+QStringList QmlUrlInterceptor::diskLoaded() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList urls = m_diskUrls.values();
+    urls.sort();
+    return urls;
+}
+
+} // namespace mpf
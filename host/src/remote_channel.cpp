@@ -0,0 +1,267 @@
+#include "remote_channel.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDeadlineTimer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstring>
+
+namespace mpf {
+
+namespace {
+
+enum class PayloadKind : quint8 {
+    Inline,
+    Shared      // Followed by segment key and size
+};
+
+QByteArray encodeCall(const QString& service, const QString& method, const QVariantList& args)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << service << method << args;
+    return payload;
+}
+
+} // namespace
+
+RemoteChannel::RemoteChannel(QLocalSocket* socket, QObject* parent)
+    : QObject(parent)
+    , m_socket(socket)
+{
+    m_socket->setParent(this);
+    connect(m_socket, &QLocalSocket::readyRead, this, &RemoteChannel::processIncoming);
+    connect(m_socket, &QLocalSocket::disconnected, this, &RemoteChannel::disconnected);
+}
+
+RemoteChannel::~RemoteChannel() = default;
+
+QVariant RemoteChannel::call(const QString& service, const QString& method,
+                             const QVariantList& args, int timeoutMs)
+{
+    if (!isConnected()) {
+        return QVariant();
+    }
+    
+    quint32 id = m_nextId++;
+    m_waiting.insert(id);
+    send(MessageType::Call, id, encodeCall(service, method, args));
+    
+    // Keep serving the peer while waiting; it may call back before replying
+    QDeadlineTimer deadline(timeoutMs);
+    while (!m_replies.contains(id)) {
+        processIncoming();
+        if (m_replies.contains(id)) {
+            break;
+        }
+        if (!isConnected() || deadline.hasExpired()) {
+            qWarning() << "RemoteChannel:" << service + "::" + method
+                       << (isConnected() ? "timed out" : "failed: peer disconnected");
+            m_waiting.remove(id);
+            return QVariant();
+        }
+        m_socket->waitForReadyRead(int(deadline.remainingTime()));
+    }
+    
+    m_waiting.remove(id);
+    return m_replies.take(id);
+}
+
+void RemoteChannel::notify(const QString& service, const QString& method, const QVariantList& args)
+{
+    if (isConnected()) {
+        send(MessageType::Notify, 0, encodeCall(service, method, args));
+    }
+}
+
+void RemoteChannel::setCallHandler(RemoteCallHandler handler)
+{
+    m_callHandler = std::move(handler);
+}
+
+void RemoteChannel::setNotificationHandler(RemoteCallHandler handler)
+{
+    m_notificationHandler = std::move(handler);
+}
+
+bool RemoteChannel::isConnected() const
+{
+    return m_socket->state() == QLocalSocket::ConnectedState;
+}
+
+void RemoteChannel::send(MessageType type, quint32 id, const QByteArray& payload)
+{
+    QByteArray body;
+    QDataStream out(&body, QIODevice::WriteOnly);
+    out << quint8(type) << id;
+    
+    if (payload.size() > inlineLimit()) {
+        // Large payload: hand over a shared memory segment instead of streaming it
+        QString key = QString("mpf-remote-%1-%2-%3")
+            .arg(QCoreApplication::applicationPid())
+            .arg(reinterpret_cast<quintptr>(this), 0, 16)
+            .arg(m_nextSegment++);
+        auto segment = std::make_shared<QSharedMemory>(key);
+        if (segment->create(payload.size())) {
+            segment->lock();
+            std::memcpy(segment->data(), payload.constData(), payload.size());
+            segment->unlock();
+            m_outgoing.insert(key, segment);
+            m_sharedTransfers++;
+            
+            out << quint8(PayloadKind::Shared) << key << qint32(payload.size());
+            sendFrame(body);
+            return;
+        }
+        qWarning() << "RemoteChannel: Shared memory unavailable, sending inline:" << segment->errorString();
+    }
+    
+    out << quint8(PayloadKind::Inline) << payload;
+    sendFrame(body);
+}
+
+void RemoteChannel::sendFrame(const QByteArray& body)
+{
+    char size[4];
+    qToBigEndian<quint32>(quint32(body.size()), size);
+    m_socket->write(size, sizeof(size));
+    m_socket->write(body);
+    m_socket->flush();
+}
+
+void RemoteChannel::processIncoming()
+{
+    m_buffer.append(m_socket->readAll());
+    
+    while (m_buffer.size() >= 4) {
+        quint32 size = qFromBigEndian<quint32>(m_buffer.constData());
+        if (quint32(m_buffer.size()) - 4 < size) {
+            return;  // Frame not complete yet
+        }
+        
+        // Take the frame out first: dispatching may re-enter through call()
+        QByteArray body = m_buffer.mid(4, size);
+        m_buffer.remove(0, 4 + size);
+        
+        QDataStream in(body);
+        quint8 type;
+        quint32 id;
+        in >> type >> id;
+        QByteArray payload = readPayload(in);
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "RemoteChannel: Dropping malformed message";
+            continue;
+        }
+        dispatch(MessageType(type), id, payload);
+    }
+}
+
+QByteArray RemoteChannel::readPayload(QDataStream& in)
+{
+    quint8 kind;
+    in >> kind;
+    
+    QByteArray payload;
+    if (PayloadKind(kind) == PayloadKind::Inline) {
+        in >> payload;
+        return payload;
+    }
+    
+    QString key;
+    qint32 size;
+    in >> key >> size;
+    
+    QSharedMemory segment(key);
+    if (!segment.attach(QSharedMemory::ReadOnly)) {
+        qWarning() << "RemoteChannel: Cannot attach payload segment" << key << segment.errorString();
+        in.setStatus(QDataStream::ReadCorruptData);
+        return payload;
+    }
+    
+    // A size the segment cannot hold would read past the mapping
+    if (size < 0 || size > segment.size()) {
+        qWarning() << "RemoteChannel: Payload size" << size << "does not fit segment" << key
+                   << "of" << segment.size() << "bytes";
+        in.setStatus(QDataStream::ReadCorruptData);
+    } else {
+        segment.lock();
+        payload = QByteArray(static_cast<const char*>(segment.constData()), size);
+        segment.unlock();
+    }
+    segment.detach();
+    
+    // The sender keeps the segment alive until we are done with it
+    QByteArray release;
+    QDataStream(&release, QIODevice::WriteOnly) << key;
+    send(MessageType::Release, 0, release);
+    return payload;
+}
+
+void RemoteChannel::dispatch(MessageType type, quint32 id, const QByteArray& payload)
+{
+    QDataStream in(payload);
+    
+    switch (type) {
+    case MessageType::Call:
+    case MessageType::Notify: {
+        QString service;
+        QString method;
+        QVariantList args;
+        in >> service >> method >> args;
+        
+        const RemoteCallHandler& handler = (type == MessageType::Call) ? m_callHandler : m_notificationHandler;
+        QVariant result = handler ? handler(service, method, args) : QVariant();
+        
+        if (type == MessageType::Call) {
+            QByteArray reply;
+            QDataStream(&reply, QIODevice::WriteOnly) << result;
+            send(MessageType::Reply, id, reply);
+        }
+        break;
+    }
+    case MessageType::Reply: {
+        QVariant result;
+        in >> result;
+        if (m_waiting.contains(id)) {
+            m_replies.insert(id, result);
+        }
+        break;
+    }
+    case MessageType::Release: {
+        QString key;
+        in >> key;
+        m_outgoing.remove(key);
+        break;
+    }
+    }
+}
+
+MenuItem menuItemFromVariant(const QVariantMap& map)
+{
+    MenuItem item;
+    item.id = map.value("id").toString();
+    item.label = map.value("label").toString();
+    item.icon = map.value("icon").toString();
+    item.route = map.value("route").toString();
+    item.group = map.value("group").toString();
+    item.order = map.value("order").toInt();
+    item.enabled = map.value("enabled", true).toBool();
+    item.badge = map.value("badge").toString();
+    item.pluginId = map.value("pluginId").toString();
+    return item;
+}
+
+SubscriptionOptions subscriptionOptionsFromVariant(const QVariantMap& map)
+{
+    SubscriptionOptions options;
+    options.async = map.value("async", true).toBool();
+    options.priority = map.value("priority").toInt();
+    options.receiveOwnEvents = map.value("receiveOwnEvents", false).toBool();
+    return options;
+}
+
+} // namespace mpf
@@ -0,0 +1,392 @@
+#include "remote_plugin.h"
+#include "remote_channel.h"
+#include "event_bus_service.h"
+#include "plugin_context.h"
+#include "lifecycle_watchdog.h"
+#include "resource_monitor.h"
+#include <mpf/service_registry.h>
+#include <mpf/interfaces/inavigation.h>
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/isettings.h>
+#include <mpf/interfaces/ieventbus.h>
+
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QDebug>
+
+#include <limits>
+#include <utility>
+
+namespace mpf {
+
+namespace {
+
+constexpr int kConnectTimeoutMs = 10000;
+constexpr int kUnlimitedWaitMs = 30000;     // Phases the metadata gives no limit
+constexpr int kBenchmarkPayloadSize = 256 * 1024;
+
+QString pluginHostProgram()
+{
+    return QDir(QCoreApplication::applicationDirPath()).filePath("mpf-plugin-host");
+}
+
+QString formatPerCall(qint64 totalNs, int iterations)
+{
+    return QString::number(totalNs / 1000.0 / iterations, 'f', 2) + " us";
+}
+
+} // namespace
+
+RemotePlugin::RemotePlugin(const QString& path, const QJsonObject& metadata, QObject* parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_id(metadata.value("id").toString())
+    , m_metadata(metadata)
+{
+}
+
+RemotePlugin::~RemotePlugin()
+{
+    shutdown();
+}
+
+bool RemotePlugin::initialize(ServiceRegistry* registry)
+{
+    m_registry = registry;
+    
+    // Starting the plugin host counts towards the initialize() budget
+    QDeadlineTimer deadline(lifecycleTimeoutMs("initialize"));
+    if (!launch({"--plugin", m_path}, deadline)) {
+        kill();
+        return false;
+    }
+    
+    // Deliver the plugin's subscriptions; the bus itself only broadcasts
+    if (auto* eventBus = dynamic_cast<EventBusService*>(m_registry->get<IEventBus>())) {
+        connect(eventBus, &EventBusService::eventPublished, this, &RemotePlugin::forwardEvent);
+    }
+    
+    QVariantMap reply = callLifecycle("initialize", int(deadline.remainingTime())).toMap();
+    m_qmlModuleUri = reply.value("qmlModuleUri").toString();
+    m_entryQml = reply.value("entryQml").toString();
+    return reply.value("ok").toBool();
+}
+
+bool RemotePlugin::start()
+{
+    return callLifecycle("start", lifecycleTimeoutMs("start")).toBool();
+}
+
+void RemotePlugin::stop()
+{
+    callLifecycle("stop", lifecycleTimeoutMs("stop"));
+}
+
+int RemotePlugin::lifecycleTimeoutMs(const QString& phase) const
+{
+    // Same budget as the watchdog applies to in-process plugins
+    qint64 budget = m_metadata.value("timeouts").toObject().value(phase).toInteger(-1);
+    if (budget < 0) {
+        budget = LifecycleWatchdog::defaultBudgetMs(phase);
+    }
+    return budget > 0 ? int(qMin<qint64>(budget, std::numeric_limits<int>::max())) : kUnlimitedWaitMs;
+}
+
+QVariant RemotePlugin::callLifecycle(const QString& phase, int timeoutMs)
+{
+    if (!m_channel) {
+        return QVariant();
+    }
+    
+    // The GUI thread waits for the reply, so a hung plugin host is given up
+    QVariant reply = m_channel->call("Plugin", phase, {}, qMax(1, timeoutMs));
+    if (!reply.isValid()) {
+        qWarning().noquote() << QString("Plugin host for %1 did not finish %2() within %3 ms, killing it")
+            .arg(m_id, phase).arg(timeoutMs);
+        kill();
+    }
+    return reply;
+}
+
+void RemotePlugin::runBenchmark(ServiceRegistry* registry, int iterations)
+{
+    ISettings* settings = registry->get<ISettings>();
+    IEventBus* eventBus = registry->get<IEventBus>();
+    if (!settings || !eventBus) {
+        qWarning() << "Remote benchmark: ISettings and IEventBus are required";
+        return;
+    }
+    
+    RemotePlugin remote(QString(), QJsonObject{{"id", "benchmark"}});
+    remote.m_registry = registry;
+    if (!remote.launch({"--benchmark"}, QDeadlineTimer(kConnectTimeoutMs))) {
+        return;
+    }
+    QVariantMap result = remote.m_channel->call("Benchmark", "run", {iterations}, -1).toMap();
+    if (result.isEmpty()) {
+        qWarning() << "Remote benchmark: plugin host returned no results";
+        return;
+    }
+    
+    // Same calls in process
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        settings->value("benchmark", "key");
+    }
+    qint64 callNs = timer.nsecsElapsed();
+    
+    QVariantMap payload{{"blob", QByteArray(kBenchmarkPayloadSize, 'x')}};
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        eventBus->publish("benchmark/payload", payload, "benchmark");
+    }
+    qint64 payloadNs = timer.nsecsElapsed();
+    
+    qInfo().noquote() << QString("Remote benchmark (%1 iterations):").arg(iterations);
+    qInfo().noquote() << "  ISettings::value    in-process" << formatPerCall(callNs, iterations)
+                      << " out-of-process" << formatPerCall(result.value("callNs").toLongLong(), iterations);
+    qInfo().noquote() << QString("  IEventBus::publish (%1 KiB)").arg(kBenchmarkPayloadSize / 1024)
+                      << "in-process" << formatPerCall(payloadNs, iterations)
+                      << " out-of-process" << formatPerCall(result.value("payloadNs").toLongLong(), iterations)
+                      << "(" << result.value("sharedTransfers").toLongLong() << "shared memory transfers)";
+}
+
+bool RemotePlugin::launch(const QStringList& arguments, QDeadlineTimer deadline)
+{
+    QString serverName = QString("mpf-plugin-%1-%2")
+        .arg(QCoreApplication::applicationPid())
+        .arg(reinterpret_cast<quintptr>(this), 0, 16);
+    
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    QLocalServer::removeServer(serverName);
+    if (!m_server->listen(serverName)) {
+        qWarning() << "RemotePlugin: Cannot listen on" << serverName << m_server->errorString();
+        return false;
+    }
+    
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::ForwardedChannels);
+    connect(m_process, &QProcess::finished, this, [this](int exitCode, QProcess::ExitStatus status) {
+        if (status == QProcess::CrashExit || exitCode != 0) {
+            qWarning() << "Plugin host for" << m_id << "exited with code" << exitCode
+                       << (status == QProcess::CrashExit ? "(crashed)" : "");
+        }
+    });
+    m_process->start(pluginHostProgram(), QStringList{"--server", serverName} + arguments);
+    if (!m_process->waitForStarted(int(deadline.remainingTime()))) {
+        qWarning() << "RemotePlugin: Cannot start" << pluginHostProgram() << m_process->errorString();
+        return false;
+    }
+    
+    if (!m_server->waitForNewConnection(int(deadline.remainingTime()))) {
+        qWarning() << "RemotePlugin: Plugin host for" << m_id << "did not connect";
+        return false;
+    }
+    
+    m_channel = new RemoteChannel(m_server->nextPendingConnection(), this);
+    m_channel->setCallHandler([this](const QString& service, const QString& method,
+                                     const QVariantList& args) {
+        return dispatch(service, method, args);
+    });
+    m_server->close();
+    return true;
+}
+
+void RemotePlugin::kill()
+{
+    delete m_channel;
+    m_channel = nullptr;
+    
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished();
+    }
+}
+
+void RemotePlugin::shutdown()
+{
+    delete m_channel;   // Closing the connection makes the plugin host exit
+    m_channel = nullptr;
+    
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        if (!m_process->waitForFinished(3000)) {
+            qWarning() << "Plugin host for" << m_id << "did not exit, killing it";
+            m_process->kill();
+            m_process->waitForFinished();
+        }
+    }
+}
+
+QVariant RemotePlugin::dispatch(const QString& service, const QString& method, const QVariantList& args)
+{
+    // Calls are served as if the plugin had made them in process
+    PluginContextScope context(m_id);
+    
+    if (service == "INavigation") {
+        return dispatchNavigation(method, args);
+    }
+    if (service == "IMenu") {
+        return dispatchMenu(method, args);
+    }
+    if (service == "ISettings") {
+        return dispatchSettings(method, args);
+    }
+    if (service == "IEventBus") {
+        return dispatchEventBus(method, args);
+    }
+    
+    qWarning() << "RemotePlugin: Unknown service" << service << "called by" << m_id;
+    return QVariant();
+}
+
+QVariant RemotePlugin::dispatchNavigation(const QString& method, const QVariantList& args)
+{
+    INavigation* navigation = m_registry->get<INavigation>();
+    if (!navigation) {
+        return QVariant();
+    }
+    
+    if (method == "registerRoute") {
+        navigation->registerRoute(args.value(0).toString(), args.value(1).toString());
+    } else if (method == "getPageUrl") {
+        return navigation->getPageUrl(args.value(0).toString());
+    } else if (method == "currentRoute") {
+        return navigation->currentRoute();
+    } else if (method == "setCurrentRoute") {
+        navigation->setCurrentRoute(args.value(0).toString());
+    } else {
+        qWarning() << "RemotePlugin: Unknown method INavigation::" + method;
+    }
+    return QVariant();
+}
+
+QVariant RemotePlugin::dispatchMenu(const QString& method, const QVariantList& args)
+{
+    IMenu* menu = m_registry->get<IMenu>();
+    if (!menu) {
+        return QVariant();
+    }
+    
+    if (method == "registerItem") {
+        return menu->registerItem(menuItemFromVariant(args.value(0).toMap()));
+    } else if (method == "unregisterItem") {
+        menu->unregisterItem(args.value(0).toString());
+    } else if (method == "unregisterPlugin") {
+        menu->unregisterPlugin(args.value(0).toString());
+    } else if (method == "updateItem") {
+        return menu->updateItem(args.value(0).toString(), args.value(1).toMap());
+    } else if (method == "setBadge") {
+        menu->setBadge(args.value(0).toString(), args.value(1).toString());
+    } else if (method == "setEnabled") {
+        menu->setEnabled(args.value(0).toString(), args.value(1).toBool());
+    } else if (method == "itemsAsVariant") {
+        return menu->itemsAsVariant();
+    } else if (method == "itemsInGroup") {
+        return menu->itemsInGroup(args.value(0).toString());
+    } else if (method == "groups") {
+        return menu->groups();
+    } else if (method == "count") {
+        return menu->count();
+    } else {
+        qWarning() << "RemotePlugin: Unknown method IMenu::" + method;
+    }
+    return QVariant();
+}
+
+QVariant RemotePlugin::dispatchSettings(const QString& method, const QVariantList& args)
+{
+    ISettings* settings = m_registry->get<ISettings>();
+    if (!settings) {
+        return QVariant();
+    }
+    
+    QString pluginId = args.value(0).toString();
+    if (method == "value") {
+        return settings->value(pluginId, args.value(1).toString(), args.value(2));
+    } else if (method == "setValue") {
+        settings->setValue(pluginId, args.value(1).toString(), args.value(2));
+    } else if (method == "remove") {
+        settings->remove(pluginId, args.value(1).toString());
+    } else if (method == "contains") {
+        return settings->contains(pluginId, args.value(1).toString());
+    } else if (method == "keys") {
+        return settings->keys(pluginId);
+    } else if (method == "sync") {
+        settings->sync();
+    } else {
+        qWarning() << "RemotePlugin: Unknown method ISettings::" + method;
+    }
+    return QVariant();
+}
+
+QVariant RemotePlugin::dispatchEventBus(const QString& method, const QVariantList& args)
+{
+    IEventBus* eventBus = m_registry->get<IEventBus>();
+    if (!eventBus) {
+        return QVariant();
+    }
+    
+    if (method == "publish") {
+        return eventBus->publish(args.value(0).toString(), args.value(1).toMap(), args.value(2).toString());
+    } else if (method == "publishSync") {
+        return eventBus->publishSync(args.value(0).toString(), args.value(1).toMap(), args.value(2).toString());
+    } else if (method == "subscribe") {
+        QString pattern = args.value(0).toString();
+        QString subscriberId = args.value(1).toString();
+        SubscriptionOptions options = subscriptionOptionsFromVariant(args.value(2).toMap());
+        QString id = eventBus->subscribe(pattern, subscriberId, options);
+        if (!id.isEmpty()) {
+            m_subscriptions.insert(id, Subscription{pattern, subscriberId, options.receiveOwnEvents});
+        }
+        return id;
+    } else if (method == "unsubscribe") {
+        QString id = args.value(0).toString();
+        m_subscriptions.remove(id);
+        return eventBus->unsubscribe(id);
+    } else if (method == "unsubscribeAll") {
+        QString subscriberId = args.value(0).toString();
+        for (const QString& id : eventBus->subscriptionsFor(subscriberId)) {
+            m_subscriptions.remove(id);
+        }
+        eventBus->unsubscribeAll(subscriberId);
+    } else if (method == "subscriberCount") {
+        return eventBus->subscriberCount(args.value(0).toString());
+    } else if (method == "activeTopics") {
+        return eventBus->activeTopics();
+    } else if (method == "topicStats") {
+        return eventBus->topicStats(args.value(0).toString()).toVariantMap();
+    } else if (method == "subscriptionsFor") {
+        return eventBus->subscriptionsFor(args.value(0).toString());
+    } else if (method == "matchesTopic") {
+        return eventBus->matchesTopic(args.value(0).toString(), args.value(1).toString());
+    } else {
+        qWarning() << "RemotePlugin: Unknown method IEventBus::" + method;
+    }
+    return QVariant();
+}
+
+void RemotePlugin::forwardEvent(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    if (!m_channel || m_subscriptions.isEmpty()) {
+        return;
+    }
+    
+    // The subscriber is known here, unlike for in-process handlers
+    ResourceScope resources(m_id, ResourceCategory::Event);
+    IEventBus* eventBus = m_registry->get<IEventBus>();
+    for (const Subscription& sub : std::as_const(m_subscriptions)) {
+        if ((sub.receiveOwnEvents || senderId != sub.subscriberId) && eventBus->matchesTopic(topic, sub.pattern)) {
+            m_channel->notify("IEventBus", "eventPublished", {topic, data, senderId});
+            return;
+        }
+    }
+}
+
+} // namespace mpf
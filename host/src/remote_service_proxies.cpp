@@ -0,0 +1,318 @@
+#include "remote_service_proxies.h"
+#include "remote_channel.h"
+
+#include <QtFuture>
+
+#include <algorithm>
+
+namespace mpf {
+
+// =============================================================================
+// NavigationProxy
+// =============================================================================
+
+NavigationProxy::NavigationProxy(RemoteChannel* channel, QObject* parent)
+    : QObject(parent)
+    , m_channel(channel)
+{
+}
+
+void NavigationProxy::registerRoute(const QString& route, const QString& qmlPageUrl)
+{
+    m_channel->call("INavigation", "registerRoute", {route, qmlPageUrl});
+}
+
+QString NavigationProxy::getPageUrl(const QString& route) const
+{
+    return m_channel->call("INavigation", "getPageUrl", {route}).toString();
+}
+
+QString NavigationProxy::currentRoute() const
+{
+    return m_channel->call("INavigation", "currentRoute").toString();
+}
+
+void NavigationProxy::setCurrentRoute(const QString& route)
+{
+    m_channel->call("INavigation", "setCurrentRoute", {route});
+}
+
+// =============================================================================
+// MenuProxy
+// =============================================================================
+
+MenuProxy::MenuProxy(RemoteChannel* channel, QObject* parent)
+    : QObject(parent)
+    , m_channel(channel)
+{
+}
+
+bool MenuProxy::registerItem(const MenuItem& item)
+{
+    return m_channel->call("IMenu", "registerItem", {item.toVariantMap()}).toBool();
+}
+
+void MenuProxy::unregisterItem(const QString& id)
+{
+    m_channel->call("IMenu", "unregisterItem", {id});
+}
+
+void MenuProxy::unregisterPlugin(const QString& pluginId)
+{
+    m_channel->call("IMenu", "unregisterPlugin", {pluginId});
+}
+
+bool MenuProxy::updateItem(const QString& id, const QVariantMap& updates)
+{
+    return m_channel->call("IMenu", "updateItem", {id, updates}).toBool();
+}
+
+void MenuProxy::setBadge(const QString& id, const QString& badge)
+{
+    m_channel->call("IMenu", "setBadge", {id, badge});
+}
+
+void MenuProxy::setEnabled(const QString& id, bool enabled)
+{
+    m_channel->call("IMenu", "setEnabled", {id, enabled});
+}
+
+QList<MenuItem> MenuProxy::items() const
+{
+    QList<MenuItem> result;
+    for (const QVariant& value : itemsAsVariant()) {
+        result.append(menuItemFromVariant(value.toMap()));
+    }
+    return result;
+}
+
+QVariantList MenuProxy::itemsAsVariant() const
+{
+    return m_channel->call("IMenu", "itemsAsVariant").toList();
+}
+
+QVariantList MenuProxy::itemsInGroup(const QString& group) const
+{
+    return m_channel->call("IMenu", "itemsInGroup", {group}).toList();
+}
+
+QStringList MenuProxy::groups() const
+{
+    return m_channel->call("IMenu", "groups").toStringList();
+}
+
+int MenuProxy::count() const
+{
+    return m_channel->call("IMenu", "count").toInt();
+}
+
+// =============================================================================
+// SettingsProxy
+// =============================================================================
+
+SettingsProxy::SettingsProxy(RemoteChannel* channel, QObject* parent)
+    : QObject(parent)
+    , m_channel(channel)
+{
+}
+
+QVariant SettingsProxy::value(const QString& pluginId, const QString& key,
+                              const QVariant& defaultValue) const
+{
+    return m_channel->call("ISettings", "value", {pluginId, key, defaultValue});
+}
+
+void SettingsProxy::setValue(const QString& pluginId, const QString& key, const QVariant& value)
+{
+    m_channel->call("ISettings", "setValue", {pluginId, key, value});
+}
+
+void SettingsProxy::remove(const QString& pluginId, const QString& key)
+{
+    m_channel->call("ISettings", "remove", {pluginId, key});
+}
+
+bool SettingsProxy::contains(const QString& pluginId, const QString& key) const
+{
+    return m_channel->call("ISettings", "contains", {pluginId, key}).toBool();
+}
+
+QStringList SettingsProxy::keys(const QString& pluginId) const
+{
+    return m_channel->call("ISettings", "keys", {pluginId}).toStringList();
+}
+
+void SettingsProxy::sync()
+{
+    m_channel->call("ISettings", "sync");
+}
+
+// =============================================================================
+// EventBusProxy
+// =============================================================================
+
+EventBusProxy::EventBusProxy(RemoteChannel* channel, QObject* parent)
+    : QObject(parent)
+    , m_channel(channel)
+{
+}
+
+int EventBusProxy::publish(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    return m_channel->call("IEventBus", "publish", {topic, data, senderId}).toInt();
+}
+
+int EventBusProxy::publishSync(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    return m_channel->call("IEventBus", "publishSync", {topic, data, senderId}).toInt();
+}
+
+QString EventBusProxy::subscribe(const QString& pattern, const QString& subscriberId,
+                                 const SubscriptionOptions& options)
+{
+    return m_channel->call("IEventBus", "subscribe",
+                           {pattern, subscriberId, options.toVariantMap()}).toString();
+}
+
+bool EventBusProxy::unsubscribe(const QString& subscriptionId)
+{
+    return m_channel->call("IEventBus", "unsubscribe", {subscriptionId}).toBool();
+}
+
+void EventBusProxy::unsubscribeAll(const QString& subscriberId)
+{
+    m_channel->call("IEventBus", "unsubscribeAll", {subscriberId});
+}
+
+int EventBusProxy::subscriberCount(const QString& topic) const
+{
+    return m_channel->call("IEventBus", "subscriberCount", {topic}).toInt();
+}
+
+QStringList EventBusProxy::activeTopics() const
+{
+    return m_channel->call("IEventBus", "activeTopics").toStringList();
+}
+
+TopicStats EventBusProxy::topicStats(const QString& topic) const
+{
+    QVariantMap map = m_channel->call("IEventBus", "topicStats", {topic}).toMap();
+    TopicStats stats;
+    stats.topic = topic;
+    stats.subscriberCount = map.value("subscriberCount").toInt();
+    stats.eventCount = map.value("eventCount").toLongLong();
+    stats.lastEventTime = map.value("lastEventTime").toLongLong();
+    return stats;
+}
+
+QStringList EventBusProxy::subscriptionsFor(const QString& subscriberId) const
+{
+    return m_channel->call("IEventBus", "subscriptionsFor", {subscriberId}).toStringList();
+}
+
+bool EventBusProxy::matchesTopic(const QString& topic, const QString& pattern) const
+{
+    return m_channel->call("IEventBus", "matchesTopic", {topic, pattern}).toBool();
+}
+
+void EventBusProxy::deliver(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    emit eventPublished(topic, data, senderId);
+}
+
+// =============================================================================
+// RemoteServiceRegistry
+// =============================================================================
+
+RemoteServiceRegistry::RemoteServiceRegistry(RemoteChannel* channel)
+{
+    auto* navigation = new NavigationProxy(channel);
+    auto* menu = new MenuProxy(channel);
+    auto* settings = new SettingsProxy(channel);
+    m_eventBus = new EventBusProxy(channel);
+    m_proxies = {navigation, menu, settings, m_eventBus};
+    
+    add<INavigation>(navigation, INavigation::apiVersion(), "host");
+    add<IMenu>(menu, IMenu::apiVersion(), "host");
+    add<ISettings>(settings, ISettings::apiVersion(), "host");
+    add<IEventBus>(m_eventBus, IEventBus::apiVersion(), "host");
+}
+
+RemoteServiceRegistry::~RemoteServiceRegistry()
+{
+    qDeleteAll(m_proxies);
+}
+
+QObject* RemoteServiceRegistry::getService(const char* typeName, int minVersion)
+{
+    for (const Entry& entry : m_services.value(QByteArray(typeName))) {
+        if (minVersion <= 0 || entry.version >= minVersion) {
+            return entry.instance;
+        }
+    }
+    return nullptr;
+}
+
+QList<QObject*> RemoteServiceRegistry::getServices(const char* typeName, int minVersion)
+{
+    QList<QObject*> result;
+    for (const Entry& entry : m_services.value(QByteArray(typeName))) {
+        if (minVersion <= 0 || entry.version >= minVersion) {
+            result.append(entry.instance);
+        }
+    }
+    return result;
+}
+
+bool RemoteServiceRegistry::addService(const char* typeName, QObject* instance, int version,
+                                       const QString& providerId)
+{
+    return addRankedService(typeName, instance, version, providerId, 0);
+}
+
+bool RemoteServiceRegistry::addRankedService(const char* typeName, QObject* instance, int version,
+                                             const QString& providerId, int rank)
+{
+    Q_UNUSED(providerId);
+    if (!instance) {
+        return false;
+    }
+    
+    QList<Entry>& entries = m_services[QByteArray(typeName)];
+    auto it = std::find_if(entries.begin(), entries.end(), [rank](const Entry& entry) {
+        return entry.rank < rank;
+    });
+    entries.insert(it, Entry{instance, version, rank});
+    m_generation++;
+    
+    for (auto pending = m_pending.begin(); pending != m_pending.end();) {
+        if (pending->typeName == typeName
+            && (pending->minVersion <= 0 || version >= pending->minVersion)) {
+            pending->promise->addResult(instance);
+            pending->promise->finish();
+            pending = m_pending.erase(pending);
+        } else {
+            ++pending;
+        }
+    }
+    return true;
+}
+
+bool RemoteServiceRegistry::hasService(const char* typeName, int minVersion) const
+{
+    return const_cast<RemoteServiceRegistry*>(this)->getService(typeName, minVersion) != nullptr;
+}
+
+QFuture<QObject*> RemoteServiceRegistry::serviceAvailable(const char* typeName, int minVersion)
+{
+    if (QObject* service = getService(typeName, minVersion)) {
+        return QtFuture::makeReadyValueFuture(service);
+    }
+    
+    auto promise = std::make_shared<QPromise<QObject*>>();
+    promise->start();
+    m_pending.append({QByteArray(typeName), minVersion, promise});
+    return promise->future();
+}
+
+} // namespace mpf
@@ -0,0 +1,262 @@
+#include "resource_monitor.h"
+#include "plugin_context.h"
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <algorithm>
+#include <memory>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace mpf {
+
+QAtomicInt ResourceMonitor::s_enabled = 0;
+thread_local HeapCounters* ResourceMonitor::s_heapCounters = nullptr;
+
+namespace {
+
+struct ResourceStore
+{
+    QReadWriteLock lock;
+    QHash<QString, std::shared_ptr<PluginResources>> plugins;  // Never removed: scopes hold raw pointers
+};
+
+Q_GLOBAL_STATIC(ResourceStore, store)
+
+// Innermost active scope of this thread
+thread_local ResourceScope* t_activeScope = nullptr;
+
+double toMs(const QAtomicInteger<qint64>& ns)
+{
+    return ns.loadRelaxed() / 1.0e6;
+}
+
+} // namespace
+
+ResourceMonitor::ResourceMonitor(QObject* parent)
+    : QObject(parent)
+{
+}
+
+ResourceMonitor::~ResourceMonitor() = default;
+
+void ResourceMonitor::setEnabled(bool enabled)
+{
+    if (isEnabled() == enabled) {
+        return;
+    }
+    s_enabled.storeRelaxed(enabled ? 1 : 0);
+    emit enabledChanged();
+}
+
+bool ResourceMonitor::heapAccounting()
+{
+#ifdef MPF_HEAP_ACCOUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+PluginResources* ResourceMonitor::resources(const QString& pluginId)
+{
+    {
+        QReadLocker locker(&store()->lock);
+        auto it = store()->plugins.constFind(pluginId);
+        if (it != store()->plugins.constEnd()) {
+            return it->get();
+        }
+    }
+    
+    QWriteLocker locker(&store()->lock);
+    std::shared_ptr<PluginResources>& entry = store()->plugins[pluginId];
+    if (!entry) {
+        entry = std::make_shared<PluginResources>();
+    }
+    return entry.get();
+}
+
+qint64 ResourceMonitor::threadCpuTime()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) * 100;  // 100 ns units
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+void ResourceMonitor::recordPublished(const QString& pluginId)
+{
+    if (isEnabled() && !pluginId.isEmpty()) {
+        resources(pluginId)->published.fetchAndAddRelaxed(1);
+    }
+}
+
+void ResourceMonitor::recordDelivered(const QString& pluginId)
+{
+    if (isEnabled() && !pluginId.isEmpty()) {
+        resources(pluginId)->delivered.fetchAndAddRelaxed(1);
+    }
+}
+
+void ResourceMonitor::recordSubscriptions(const QString& pluginId, int delta)
+{
+    // Tracked even while disabled so the figure stays correct when enabled later
+    if (!pluginId.isEmpty()) {
+        resources(pluginId)->subscriptions.fetchAndAddRelaxed(delta);
+    }
+}
+
+QVariantList ResourceMonitor::snapshot() const
+{
+    QList<QPair<QString, std::shared_ptr<PluginResources>>> plugins;
+    {
+        QReadLocker locker(&store()->lock);
+        for (auto it = store()->plugins.constBegin(); it != store()->plugins.constEnd(); ++it) {
+            plugins.append({it.key(), it.value()});
+        }
+    }
+    
+    QVariantList rows;
+    for (const auto& [id, resources] : std::as_const(plugins)) {
+        const PluginResources& r = *resources;
+        double lifecycleMs = toMs(r.cpuNs[int(ResourceCategory::Lifecycle)]);
+        double serviceMs = toMs(r.cpuNs[int(ResourceCategory::Service)]);
+        double eventMs = toMs(r.cpuNs[int(ResourceCategory::Event)]);
+        
+        qint64 calls = 0;
+        for (const auto& count : r.calls) {
+            calls += count.loadRelaxed();
+        }
+        
+        qint64 allocated = r.heap.allocated.loadRelaxed();
+        qint64 freed = r.heap.freed.loadRelaxed();
+        
+        QVariantMap row;
+        row["id"] = id;
+        row["lifecycleMs"] = lifecycleMs;
+        row["serviceMs"] = serviceMs;
+        row["eventMs"] = eventMs;
+        row["cpuMs"] = lifecycleMs + serviceMs + eventMs;
+        row["calls"] = calls;
+        row["heapAllocated"] = allocated;
+        row["heapFreed"] = freed;
+        row["heapNet"] = allocated - freed;
+        row["published"] = r.published.loadRelaxed();
+        row["delivered"] = r.delivered.loadRelaxed();
+        row["subscriptions"] = r.subscriptions.loadRelaxed();
+        rows.append(row);
+    }
+    
+    std::sort(rows.begin(), rows.end(), [](const QVariant& a, const QVariant& b) {
+        return a.toMap().value("cpuMs").toDouble() > b.toMap().value("cpuMs").toDouble();
+    });
+    return rows;
+}
+
+void ResourceMonitor::reset()
+{
+    QReadLocker locker(&store()->lock);
+    for (const auto& resources : std::as_const(store()->plugins)) {
+        for (int i = 0; i < int(ResourceCategory::Count); ++i) {
+            resources->cpuNs[i].storeRelaxed(0);
+            resources->calls[i].storeRelaxed(0);
+        }
+        resources->heap.allocated.storeRelaxed(0);
+        resources->heap.freed.storeRelaxed(0);
+        resources->published.storeRelaxed(0);
+        resources->delivered.storeRelaxed(0);
+    }
+}
+
+QString ResourceMonitor::report() const
+{
+    const QVariantList rows = snapshot();
+    
+    QStringList lines;
+    lines << QString("Plugin resource usage (%1 plugins, sorted by CPU time)").arg(rows.size());
+    lines << QString::asprintf("%10s %10s %10s %10s %8s %12s %10s %10s  %s",
+                               "cpu(ms)", "life(ms)", "svc(ms)", "event(ms)", "calls",
+                               "heapNet(KiB)", "published", "delivered", "plugin");
+    
+    for (const QVariant& value : rows) {
+        QVariantMap row = value.toMap();
+        QString heap = heapAccounting()
+            ? QString::number(row["heapNet"].toLongLong() / 1024)
+            : QStringLiteral("-");
+        lines << QString::asprintf("%10.2f %10.2f %10.2f %10.2f %8lld %12s %10lld %10lld  ",
+                                   row["cpuMs"].toDouble(),
+                                   row["lifecycleMs"].toDouble(),
+                                   row["serviceMs"].toDouble(),
+                                   row["eventMs"].toDouble(),
+                                   row["calls"].toLongLong(),
+                                   qPrintable(heap),
+                                   row["published"].toLongLong(),
+                                   row["delivered"].toLongLong())
+                 + row["id"].toString();
+    }
+    
+    return lines.join('\n');
+}
+
+void ResourceScope::begin(const QString& pluginId, ResourceCategory category)
+{
+    m_resources = ResourceMonitor::resources(pluginId);
+    m_category = category;
+    m_resources->calls[int(category)].fetchAndAddRelaxed(1);
+    
+    // Pause the enclosing scope so CPU time is only counted once
+    qint64 now = ResourceMonitor::threadCpuTime();
+    m_parent = t_activeScope;
+    if (m_parent) {
+        m_parent->m_resources->cpuNs[int(m_parent->m_category)]
+            .fetchAndAddRelaxed(now - m_parent->m_startCpuNs);
+    }
+    t_activeScope = this;
+    m_startCpuNs = now;
+    
+    m_parentHeap = ResourceMonitor::s_heapCounters;
+    ResourceMonitor::s_heapCounters = &m_resources->heap;
+}
+
+void ResourceScope::beginCurrent(ResourceCategory category)
+{
+    QString pluginId = PluginContext::current();
+    if (!pluginId.isEmpty()) {
+        begin(pluginId, category);
+    }
+}
+
+void ResourceScope::end()
+{
+    ResourceMonitor::s_heapCounters = m_parentHeap;
+    
+    qint64 now = ResourceMonitor::threadCpuTime();
+    m_resources->cpuNs[int(m_category)].fetchAndAddRelaxed(now - m_startCpuNs);
+    
+    // Resume the enclosing scope
+    t_activeScope = m_parent;
+    if (m_parent) {
+        m_parent->m_startCpuNs = now;
+    }
+}
+
+} // namespace mpf
@@ -0,0 +1,166 @@
+#include "route_table.h"
+
+#include <QUrlQuery>
+
+#include <algorithm>
+
+namespace mpf {
+
+namespace {
+
+bool isParam(const QString& segment)
+{
+    return segment.size() > 1 && segment.startsWith(':');
+}
+
+// Splits off the query string of a route, adding its items to params
+QString routePath(const QString& route, QVariantMap* params)
+{
+    qsizetype query = route.indexOf('?');
+    if (query < 0) {
+        return route;
+    }
+    if (params) {
+        const QUrlQuery items(route.mid(query + 1));
+        for (const auto& [key, value] : items.queryItems(QUrl::FullyDecoded)) {
+            params->insert(key, value);
+        }
+    }
+    return route.left(query);
+}
+
+} // namespace
+
+RouteTable::RouteTable()
+    : m_root(std::make_unique<Node>())
+{
+}
+
+RouteTable::~RouteTable() = default;
+
+bool RouteTable::isPattern(const QString& pattern)
+{
+    const QStringList segments = pattern.split('/');
+    return std::any_of(segments.begin(), segments.end(), isParam);
+}
+
+bool RouteTable::matches(const QString& pattern, const QString& route)
+{
+    const QStringList expected = pattern.split('/');
+    const QStringList actual = routePath(route, nullptr).split('/');
+    if (expected.size() != actual.size()) {
+        return false;
+    }
+    for (qsizetype i = 0; i < expected.size(); ++i) {
+        if (!isParam(expected.at(i)) && expected.at(i) != actual.at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RouteTable::insert(const QString& pattern, const QString& pageUrl, const QString& pluginId)
+{
+    Route route{pattern, pageUrl, pluginId, {}};
+    m_size++;
+    
+    if (!isPattern(pattern)) {
+        m_literal[pattern].append(route);
+        return;
+    }
+    
+    Node* node = m_root.get();
+    for (const QString& segment : pattern.split('/')) {
+        std::unique_ptr<Node>& child = isParam(segment) ? node->param : node->children[segment];
+        if (!child) {
+            child = std::make_unique<Node>();
+        }
+        if (isParam(segment)) {
+            route.paramNames.append(segment.mid(1));
+        }
+        node = child.get();
+    }
+    node->routes.append(route);
+}
+
+int RouteTable::removePlugin(const QString& pluginId)
+{
+    int removed = 0;
+    for (auto it = m_literal.begin(); it != m_literal.end();) {
+        removed += int(it->removeIf([&pluginId](const Route& route) {
+            return route.pluginId == pluginId;
+        }));
+        it = it->isEmpty() ? m_literal.erase(it) : std::next(it);
+    }
+    removed += removeFrom(m_root.get(), pluginId);
+    m_size -= removed;
+    return removed;
+}
+
+int RouteTable::removeFrom(Node* node, const QString& pluginId)
+{
+    int removed = int(node->routes.removeIf([&pluginId](const Route& route) {
+        return route.pluginId == pluginId;
+    }));
+    
+    // Drop branches that no longer lead to a route
+    auto isEmpty = [](const Node& n) { return n.routes.isEmpty() && n.children.empty() && !n.param; };
+    for (auto it = node->children.begin(); it != node->children.end();) {
+        removed += removeFrom(it->second.get(), pluginId);
+        it = isEmpty(*it->second) ? node->children.erase(it) : std::next(it);
+    }
+    if (node->param) {
+        removed += removeFrom(node->param.get(), pluginId);
+        if (isEmpty(*node->param)) {
+            node->param.reset();
+        }
+    }
+    return removed;
+}
+
+RouteTable::Match RouteTable::match(const QString& route) const
+{
+    Match result;
+    QString path = routePath(route, &result.params);
+    
+    auto literal = m_literal.constFind(path);
+    if (literal != m_literal.constEnd()) {
+        result.route = &literal->first();
+        return result;
+    }
+    
+    QStringList values;
+    if (const Node* node = walk(m_root.get(), path.split('/'), 0, values)) {
+        result.route = &node->routes.first();
+        for (qsizetype i = 0; i < result.route->paramNames.size(); ++i) {
+            result.params.insert(result.route->paramNames.at(i), values.at(i));
+        }
+    }
+    return result;
+}
+
+const RouteTable::Node* RouteTable::walk(const Node* node, const QStringList& segments, int index,
+                                         QStringList& values)
+{
+    if (index == segments.size()) {
+        return node->routes.isEmpty() ? nullptr : node;
+    }
+    
+    // Literal first; a dead end falls back to the parameter branch
+    auto child = node->children.find(segments.at(index));
+    if (child != node->children.end()) {
+        if (const Node* found = walk(child->second.get(), segments, index + 1, values)) {
+            return found;
+        }
+    }
+    if (node->param && !segments.at(index).isEmpty()) {
+        values.append(segments.at(index));
+        if (const Node* found = walk(node->param.get(), segments, index + 1, values)) {
+            return found;
+        }
+        values.removeLast();
+    }
+    return nullptr;
+}
+
+} // namespace mpf
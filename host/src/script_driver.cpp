@@ -0,0 +1,483 @@
+#include "script_driver.h"
+#include "service_registry.h"
+#include "plugin_manager.h"
+#include "plugin_loader.h"
+#include "plugin_metadata.h"
+#include "plugin_context.h"
+#include "logger.h"
+#include "event_bus_service.h"
+#include <mpf/service_ref.h>
+#include <mpf/interfaces/iplugin.h>
+#include <mpf/interfaces/inavigation.h>
+#include <mpf/interfaces/isettings.h>
+#include <mpf/interfaces/itheme.h>
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/ieventbus.h>
+#include <mpf/interfaces/ilogger.h>
+#include <mpf/interfaces/iqmlresources.h>
+
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QMetaMethod>
+#include <QSemaphore>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+#include <memory>
+#include <vector>
+
+namespace mpf {
+
+namespace {
+
+constexpr int kMaxInvokeArgs = 10;  // QMetaMethod::invoke limit
+
+struct LookupTimes {
+    qint64 directNs = -1;           // get<T>() every time
+    qint64 cachedNs = -1;           // ServiceRef<T>
+    QList<QPair<int, qint64>> threadedNs;   // Wall time of get<T>() on 1, 2, 4... threads
+};
+
+template<typename T>
+qint64 timeThreadedLookups(ServiceRegistry* registry, int count, int threads)
+{
+    // Every thread does count lookups; started together so they overlap
+    QSemaphore ready;
+    QSemaphore go;
+    std::vector<std::unique_ptr<QThread>> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(QThread::create([registry, count, &ready, &go]() {
+            volatile quintptr sink = 0;
+            ready.release();
+            go.acquire();
+            for (int i = 0; i < count; ++i) {
+                sink = sink ^ reinterpret_cast<quintptr>(registry->get<T>());
+            }
+        }));
+        workers.back()->start();
+    }
+    ready.acquire(threads);
+    
+    QElapsedTimer timer;
+    timer.start();
+    go.release(threads);
+    for (auto& worker : workers) {
+        worker->wait();
+    }
+    return timer.nsecsElapsed();
+}
+
+template<typename T>
+LookupTimes timeLookups(ServiceRegistry* registry, int count, int threads)
+{
+    LookupTimes times;
+    if (!registry->get<T>()) {
+        return times;
+    }
+    
+    // Fold the results into a volatile so the loops cannot be optimized away
+    volatile quintptr sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        sink = sink ^ reinterpret_cast<quintptr>(registry->get<T>());
+    }
+    times.directNs = timer.nsecsElapsed();
+    
+    ServiceRef<T> ref(registry);
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        sink = sink ^ reinterpret_cast<quintptr>(ref.get());
+    }
+    times.cachedNs = timer.nsecsElapsed();
+    
+    if (threads > 1) {
+        for (int n = 1;; n = qMin(n * 2, threads)) {
+            times.threadedNs.append({n, timeThreadedLookups<T>(registry, count, n)});
+            if (n == threads) {
+                break;
+            }
+        }
+    }
+    return times;
+}
+
+using LookupBenchmark = LookupTimes (*)(ServiceRegistry*, int, int);
+
+const QHash<QString, LookupBenchmark>& lookupBenchmarks()
+{
+    static const QHash<QString, LookupBenchmark> benchmarks{
+        {"INavigation", &timeLookups<INavigation>},
+        {"ISettings", &timeLookups<ISettings>},
+        {"ITheme", &timeLookups<ITheme>},
+        {"IMenu", &timeLookups<IMenu>},
+        {"IEventBus", &timeLookups<IEventBus>},
+        {"ILogger", &timeLookups<ILogger>},
+        {"IQmlResources", &timeLookups<IQmlResources>},
+    };
+    return benchmarks;
+}
+
+QString formatPerOp(qint64 totalNs, int count)
+{
+    double ns = double(totalNs) / count;
+    return ns < 10000 ? QString::number(ns, 'f', 1) + " ns" : QString::number(ns / 1000.0, 'f', 2) + " us";
+}
+
+} // namespace
+
+ScriptDriver::ScriptDriver(ServiceRegistryImpl* registry, PluginManager* pluginManager)
+    : m_registry(registry)
+    , m_pluginManager(pluginManager)
+{
+    m_ops.insert("publish", [this](const QJsonObject& step, int count) { return publish(step, count); });
+    m_ops.insert("invoke", [this](const QJsonObject& step, int count) { return invoke(step, count); });
+    m_ops.insert("lookup", [this](const QJsonObject& step, int count) { return lookup(step, count); });
+    m_ops.insert("log", [this](const QJsonObject& step, int count) { return log(step, count); });
+    m_ops.insert("wait", [this](const QJsonObject& step, int count) { return wait(step, count); });
+    m_ops.insert("state", [this](const QJsonObject& step, int count) { return state(step, count); });
+}
+
+bool ScriptDriver::run(const QString& path, const QString& resultPath)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Script: Cannot open" << path << file.errorString();
+        return false;
+    }
+    
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "Script: Invalid JSON in" << path << error.errorString();
+        return false;
+    }
+    QJsonArray steps = doc.isArray() ? doc.array() : doc.object().value("steps").toArray();
+    
+    qInfo().noquote() << QString("Running script %1 (%2 steps)").arg(path).arg(steps.size());
+    
+    bool ok = true;
+    QJsonArray results;
+    for (int i = 0; i < steps.size(); ++i) {
+        QJsonObject step = steps.at(i).toObject();
+        QString op = step.value("op").toString();
+        int count = qMax(1, step.value("count").toInt(1));
+        
+        auto handler = m_ops.constFind(op);
+        if (handler == m_ops.constEnd()) {
+            qWarning() << "Script: Step" << i << "has unknown op" << op;
+            ok = false;
+            continue;
+        }
+        
+        QElapsedTimer timer;
+        timer.start();
+        bool stepOk = (*handler)(step, count);
+        qint64 elapsed = timer.nsecsElapsed();
+        
+        qInfo().noquote() << QString("  [%1] %2 x%3: %4 ms total, %5 per op%6")
+            .arg(i).arg(op).arg(count)
+            .arg(elapsed / 1.0e6, 0, 'f', 2)
+            .arg(formatPerOp(elapsed, count), stepOk ? QString() : QString(" (FAILED)"));
+        
+        results.append(QJsonObject{
+            {"op", op},
+            {"count", count},
+            {"totalNs", double(elapsed)},
+            {"ok", stepOk},
+        });
+        ok = ok && stepOk;
+    }
+    
+    if (!resultPath.isEmpty()) {
+        QFile out(resultPath);
+        if (out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out.write(QJsonDocument(results).toJson());
+        } else {
+            qWarning() << "Script: Cannot write results to" << resultPath << out.errorString();
+        }
+    }
+    
+    return ok;
+}
+
+bool ScriptDriver::publish(const QJsonObject& step, int count)
+{
+    auto* eventBus = m_registry->get<IEventBus>();
+    QString topic = step.value("topic").toString();
+    if (!eventBus || topic.isEmpty()) {
+        qWarning() << "Script: publish needs IEventBus and a topic";
+        return false;
+    }
+    
+    QVariantMap data = step.value("data").toObject().toVariantMap();
+    QString sender = step.value("sender").toString("script");
+    bool sync = step.value("sync").toBool();
+    for (int i = 0; i < count; ++i) {
+        if (sync) {
+            eventBus->publishSync(topic, data, sender);
+        } else {
+            eventBus->publish(topic, data, sender);
+        }
+    }
+    return true;
+}
+
+bool ScriptDriver::invoke(const QJsonObject& step, int count)
+{
+    QString className = step.value("target").toString();
+    QByteArray methodName = step.value("method").toString().toUtf8();
+    QJsonArray args = step.value("args").toArray();
+    if (args.size() > kMaxInvokeArgs) {
+        qWarning() << "Script: invoke supports at most" << kMaxInvokeArgs << "arguments";
+        return false;
+    }
+    
+    QString pluginId;
+    QObject* target = findTarget(className, &pluginId);
+    if (!target) {
+        qWarning() << "Script: No service or plugin object of class" << className;
+        return false;
+    }
+    
+    // Pick the first invokable overload taking as many arguments as given
+    const QMetaObject* meta = target->metaObject();
+    QMetaMethod method;
+    for (int i = 0; i < meta->methodCount(); ++i) {
+        QMetaMethod candidate = meta->method(i);
+        if (candidate.name() == methodName && candidate.parameterCount() == args.size()
+            && candidate.methodType() != QMetaMethod::Signal) {
+            method = candidate;
+            break;
+        }
+    }
+    if (!method.isValid()) {
+        qWarning() << "Script:" << className << "has no invokable" << methodName
+                   << "taking" << args.size() << "arguments";
+        return false;
+    }
+    
+    QVariantList values;
+    QGenericArgument arguments[kMaxInvokeArgs];
+    for (int i = 0; i < args.size(); ++i) {
+        QVariant value = args.at(i).toVariant();
+        if (!value.convert(method.parameterMetaType(i))) {
+            qWarning() << "Script: Argument" << i << "of" << methodName << "is not a"
+                       << method.parameterMetaType(i).name();
+            return false;
+        }
+        values.append(value);
+    }
+    for (int i = 0; i < values.size(); ++i) {
+        arguments[i] = QGenericArgument(method.parameterMetaType(i).name(), values.at(i).constData());
+    }
+    
+    QVariant result;
+    QGenericReturnArgument returnArgument;
+    if (method.returnMetaType().id() != QMetaType::Void) {
+        result = QVariant(method.returnMetaType());
+        returnArgument = QGenericReturnArgument(method.returnMetaType().name(), result.data());
+    }
+    
+    // Attribute the calls to the plugin that owns the target
+    PluginContextScope context(pluginId);
+    for (int i = 0; i < count; ++i) {
+        if (!method.invoke(target, Qt::DirectConnection, returnArgument,
+                           arguments[0], arguments[1], arguments[2], arguments[3], arguments[4],
+                           arguments[5], arguments[6], arguments[7], arguments[8], arguments[9])) {
+            qWarning() << "Script: Invoking" << className << methodName << "failed";
+            return false;
+        }
+    }
+    
+    if (result.isValid()) {
+        qDebug() << "Script:" << methodName << "returned" << result;
+    }
+    return true;
+}
+
+bool ScriptDriver::lookup(const QJsonObject& step, int count)
+{
+    QString service = step.value("service").toString();
+    auto benchmark = lookupBenchmarks().constFind(service);
+    if (benchmark == lookupBenchmarks().constEnd()) {
+        qWarning() << "Script: lookup supports" << lookupBenchmarks().keys() << "not" << service;
+        return false;
+    }
+    
+    int threads = qMax(1, step.value("threads").toInt(1));
+    LookupTimes times = (*benchmark)(m_registry, count, threads);
+    if (times.directNs < 0) {
+        qWarning() << "Script: Service" << service << "is not registered";
+        return false;
+    }
+    
+    qInfo().noquote() << QString("  %1 lookup: get<T>() %2, ServiceRef<T> %3 per call")
+        .arg(service, formatPerOp(times.directNs, count), formatPerOp(times.cachedNs, count));
+    
+    // Lookups share nothing, so throughput should grow with the thread count
+    if (!times.threadedNs.isEmpty()) {
+        double base = double(count) / times.threadedNs.first().second;
+        for (const auto& [n, ns] : std::as_const(times.threadedNs)) {
+            double perNs = double(count) * n / ns;
+            qInfo().noquote() << QString("    %1 threads: %2 M lookups/s (%3x)")
+                .arg(n, 2)
+                .arg(perNs * 1000.0, 0, 'f', 1)
+                .arg(perNs / base, 0, 'f', 2);
+        }
+    }
+    return true;
+}
+
+bool ScriptDriver::log(const QJsonObject& step, int count)
+{
+    QString message = step.value("message").toString("Script log benchmark message");
+    bool discard = step.value("sink").toString() == QLatin1String("null");
+    int queueSize = step.value("queueSize").toInt(8192);
+    
+    // Loggers of their own, formatted like the host's
+    auto configure = [discard](Logger& logger) {
+        if (Logger* host = Logger::instance()) {
+            logger.setFormat(host->format());
+        }
+        if (discard) {
+            logger.setHandler([](ILogger::Level, const QString&, const QString&) {});
+        }
+    };
+    
+    Logger sync;
+    configure(sync);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        sync.info("Script", message);
+    }
+    qint64 syncNs = timer.nsecsElapsed();
+    
+    Logger async;
+    configure(async);
+    async.enableAsync(queueSize);
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        async.info("Script", message);
+    }
+    qint64 asyncNs = timer.nsecsElapsed();
+    timer.restart();
+    async.flush(-1);
+    qint64 flushNs = timer.nsecsElapsed();
+    
+    qInfo().noquote() << QString("  log: synchronous %1, async %2 per message (%3 ms until written, %4 dropped)")
+        .arg(formatPerOp(syncNs, count), formatPerOp(asyncNs, count))
+        .arg(flushNs / 1.0e6, 0, 'f', 2)
+        .arg(async.droppedCount());
+    return true;
+}
+
+bool ScriptDriver::wait(const QJsonObject& step, int count)
+{
+    Q_UNUSED(count);
+    QEventLoop loop;
+    QTimer::singleShot(step.value("ms").toInt(0), &loop, &QEventLoop::quit);
+    
+    // With a topic, return as soon as a matching event is published
+    QString topic = step.value("topic").toString();
+    bool received = false;
+    if (!topic.isEmpty()) {
+        auto* eventBus = dynamic_cast<EventBusService*>(m_registry->get<IEventBus>());
+        if (!eventBus) {
+            qWarning() << "Script: wait for a topic needs the host's event bus";
+            return false;
+        }
+        QObject::connect(eventBus, &EventBusService::eventPublished, &loop,
+                         [&](const QString& published) {
+            if (eventBus->matchesTopic(published, topic)) {
+                received = true;
+                loop.quit();
+            }
+        });
+    }
+    loop.exec();
+    
+    if (!topic.isEmpty() && !received) {
+        qWarning().noquote() << QString("Script: No %1 event within %2 ms").arg(topic).arg(step.value("ms").toInt(0));
+        return false;
+    }
+    return true;
+}
+
+bool ScriptDriver::state(const QJsonObject& step, int count)
+{
+    Q_UNUSED(count);
+    static const QHash<QString, PluginLoader::State> states = {
+        {"unloaded", PluginLoader::State::Unloaded},
+        {"loaded", PluginLoader::State::Loaded},
+        {"initialized", PluginLoader::State::Initialized},
+        {"started", PluginLoader::State::Started},
+        {"error", PluginLoader::State::Error},
+    };
+    
+    QString id = step.value("plugin").toString();
+    QString expected = step.value("expect").toString("started");
+    PluginLoader* loader = m_pluginManager->plugin(id);
+    if (!loader || !states.contains(expected)) {
+        qWarning() << "Script: state needs a known plugin and one of" << states.keys() << "not" << id << expected;
+        return false;
+    }
+    
+    if (loader->state() != states.value(expected)) {
+        QString actual = states.key(loader->state());
+        qWarning().noquote() << QString("Script: Plugin %1 is %2, expected %3").arg(id, actual, expected);
+        return false;
+    }
+    if (step.contains("outOfProcess") && loader->isOutOfProcess() != step.value("outOfProcess").toBool()) {
+        qWarning().noquote() << QString("Script: Plugin %1 runs %2 process").arg(id, loader->isOutOfProcess() ? "out of" : "in");
+        return false;
+    }
+    return true;
+}
+
+QObject* ScriptDriver::findTarget(const QString& className, QString* pluginId) const
+{
+    QByteArray name = className.toLatin1();
+    
+    // Objects owned by plugins (e.g. orders::OrdersService, which is only
+    // exposed to QML) come first; finding them constructs nothing
+    for (PluginLoader* loader : m_pluginManager->plugins()) {
+        auto* instance = dynamic_cast<QObject*>(loader->plugin());
+        if (!instance) {
+            continue;
+        }
+        QObject* match = instance->inherits(name) ? instance : nullptr;
+        if (!match) {
+            const QList<QObject*> children = instance->findChildren<QObject*>();
+            for (QObject* child : children) {
+                if (child->inherits(name)) {
+                    match = child;
+                    break;
+                }
+            }
+        }
+        if (match) {
+            *pluginId = loader->metadata().id();
+            return match;
+        }
+    }
+    
+    // Then registered services, constructing lazily registered ones as needed
+    for (const QString& interfaceName : m_registry->registeredServices()) {
+        QObject* service = m_registry->object(interfaceName);
+        if (service && service->inherits(name)) {
+            std::optional<ServiceEntry> entry = m_registry->entry(interfaceName);
+            *pluginId = entry && entry->providerId != QLatin1String("host") ? entry->providerId : QString();
+            return service;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace mpf
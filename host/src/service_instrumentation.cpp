@@ -0,0 +1,176 @@
+#include "service_instrumentation.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <vector>
+
+namespace mpf {
+
+QAtomicInt ServiceInstrumentation::s_enabled = 0;
+
+namespace {
+
+// Latency samples kept per method for percentile estimates
+constexpr int kSampleCapacity = 1024;
+
+struct MethodStats
+{
+    QString service;
+    QString member;
+    qint64 calls = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    std::vector<qint64> samples;    // Ring buffer of the most recent calls
+    int nextSample = 0;
+    QHash<QString, qint64> threads; // Caller thread -> call count
+};
+
+struct Collector
+{
+    QMutex mutex;
+    QHash<const QObject*, QString> serviceNames;  // Pruned when the service is destroyed
+    QHash<QPair<QString, quintptr>, MethodStats> methods;  // (service name, member)
+};
+
+Q_GLOBAL_STATIC(Collector, collector)
+
+QString currentThreadName()
+{
+    QThread* thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        return QStringLiteral("main");
+    }
+    QString name = thread->objectName();
+    if (name.isEmpty()) {
+        name = QString("0x%1").arg(reinterpret_cast<quintptr>(thread), 0, 16);
+    }
+    return name;
+}
+
+qint64 percentile(const std::vector<qint64>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+void ServiceInstrumentation::setEnabled(bool enabled)
+{
+    s_enabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+void ServiceInstrumentation::setServiceName(const QObject* service, const QString& interfaceName)
+{
+    QMutexLocker locker(&collector()->mutex);
+    bool known = collector()->serviceNames.contains(service);
+    collector()->serviceNames.insert(service, interfaceName);
+    locker.unlock();
+    
+    if (known) {
+        return;
+    }
+    // A plugin reload frees the service and a later allocation may reuse
+    // its address, so the name must not outlive the object
+    QObject::connect(service, &QObject::destroyed, [service]() {
+        if (collector.isDestroyed()) {
+            return;
+        }
+        QMutexLocker locker(&collector()->mutex);
+        collector()->serviceNames.remove(service);
+    });
+}
+
+void ServiceInstrumentation::record(const QObject* service, const char* member, qint64 elapsedNs)
+{
+    QString thread = currentThreadName();
+    
+    QMutexLocker locker(&collector()->mutex);
+    
+    // Keyed by name rather than address: a reloaded provider continues the
+    // same rows, and a reused address never inherits another service's
+    QString name = collector()->serviceNames.value(service);
+    if (name.isEmpty()) {
+        name = QString::fromLatin1(service->metaObject()->className());
+    }
+    
+    auto key = qMakePair(name, reinterpret_cast<quintptr>(member));
+    MethodStats& stats = collector()->methods[key];
+    if (stats.calls == 0) {
+        stats.service = name;
+        stats.member = QString::fromLatin1(member);
+        stats.samples.reserve(kSampleCapacity);
+    }
+    
+    stats.calls++;
+    stats.totalNs += elapsedNs;
+    stats.maxNs = std::max(stats.maxNs, elapsedNs);
+    stats.threads[thread]++;
+    
+    if (static_cast<int>(stats.samples.size()) < kSampleCapacity) {
+        stats.samples.push_back(elapsedNs);
+    } else {
+        stats.samples[stats.nextSample] = elapsedNs;
+        stats.nextSample = (stats.nextSample + 1) % kSampleCapacity;
+    }
+}
+
+QString ServiceInstrumentation::report()
+{
+    QMutexLocker locker(&collector()->mutex);
+    
+    QList<const MethodStats*> rows;
+    for (const MethodStats& stats : std::as_const(collector()->methods)) {
+        rows.append(&stats);
+    }
+    std::sort(rows.begin(), rows.end(), [](const MethodStats* a, const MethodStats* b) {
+        return a->totalNs > b->totalNs;
+    });
+    
+    QStringList lines;
+    lines << QString("Service call statistics (%1 methods, sorted by total time)").arg(rows.size());
+    lines << QString::asprintf("%10s %11s %10s %10s %10s %10s %10s  %s",
+                               "calls", "total(ms)", "mean(us)", "p50(us)",
+                               "p90(us)", "p99(us)", "max(us)", "method [threads]");
+    
+    for (const MethodStats* stats : rows) {
+        std::vector<qint64> sorted = stats->samples;
+        std::sort(sorted.begin(), sorted.end());
+        
+        QStringList threads;
+        for (auto it = stats->threads.constBegin(); it != stats->threads.constEnd(); ++it) {
+            threads << QString("%1:%2").arg(it.key()).arg(it.value());
+        }
+        threads.sort();
+        
+        lines << QString::asprintf("%10lld %11.3f %10.2f %10.2f %10.2f %10.2f %10.2f  ",
+                                   stats->calls,
+                                   stats->totalNs / 1.0e6,
+                                   stats->totalNs / 1.0e3 / stats->calls,
+                                   percentile(sorted, 0.50) / 1.0e3,
+                                   percentile(sorted, 0.90) / 1.0e3,
+                                   percentile(sorted, 0.99) / 1.0e3,
+                                   stats->maxNs / 1.0e3)
+                 + QString("%1::%2 [%3]").arg(stats->service, stats->member, threads.join(", "));
+    }
+    
+    return lines.join('\n');
+}
+
+void ServiceInstrumentation::reset()
+{
+    QMutexLocker locker(&collector()->mutex);
+    collector()->methods.clear();
+}
+
+} // namespace mpf
@@ -1,134 +1,720 @@
 #include "service_registry.h"
+#include "service_instrumentation.h"
+#include "startup_profiler.h"
+#include "plugin_context.h"
+#include "resource_monitor.h"
+#include <QElapsedTimer>
+#include <QThread>
 #include <QDebug>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <cstring>
 
 namespace mpf {
 
+/**
+ * @brief Shared once-initialization state of a factory-registered service
+ */
+struct ServiceFactoryState
+{
+    QString interfaceName;
+    QString providerId;
+    ServiceFactory factory;
+    std::once_flag once;
+    QObject* instance = nullptr;
+    qint64 elapsedNs = 0;
+};
+
+// Wraps a typeid name without copying it, for allocation-free lookups
+static QByteArray typeKey(const char* typeName)
+{
+    return QByteArray::fromRawData(typeName, static_cast<qsizetype>(std::strlen(typeName)));
+}
+
+namespace {
+
+// Epoch-based reclamation of superseded service tables. A lookup marks
+// its thread with the epoch it started in; a table retired in epoch r is
+// freed once no thread is still in a lookup that started in r or before.
+// Each thread has its own slot, so concurrent lookups share no cache line.
+struct alignas(64) ReaderSlot
+{
+    QAtomicInteger<quint64> epoch = 0;  // 0 outside a lookup
+    QAtomicInt inUse = 1;
+    int depth = 0;                      // Lookups may nest through factories; owning thread only
+};
+
+QAtomicInteger<quint64> s_epoch = 1;
+QMutex s_slotsMutex;
+std::vector<ReaderSlot*> s_slots;       // Never freed; reused once their thread exits
+
+ReaderSlot* acquireSlot()
+{
+    QMutexLocker locker(&s_slotsMutex);
+    for (ReaderSlot* slot : s_slots) {
+        if (slot->inUse.testAndSetAcquire(0, 1)) {
+            return slot;
+        }
+    }
+    s_slots.push_back(new ReaderSlot);
+    return s_slots.back();
+}
+
+struct SlotOwner
+{
+    ReaderSlot* slot = acquireSlot();
+    ~SlotOwner() { slot->inUse.storeRelease(0); }
+};
+
+// Smallest epoch a lookup in progress started in
+quint64 oldestActiveEpoch()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    QMutexLocker locker(&s_slotsMutex);
+    quint64 oldest = std::numeric_limits<quint64>::max();
+    for (const ReaderSlot* slot : s_slots) {
+        quint64 epoch = slot->epoch.loadAcquire();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    return oldest;
+}
+
+// Keeps the tables this thread may read alive while it is in scope
+class LookupScope
+{
+public:
+    LookupScope()
+        : m_slot(slot())
+    {
+        // The fence pairs with the one in oldestActiveEpoch(): either the
+        // writer sees this slot, or this thread loads the newer table
+        if (m_slot->depth++ == 0) {
+            m_slot->epoch.storeRelaxed(s_epoch.loadAcquire());
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    ~LookupScope()
+    {
+        if (--m_slot->depth == 0) {
+            m_slot->epoch.storeRelease(0);
+        }
+    }
+
+    LookupScope(const LookupScope&) = delete;
+    LookupScope& operator=(const LookupScope&) = delete;
+
+private:
+    static ReaderSlot* slot()
+    {
+        thread_local SlotOwner owner;
+        return owner.slot;
+    }
+
+    ReaderSlot* m_slot;
+};
+
+} // namespace
+
 ServiceRegistryImpl::ServiceRegistryImpl(QObject* parent)
     : QObject(parent)
+    , m_table(new ServiceTable)
 {
+    m_clock.start();
 }
 
 ServiceRegistryImpl::~ServiceRegistryImpl()
 {
     QMutexLocker locker(&m_mutex);
-    m_services.clear();
+    
+    delete m_table.fetchAndStoreAcquire(nullptr);
+    m_retiredTables.clear();
+    
+    // Destroy factory-created services in reverse construction order
+    QList<QObject*> constructed = m_constructed;
+    m_constructed.clear();
+    m_factories.clear();
+    
+    // Unfinished promises cancel their futures when destroyed
+    m_pending.clear();
+    locker.unlock();
+    
+    for (auto it = constructed.crbegin(); it != constructed.crend(); ++it) {
+        delete *it;
+    }
+}
+
+void ServiceRegistryImpl::publish(ServiceTable table)
+{
+    // Note: must be called with m_mutex held
+    auto* next = new ServiceTable(std::move(table));
+    const ServiceTable* previous = m_table.fetchAndStoreOrdered(next);
+    
+    // Lookups started in this epoch or before may still hold the previous table
+    m_retiredTables.push_back({std::unique_ptr<const ServiceTable>(previous), s_epoch.fetchAndAddOrdered(1)});
+    reclaimRetiredTables();
+    
+    // Bumped after the table so a reader seeing the new generation sees the new table
+    m_generation.fetchAndAddRelease(1);
+}
+
+void ServiceRegistryImpl::reclaimRetiredTables()
+{
+    // Note: must be called with m_mutex held
+    quint64 oldest = oldestActiveEpoch();
+    auto inUse = [oldest](const RetiredTable& retired) { return retired.epoch >= oldest; };
+    m_retiredTables.erase(std::stable_partition(m_retiredTables.begin(), m_retiredTables.end(), inUse),
+                          m_retiredTables.end());
+}
+
+quint64 ServiceRegistryImpl::generation() const
+{
+    return m_generation.loadAcquire();
+}
+
+// Whether two entries refer to the same registration
+static bool sameProvider(const ServiceEntry& a, const ServiceEntry& b)
+{
+    if (a.factory || b.factory) {
+        return a.factory == b.factory;
+    }
+    return a.instance == b.instance;
+}
+
+// Keeps the list ordered by rank, earlier registrations first among equals
+static qsizetype insertionIndex(const QList<ServiceEntry>& providers, int rank)
+{
+    qsizetype index = 0;
+    while (index < providers.size() && providers.at(index).rank >= rank) {
+        ++index;
+    }
+    return index;
+}
+
+static qsizetype indexOfProvider(const QList<ServiceEntry>& providers, const QString& providerId)
+{
+    for (qsizetype i = 0; i < providers.size(); ++i) {
+        if (providers.at(i).providerId == providerId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ServiceRegistryImpl::insertProvider(const char* typeName, ServiceEntry entry)
+{
+    QString name = entry.interfaceName;
+    if (!entry.providerId.isEmpty() && entry.providerId != QLatin1String("host")) {
+        entry.lastReported = std::make_shared<QAtomicInteger<qint64>>(-usageReportInterval());
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    ProviderList providers = table()->value(typeKey(typeName));
+    for (const ServiceEntry& existing : std::as_const(providers)) {
+        if (existing.providerId == entry.providerId
+            || (entry.instance && existing.instance == entry.instance)) {
+            qWarning() << "ServiceRegistry: Service already registered:" << name
+                       << "from" << existing.providerId;
+            return false;
+        }
+    }
+    
+    bool first = providers.isEmpty();
+    qsizetype index = insertionIndex(providers, entry.rank);
+    providers.insert(index, entry);
+    
+    ServiceTable services = *table();
+    services.insert(QByteArray(typeName), providers);
+    publish(std::move(services));
+    if (entry.factory) {
+        m_factories.append(entry.factory);
+    }
+    
+    locker.unlock();
+    if (entry.instance) {
+        ServiceInstrumentation::setServiceName(entry.instance, name);
+    }
+    if (first) {
+        emit serviceAdded(name);
+    } else if (index == 0) {
+        qDebug() << "ServiceRegistry:" << name << "now provided by" << entry.providerId
+                 << "rank" << entry.rank;
+        emit serviceProviderChanged(name);
+    }
+    
+    resolvePending(typeName, entry.version);
+    return true;
 }
 
-bool ServiceRegistryImpl::addService(const char* typeName, QObject* instance, 
+bool ServiceRegistryImpl::addService(const char* typeName, QObject* instance,
                                   int version, const QString& providerId)
+{
+    // Plugins built against ABI version 1 register default-ranked providers
+    return addRankedService(typeName, instance, version, providerId, 0);
+}
+
+bool ServiceRegistryImpl::addRankedService(const char* typeName, QObject* instance,
+                                           int version, const QString& providerId, int rank)
 {
     if (!instance) {
         qWarning() << "ServiceRegistry: Cannot register null service for" << typeName;
         return false;
     }
-
-    QString name = QString::fromLatin1(typeName);
     
-    QMutexLocker locker(&m_mutex);
+    ServiceEntry entry;
+    entry.interfaceName = QString::fromLatin1(typeName);
+    entry.version = version;
+    entry.instance = instance;
+    entry.providerId = providerId.isEmpty() ? PluginContext::current() : providerId;
+    entry.rank = rank;
     
-    if (m_services.contains(name)) {
-        qWarning() << "ServiceRegistry: Service already registered:" << name;
+    if (!insertProvider(typeName, entry)) {
         return false;
     }
+    
+    qDebug() << "ServiceRegistry: Registered" << entry.interfaceName << "v" << version
+             << "from" << entry.providerId << "rank" << rank;
+    return true;
+}
 
+bool ServiceRegistryImpl::addServiceFactory(const char* typeName, ServiceFactory factory,
+                                            int version, const QString& providerId, int rank)
+{
+    if (!factory) {
+        qWarning() << "ServiceRegistry: Cannot register null factory for" << typeName;
+        return false;
+    }
+    
+    QString name = QString::fromLatin1(typeName);
+    
+    auto state = std::make_shared<ServiceFactoryState>();
+    state->interfaceName = name;
+    state->providerId = providerId.isEmpty() ? PluginContext::current() : providerId;
+    state->factory = std::move(factory);
+    
     ServiceEntry entry;
     entry.interfaceName = name;
     entry.version = version;
-    entry.instance = instance;
-    entry.providerId = providerId;
-
-    m_services.insert(name, entry);
+    entry.instance = nullptr;
+    entry.providerId = state->providerId;
+    entry.rank = rank;
+    entry.factory = state;
     
-    locker.unlock();
-    emit serviceAdded(name);
+    if (!insertProvider(typeName, entry)) {
+        return false;
+    }
     
-    qDebug() << "ServiceRegistry: Registered" << name << "v" << version 
-             << "from" << providerId;
+    qDebug() << "ServiceRegistry: Registered factory for" << name << "v" << version
+             << "from" << entry.providerId << "rank" << rank;
     return true;
 }
 
+QObject* ServiceRegistryImpl::resolve(const ServiceEntry& entry)
+{
+    // Idle unloading counts in seconds; one report per interval is enough,
+    // and only the lookup that wins the exchange makes it
+    if (m_usageHandler && entry.lastReported) {
+        qint64 now = m_clock.elapsed();
+        qint64 last = entry.lastReported->loadRelaxed();
+        if (now - last >= usageReportInterval() && entry.lastReported->testAndSetRelaxed(last, now)) {
+            m_usageHandler(entry.providerId);
+        }
+    }
+    
+    if (entry.instance || !entry.factory) {
+        return entry.instance;
+    }
+    
+    // Run the factory outside the registry lock so it may resolve other services
+    return construct(entry.interfaceName, entry.factory);
+}
+
+QObject* ServiceRegistryImpl::construct(const QString& name,
+                                        const std::shared_ptr<ServiceFactoryState>& state)
+{
+    std::call_once(state->once, [this, &name, &state]() {
+        MPF_PROFILE_SCOPE("construct " + name, "service");
+        ResourceScope resources(state->providerId, ResourceCategory::Service);
+        QElapsedTimer timer;
+        timer.start();
+        QObject* obj = state->factory();
+        qint64 elapsed = timer.nsecsElapsed();
+        
+        if (!obj) {
+            qWarning() << "ServiceRegistry: Factory for" << name << "returned null";
+            return;
+        }
+        
+        ServiceInstrumentation::setServiceName(obj, name);
+        
+        // Services live on the registry's thread regardless of who asked first
+        if (obj->thread() != thread() && !obj->parent()) {
+            obj->moveToThread(thread());
+        }
+        
+        {
+            QMutexLocker locker(&m_mutex);
+            state->instance = obj;
+            state->elapsedNs = elapsed;
+            m_constructed.append(obj);
+            
+            // Publish the instance so later lookups skip the factory path
+            QByteArray key = name.toLatin1();
+            auto it = table()->constFind(key);
+            if (it != table()->constEnd()) {
+                for (qsizetype i = 0; i < it->size(); ++i) {
+                    if (it->at(i).factory == state) {
+                        ServiceTable services = *table();
+                        services[key][i].instance = obj;
+                        publish(std::move(services));
+                        break;
+                    }
+                }
+            }
+        }
+        
+        qDebug() << "ServiceRegistry: Constructed" << name << "in"
+                 << QString::number(elapsed / 1.0e6, 'f', 2) << "ms";
+    });
+    
+    return state->instance;
+}
+
 QObject* ServiceRegistryImpl::getService(const char* typeName, int minVersion)
 {
-    QString name = QString::fromLatin1(typeName);
+    LookupScope scope;
+    const ServiceTable* services = table();
     
-    QMutexLocker locker(&m_mutex);
+    auto it = services->constFind(typeKey(typeName));
+    if (it == services->constEnd()) {
+        // A deferred plugin may provide it; give the handler one chance
+        if (!m_missHandler || !m_missHandler(typeName)) {
+            return nullptr;
+        }
+        services = table();
+        it = services->constFind(typeKey(typeName));
+        if (it == services->constEnd()) {
+            return nullptr;
+        }
+    }
     
-    auto it = m_services.find(name);
-    if (it == m_services.end()) {
-        return nullptr;
+    for (const ServiceEntry& entry : *it) {
+        if (minVersion <= 0 || entry.version >= minVersion) {
+            return resolve(entry);
+        }
     }
+    
+    qWarning() << "ServiceRegistry: Service" << it->first().interfaceName
+               << "version" << it->first().version
+               << "is below required" << minVersion;
+    return nullptr;
+}
 
-    if (minVersion > 0 && it->version < minVersion) {
-        qWarning() << "ServiceRegistry: Service" << name 
-                   << "version" << it->version 
-                   << "is below required" << minVersion;
-        return nullptr;
-    }
+QObject* ServiceRegistryImpl::object(const QString& interfaceName, int minVersion)
+{
+    return getService(interfaceName.toLatin1().constData(), minVersion);
+}
 
-    return it->instance;
+QList<QObject*> ServiceRegistryImpl::getServices(const char* typeName, int minVersion)
+{
+    LookupScope scope;
+    const ServiceTable* services = table();
+    
+    QList<QObject*> result;
+    auto it = services->constFind(typeKey(typeName));
+    if (it == services->constEnd()) {
+        return result;
+    }
+    
+    for (const ServiceEntry& entry : *it) {
+        if (minVersion > 0 && entry.version < minVersion) {
+            continue;
+        }
+        if (QObject* obj = resolve(entry)) {
+            result.append(obj);
+        }
+    }
+    return result;
 }
 
 bool ServiceRegistryImpl::hasService(const char* typeName, int minVersion) const
 {
-    QString name = QString::fromLatin1(typeName);
-    
-    QMutexLocker locker(&m_mutex);
+    LookupScope scope;
+    const ServiceTable* services = table();
     
-    auto it = m_services.find(name);
-    if (it == m_services.end()) {
+    auto it = services->constFind(typeKey(typeName));
+    if (it == services->constEnd()) {
         return false;
     }
+    
+    for (const ServiceEntry& entry : *it) {
+        if (minVersion <= 0 || entry.version >= minVersion) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (minVersion > 0 && it->version < minVersion) {
-        return false;
+QFuture<QObject*> ServiceRegistryImpl::serviceAvailable(const char* typeName, int minVersion)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (hasService(typeName, minVersion)) {
+        locker.unlock();
+        return QtFuture::makeReadyValueFuture(getService(typeName, minVersion));
     }
+    
+    auto promise = std::make_shared<QPromise<QObject*>>();
+    promise->start();
+    m_pending.append({QByteArray(typeName), minVersion, promise});
+    return promise->future();
+}
 
-    return true;
+void ServiceRegistryImpl::resolvePending(const char* typeName, int version)
+{
+    QList<PendingService> ready;
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        QByteArray key = typeKey(typeName);
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (it->typeName == key && (it->minVersion <= 0 || version >= it->minVersion)) {
+                ready.append(*it);
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    // Resolving may run a factory and the waiters' continuations; no lock held
+    for (const PendingService& pending : std::as_const(ready)) {
+        pending.promise->addResult(getService(typeName, pending.minVersion));
+        pending.promise->finish();
+    }
 }
 
 int ServiceRegistryImpl::serviceVersion(const char* typeName) const
+{
+    LookupScope scope;
+    const ServiceTable* services = table();
+    
+    auto it = services->constFind(typeKey(typeName));
+    if (it == services->constEnd()) {
+        return -1;
+    }
+    
+    return it->first().version;
+}
+
+void ServiceRegistryImpl::removeService(const char* typeName)
 {
     QString name = QString::fromLatin1(typeName);
     
     QMutexLocker locker(&m_mutex);
     
-    auto it = m_services.find(name);
-    if (it == m_services.end()) {
-        return -1;
+    if (!table()->contains(typeKey(typeName))) {
+        return;
     }
-
-    return it->version;
+    
+    ServiceTable services = *table();
+    services.remove(typeKey(typeName));
+    publish(std::move(services));
+    
+    locker.unlock();
+    emit serviceRemoved(name);
+    qDebug() << "ServiceRegistry: Removed" << name;
 }
 
-void ServiceRegistryImpl::removeService(const char* typeName)
+bool ServiceRegistryImpl::removeServiceProvider(const QByteArray& typeName, const QString& providerId)
 {
     QString name = QString::fromLatin1(typeName);
     
     QMutexLocker locker(&m_mutex);
     
-    if (m_services.remove(name) > 0) {
-        locker.unlock();
+    ProviderList providers = table()->value(typeName);
+    qsizetype index = indexOfProvider(providers, providerId);
+    if (index < 0) {
+        return false;
+    }
+    
+    providers.removeAt(index);
+    
+    ServiceTable services = *table();
+    if (providers.isEmpty()) {
+        services.remove(typeName);
+    } else {
+        services.insert(typeName, providers);
+    }
+    publish(std::move(services));
+    
+    locker.unlock();
+    qDebug() << "ServiceRegistry: Removed provider" << providerId << "of" << name;
+    if (providers.isEmpty()) {
         emit serviceRemoved(name);
-        qDebug() << "ServiceRegistry: Removed" << name;
+    } else if (index == 0) {
+        emit serviceProviderChanged(name);
     }
+    return true;
 }
 
-QStringList ServiceRegistryImpl::registeredServices() const
+int ServiceRegistryImpl::removeProviders(const QString& providerId)
 {
-    QMutexLocker locker(&m_mutex);
-    return m_services.keys();
+    QStringList removed;
+    QStringList changed;
+    int count = 0;
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        ServiceTable services = *table();
+        for (auto it = services.begin(); it != services.end();) {
+            qsizetype index = indexOfProvider(*it, providerId);
+            if (index < 0) {
+                ++it;
+                continue;
+            }
+            
+            QString name = it->at(index).interfaceName;
+            it->removeAt(index);
+            ++count;
+            
+            if (it->isEmpty()) {
+                removed.append(name);
+                it = services.erase(it);
+            } else {
+                if (index == 0) {
+                    changed.append(name);
+                }
+                ++it;
+            }
+        }
+        
+        if (count == 0) {
+            return 0;
+        }
+        publish(std::move(services));
+    }
+    
+    qDebug() << "ServiceRegistry: Removed" << count << "services from" << providerId;
+    for (const QString& name : std::as_const(removed)) {
+        emit serviceRemoved(name);
+    }
+    for (const QString& name : std::as_const(changed)) {
+        emit serviceProviderChanged(name);
+    }
+    return count;
 }
 
-const ServiceEntry* ServiceRegistryImpl::entry(const QString& interfaceName) const
+bool ServiceRegistryImpl::setProviderRank(const QByteArray& typeName, const QString& providerId, int rank)
 {
+    QString name = QString::fromLatin1(typeName);
+    
     QMutexLocker locker(&m_mutex);
     
-    auto it = m_services.find(interfaceName);
-    if (it == m_services.end()) {
-        return nullptr;
+    ProviderList providers = table()->value(typeName);
+    qsizetype index = indexOfProvider(providers, providerId);
+    if (index < 0) {
+        qWarning() << "ServiceRegistry: No provider" << providerId << "for" << name;
+        return false;
+    }
+    
+    ServiceEntry previousTop = providers.first();
+    ServiceEntry entry = providers.takeAt(index);
+    entry.rank = rank;
+    providers.insert(insertionIndex(providers, rank), entry);
+    bool topChanged = !sameProvider(previousTop, providers.first());
+    
+    ServiceTable services = *table();
+    services.insert(typeName, providers);
+    publish(std::move(services));
+    
+    locker.unlock();
+    qDebug() << "ServiceRegistry: Provider" << providerId << "of" << name << "ranked" << rank;
+    if (topChanged) {
+        emit serviceProviderChanged(name);
+    }
+    return true;
+}
+
+QStringList ServiceRegistryImpl::registeredServices() const
+{
+    LookupScope scope;
+    const ServiceTable* services = table();
+    
+    QStringList names;
+    names.reserve(services->size());
+    for (const ProviderList& providers : *services) {
+        names.append(providers.first().interfaceName);
+    }
+    return names;
+}
+
+std::optional<ServiceEntry> ServiceRegistryImpl::entry(const QString& interfaceName) const
+{
+    LookupScope scope;
+    const ServiceTable* services = table();
+    
+    auto it = services->constFind(interfaceName.toLatin1());
+    if (it == services->constEnd()) {
+        return std::nullopt;
     }
+    return it->first();
+}
+
+QList<ServiceEntry> ServiceRegistryImpl::providers(const QString& interfaceName) const
+{
+    LookupScope scope;
+    return table()->value(interfaceName.toLatin1());
+}
+
+QList<ServiceFactoryTiming> ServiceRegistryImpl::factoryTimings() const
+{
+    QMutexLocker locker(&m_mutex);
     
-    return &it.value();
+    QList<ServiceFactoryTiming> result;
+    result.reserve(m_factories.size());
+    for (const auto& state : m_factories) {
+        ServiceFactoryTiming timing;
+        timing.interfaceName = state->interfaceName;
+        timing.providerId = state->providerId;
+        timing.constructed = state->instance != nullptr;
+        timing.elapsedNs = state->elapsedNs;
+        result.append(timing);
+    }
+    return result;
+}
+
+void ServiceRegistryImpl::setMissHandler(ServiceMissHandler handler)
+{
+    m_missHandler = std::move(handler);
+}
+
+void ServiceRegistryImpl::setUsageHandler(PluginUsageHandler handler)
+{
+    m_usageHandler = std::move(handler);
+}
+
+void ServiceRegistryImpl::setInstrumentationEnabled(bool enabled)
+{
+    ServiceInstrumentation::setEnabled(enabled);
+    qDebug() << "ServiceRegistry: Call instrumentation" << (enabled ? "enabled" : "disabled");
+}
+
+bool ServiceRegistryImpl::isInstrumentationEnabled() const
+{
+    return ServiceInstrumentation::isEnabled();
+}
+
+QString ServiceRegistryImpl::instrumentationReport() const
+{
+    return ServiceInstrumentation::report();
 }
 
 } // namespace mpf
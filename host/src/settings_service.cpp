@@ -1,5 +1,6 @@
 #include "settings_service.h"
 #include "cross_dll_safety.h"
+#include "service_instrumentation.h"
 #include <QStandardPaths>
 #include <QDir>
 
@@ -28,6 +29,7 @@ QVariant SettingsService::value(const QString& pluginId,
                                  const QString& key, 
                                  const QVariant& defaultValue) const
 {
+    MPF_SERVICE_CALL("value");
     // Deep copy the returned value to avoid cross-DLL heap issues
     return deepCopy(m_settings->value(makeKey(pluginId, key), defaultValue));
 }
@@ -36,6 +38,7 @@ void SettingsService::setValue(const QString& pluginId,
                                 const QString& key, 
                                 const QVariant& value)
 {
+    MPF_SERVICE_CALL("setValue");
     QString fullKey = makeKey(pluginId, key);
     QVariant oldValue = m_settings->value(fullKey);
     
@@ -47,16 +50,19 @@ void SettingsService::setValue(const QString& pluginId,
 
 void SettingsService::remove(const QString& pluginId, const QString& key)
 {
+    MPF_SERVICE_CALL("remove");
     m_settings->remove(makeKey(pluginId, key));
 }
 
 bool SettingsService::contains(const QString& pluginId, const QString& key) const
 {
+    MPF_SERVICE_CALL("contains");
     return m_settings->contains(makeKey(pluginId, key));
 }
 
 QStringList SettingsService::keys(const QString& pluginId) const
 {
+    MPF_SERVICE_CALL("keys");
     m_settings->beginGroup(pluginId);
     QStringList result = m_settings->childKeys();
     m_settings->endGroup();
@@ -65,6 +71,7 @@ QStringList SettingsService::keys(const QString& pluginId) const
 
 void SettingsService::sync()
 {
+    MPF_SERVICE_CALL("sync");
     m_settings->sync();
 }
 
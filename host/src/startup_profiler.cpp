@@ -0,0 +1,152 @@
+#include "startup_profiler.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QDebug>
+
+#include <vector>
+
+namespace mpf {
+
+QAtomicInt StartupProfiler::s_enabled = 0;
+
+namespace {
+
+struct Span
+{
+    QString name;
+    const char* category;
+    qint64 startNs;
+    qint64 endNs;
+    int tid;
+};
+
+struct Recorder
+{
+    QMutex mutex;
+    QElapsedTimer clock;
+    QString outputPath;
+    std::vector<Span> spans;
+    QHash<Qt::HANDLE, int> threadIds;   // Native thread -> compact trace tid
+    QHash<int, QString> threadNames;
+};
+
+Q_GLOBAL_STATIC(Recorder, recorder)
+
+// Note: must be called with the recorder mutex held
+int traceThreadId()
+{
+    Qt::HANDLE handle = QThread::currentThreadId();
+    auto it = recorder()->threadIds.constFind(handle);
+    if (it != recorder()->threadIds.constEnd()) {
+        return *it;
+    }
+    
+    int tid = recorder()->threadIds.size() + 1;
+    recorder()->threadIds.insert(handle, tid);
+    
+    QThread* thread = QThread::currentThread();
+    QString name = thread->objectName();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        name = QStringLiteral("main");
+    } else if (name.isEmpty()) {
+        name = QString("worker %1").arg(tid);
+    }
+    recorder()->threadNames.insert(tid, name);
+    return tid;
+}
+
+} // namespace
+
+void StartupProfiler::enableFromEnvironment()
+{
+    QString path = qEnvironmentVariable("MPF_STARTUP_TRACE");
+    if (path.isEmpty()) {
+        return;
+    }
+    
+    QMutexLocker locker(&recorder()->mutex);
+    recorder()->outputPath = path;
+    recorder()->spans.reserve(256);
+    recorder()->clock.start();
+    s_enabled.storeRelease(1);
+}
+
+qint64 StartupProfiler::now()
+{
+    return recorder()->clock.nsecsElapsed();
+}
+
+void StartupProfiler::record(const QString& name, const char* category, qint64 startNs, qint64 endNs)
+{
+    QMutexLocker locker(&recorder()->mutex);
+    // A scope that began before the final write() ends after it
+    if (!isEnabled()) {
+        return;
+    }
+    recorder()->spans.push_back({name, category, startNs, endNs, traceThreadId()});
+}
+
+bool StartupProfiler::write(bool keepRecording)
+{
+    if (!isEnabled()) {
+        return false;
+    }
+    
+    QMutexLocker locker(&recorder()->mutex);
+    
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    
+    for (auto it = recorder()->threadNames.constBegin(); it != recorder()->threadNames.constEnd(); ++it) {
+        QJsonObject event;
+        event["name"] = "thread_name";
+        event["ph"] = "M";
+        event["pid"] = pid;
+        event["tid"] = it.key();
+        event["args"] = QJsonObject{{"name", it.value()}};
+        events.append(event);
+    }
+    
+    // Complete events; the viewer nests them by time per thread
+    for (const Span& span : recorder()->spans) {
+        QJsonObject event;
+        event["name"] = span.name;
+        event["cat"] = QString::fromLatin1(span.category);
+        event["ph"] = "X";
+        event["ts"] = span.startNs / 1000.0;
+        event["dur"] = (span.endNs - span.startNs) / 1000.0;
+        event["pid"] = pid;
+        event["tid"] = span.tid;
+        events.append(event);
+    }
+    
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+    
+    const size_t spanCount = recorder()->spans.size();
+    if (!keepRecording) {
+        s_enabled.storeRelease(0);
+        std::vector<Span>().swap(recorder()->spans);
+    }
+    
+    QFile file(recorder()->outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write startup trace:" << recorder()->outputPath << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    
+    qDebug() << "Startup trace with" << spanCount << "spans written to" << recorder()->outputPath;
+    return true;
+}
+
+} // namespace mpf
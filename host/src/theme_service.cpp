@@ -1,5 +1,6 @@
 #include "theme_service.h"
 #include "cross_dll_safety.h"
+#include "service_instrumentation.h"
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -96,6 +97,7 @@ ThemeService::~ThemeService() = default;
 
 void ThemeService::setTheme(const QString& themeName)
 {
+    MPF_SERVICE_CALL("setTheme");
     if (!m_themes.contains(themeName)) {
         qWarning() << "ThemeService: Unknown theme:" << themeName;
         return;
@@ -107,6 +109,7 @@ void ThemeService::setTheme(const QString& themeName)
 
 QStringList ThemeService::availableThemes() const
 {
+    MPF_SERVICE_CALL("availableThemes");
     return deepCopy(m_themes.keys());
 }
 
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "fixture_plugin.h"
+
+namespace fixtures {
+
+/**
+ * @brief Fixture other fixtures depend on (com.mpf.fixture.base)
+ */
+class BaseFixturePlugin : public FixturePlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID MPF_IPlugin_iid FILE "../base_fixture_plugin.json")
+
+public:
+    explicit BaseFixturePlugin(QObject* parent = nullptr)
+        : FixturePlugin(R"({"id": "com.mpf.fixture.base", "name": "Base Fixture", "version": "1.0.0"})", parent)
+    {
+    }
+};
+
+} // namespace fixtures
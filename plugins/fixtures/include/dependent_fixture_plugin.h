@@ -0,0 +1,22 @@
+#pragma once
+
+#include "fixture_plugin.h"
+
+namespace fixtures {
+
+/**
+ * @brief Fixture requiring the base fixture plugin (com.mpf.fixture.dependent)
+ */
+class DependentFixturePlugin : public FixturePlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID MPF_IPlugin_iid FILE "../dependent_fixture_plugin.json")
+
+public:
+    explicit DependentFixturePlugin(QObject* parent = nullptr)
+        : FixturePlugin(R"({"id": "com.mpf.fixture.dependent", "name": "Dependent Fixture", "version": "1.0.0"})", parent)
+    {
+    }
+};
+
+} // namespace fixtures
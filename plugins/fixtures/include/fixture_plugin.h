@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mpf/interfaces/iplugin.h>
+#include <QObject>
+#include <QJsonObject>
+
+namespace fixtures {
+
+/**
+ * @brief Test-only plugin that does nothing but succeed
+ *
+ * The host/scripts scenarios use these to drive the plugin manager with
+ * metadata the shipped plugins do not have. Each subclass only attaches
+ * its metadata file.
+ */
+class FixturePlugin : public QObject, public mpf::IPlugin
+{
+    Q_OBJECT
+    Q_INTERFACES(mpf::IPlugin)
+
+public:
+    FixturePlugin(const char* metadataJson, QObject* parent = nullptr);
+
+    bool initialize(mpf::ServiceRegistry* registry) override;
+    bool start() override;
+    void stop() override;
+    QJsonObject metadata() const override { return m_metadata; }
+
+private:
+    QJsonObject m_metadata;
+};
+
+} // namespace fixtures
@@ -0,0 +1,31 @@
+#include "fixture_plugin.h"
+
+#include <QJsonDocument>
+#include <QDebug>
+
+namespace fixtures {
+
+FixturePlugin::FixturePlugin(const char* metadataJson, QObject* parent)
+    : QObject(parent)
+    , m_metadata(QJsonDocument::fromJson(metadataJson).object())
+{
+}
+
+bool FixturePlugin::initialize(mpf::ServiceRegistry* registry)
+{
+    Q_UNUSED(registry);
+    qDebug() << "Fixture initialized:" << m_metadata.value("id").toString();
+    return true;
+}
+
+bool FixturePlugin::start()
+{
+    qDebug() << "Fixture started:" << m_metadata.value("id").toString();
+    return true;
+}
+
+void FixturePlugin::stop()
+{
+}
+
+} // namespace fixtures
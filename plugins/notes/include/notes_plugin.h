@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+#include <mpf/interfaces/iplugin.h>
+
+namespace notes {
+
+/**
+ * @brief Sample plugin that runs out of process
+ *
+ * The metadata sets "outOfProcess", so the host runs this class in an
+ * mpf-plugin-host process and reaches it through a RemotePlugin. Its QML
+ * module is plain QML: NotesPage.qml renders in the host from this
+ * library's resources, and it only uses the host's context properties.
+ * The page and the plugin talk over the event bus:
+ *
+ * - "notes/add" {text}: the page adds a note
+ * - "notes/request": the page asks for the current notes
+ * - "notes/changed" {notes}: the plugin sends the notes after either
+ *
+ * Notes are kept in ISettings; the menu badge shows their count. The
+ * plugin registers no services and no QML types, neither of which would
+ * exist outside its process.
+ */
+class NotesPlugin : public QObject, public mpf::IPlugin {
+  Q_OBJECT
+  Q_PLUGIN_METADATA(IID MPF_IPlugin_iid FILE "../notes_plugin.json")
+  Q_INTERFACES(mpf::IPlugin)
+
+public:
+  explicit NotesPlugin(QObject *parent = nullptr);
+  ~NotesPlugin() override;
+
+  // IPlugin interface
+  bool initialize(mpf::ServiceRegistry *registry) override;
+  bool start() override;
+  void stop() override;
+  QJsonObject metadata() const override;
+  QString qmlModuleUri() const override { return "YourCo.Notes"; }
+  QString entryQml() const override { return QString(); }
+
+private slots:
+  void onEvent(const QString &topic, const QVariantMap &data, const QString &senderId);
+
+private:
+  void registerRoutes();
+  void publishNotes();
+
+  mpf::ServiceRegistry *m_registry = nullptr;
+  QStringList m_notes;
+  QString m_subscriptionId;
+};
+
+} // namespace notes
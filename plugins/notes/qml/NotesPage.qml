@@ -0,0 +1,89 @@
+/**
+ * Notes page of an out-of-process plugin
+ *
+ * Rendered in the host process while com.yourco.notes runs in its own
+ * mpf-plugin-host. The plugin's C++ types do not exist here, so the page
+ * uses only the host's context properties (Theme, EventBus) and talks to
+ * the plugin over the event bus.
+ */
+
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+
+Page {
+    id: root
+
+    title: qsTr("Notes")
+
+    property var notes: []
+
+    background: Rectangle {
+        color: Theme ? Theme.backgroundColor : "#FFFFFF"
+    }
+
+    function addNote() {
+        if (noteField.text.trim().length > 0) {
+            EventBus.publish("notes/add", { "text": noteField.text }, "")
+            noteField.text = ""
+        }
+    }
+
+    Component.onCompleted: EventBus.publish("notes/request", {}, "")
+
+    Connections {
+        target: EventBus
+        function onEventPublished(topic, data, senderId) {
+            if (topic === "notes/changed") {
+                root.notes = data.notes || []
+            }
+        }
+    }
+
+    header: ToolBar {
+        background: Rectangle {
+            color: Theme ? Theme.surfaceColor : "#F5F5F5"
+        }
+
+        RowLayout {
+            anchors.fill: parent
+            anchors.margins: Theme ? Theme.spacingSmall : 8
+            spacing: Theme ? Theme.spacingSmall : 8
+
+            Label {
+                text: qsTr("Notes (%1)").arg(root.notes.length)
+                font.pixelSize: 18
+                font.bold: true
+                color: Theme ? Theme.textColor : "#212121"
+                Layout.fillWidth: true
+            }
+
+            TextField {
+                id: noteField
+                placeholderText: qsTr("New note")
+                Layout.preferredWidth: 240
+                onAccepted: root.addNote()
+            }
+
+            Button {
+                text: qsTr("Add")
+                onClicked: root.addNote()
+            }
+        }
+    }
+
+    ListView {
+        anchors.fill: parent
+        anchors.margins: Theme ? Theme.spacingSmall : 8
+        spacing: 4
+        model: root.notes
+
+        delegate: Label {
+            required property string modelData
+            width: ListView.view.width
+            text: modelData
+            wrapMode: Text.Wrap
+            color: Theme ? Theme.textColor : "#212121"
+        }
+    }
+}
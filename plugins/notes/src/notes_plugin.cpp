@@ -0,0 +1,153 @@
+#include "notes_plugin.h"
+
+#include <mpf/service_registry.h>
+#include <mpf/interfaces/inavigation.h>
+#include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/isettings.h>
+#include <mpf/interfaces/ieventbus.h>
+#include <mpf/logger.h>
+
+#include <QJsonDocument>
+
+namespace notes {
+
+namespace {
+
+constexpr auto kPluginId = "com.yourco.notes";
+
+} // namespace
+
+NotesPlugin::NotesPlugin(QObject* parent)
+    : QObject(parent)
+{
+}
+
+NotesPlugin::~NotesPlugin() = default;
+
+bool NotesPlugin::initialize(mpf::ServiceRegistry* registry)
+{
+    m_registry = registry;
+    
+    MPF_LOG_INFO("NotesPlugin", "Initializing...");
+    
+    // Settings calls go to the host process
+    if (auto* settings = m_registry->get<mpf::ISettings>()) {
+        m_notes = settings->value(kPluginId, "notes").toStringList();
+    }
+    
+    MPF_LOG_INFO("NotesPlugin", "Initialized successfully");
+    return true;
+}
+
+bool NotesPlugin::start()
+{
+    MPF_LOG_INFO("NotesPlugin", "Starting...");
+    
+    registerRoutes();
+    
+    // The bus only broadcasts; the subscription makes the host forward
+    // "notes/..." events to this process
+    auto* eventBus = m_registry->get<mpf::IEventBus>();
+    if (!eventBus) {
+        MPF_LOG_ERROR("NotesPlugin", "Event bus not available");
+        return false;
+    }
+    m_subscriptionId = eventBus->subscribe("notes/*", kPluginId);
+    connect(dynamic_cast<QObject*>(eventBus), SIGNAL(eventPublished(QString,QVariantMap,QString)),
+            this, SLOT(onEvent(QString,QVariantMap,QString)));
+    
+    publishNotes();
+    
+    MPF_LOG_INFO("NotesPlugin", "Started successfully");
+    return true;
+}
+
+void NotesPlugin::stop()
+{
+    MPF_LOG_INFO("NotesPlugin", "Stopping...");
+    
+    if (auto* eventBus = m_registry->get<mpf::IEventBus>()) {
+        eventBus->unsubscribe(m_subscriptionId);
+    }
+    if (auto* settings = m_registry->get<mpf::ISettings>()) {
+        settings->sync();
+    }
+    
+    MPF_LOG_INFO("NotesPlugin", "Stopped");
+}
+
+QJsonObject NotesPlugin::metadata() const
+{
+    return QJsonDocument::fromJson(R"({
+        "id": "com.yourco.notes",
+        "name": "Notes Plugin",
+        "version": "1.0.0",
+        "description": "Notes kept by a plugin running in its own process",
+        "vendor": "YourCo",
+        "requires": [
+            {"type": "service", "id": "INavigation", "min": "1.0"}
+        ],
+        "qmlModules": ["YourCo.Notes"],
+        "priority": 20,
+        "outOfProcess": true
+    })").object();
+}
+
+void NotesPlugin::registerRoutes()
+{
+    // IQmlResources is not served to the plugin host; the page's resource
+    // path follows from the module URI (RESOURCE_PREFIX /)
+    if (auto* nav = m_registry->get<mpf::INavigation>()) {
+        nav->registerRoute("notes", "qrc:/YourCo/Notes/NotesPage.qml");
+        MPF_LOG_INFO("NotesPlugin", "Registered route: notes");
+    }
+    
+    if (auto* menu = m_registry->get<mpf::IMenu>()) {
+        mpf::MenuItem item;
+        item.id = "notes";
+        item.label = tr("Notes");
+        item.icon = "📝";
+        item.route = "notes";
+        item.pluginId = kPluginId;
+        item.order = 30;
+        item.group = "Business";
+        
+        if (!menu->registerItem(item)) {
+            MPF_LOG_WARNING("NotesPlugin", "Failed to register menu item");
+            return;
+        }
+        MPF_LOG_DEBUG("NotesPlugin", "Registered menu item");
+    } else {
+        MPF_LOG_WARNING("NotesPlugin", "Menu service not available");
+    }
+}
+
+void NotesPlugin::onEvent(const QString& topic, const QVariantMap& data, const QString& senderId)
+{
+    Q_UNUSED(senderId);
+    if (topic == "notes/add") {
+        QString text = data.value("text").toString().trimmed();
+        if (text.isEmpty()) {
+            return;
+        }
+        m_notes.append(text);
+        if (auto* settings = m_registry->get<mpf::ISettings>()) {
+            settings->setValue(kPluginId, "notes", m_notes);
+        }
+        publishNotes();
+    } else if (topic == "notes/request") {
+        publishNotes();
+    }
+}
+
+void NotesPlugin::publishNotes()
+{
+    if (auto* menu = m_registry->get<mpf::IMenu>()) {
+        menu->setBadge("notes", m_notes.isEmpty() ? QString() : QString::number(m_notes.size()));
+    }
+    if (auto* eventBus = m_registry->get<mpf::IEventBus>()) {
+        eventBus->publish("notes/changed", {{"notes", m_notes}}, kPluginId);
+    }
+}
+
+} // namespace notes
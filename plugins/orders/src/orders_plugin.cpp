@@ -30,14 +30,12 @@
 #include <mpf/service_registry.h>        // 服务注册表
 #include <mpf/interfaces/inavigation.h>  // 导航服务接口
 #include <mpf/interfaces/imenu.h>        // 菜单服务接口
+#include <mpf/interfaces/iqmlresources.h> // QML 资源索引接口
+#include <mpf/runtime.h>                 // 运行模式（isHeadless）
 #include <mpf/logger.h>                  // 日志宏
 
 #include <QJsonDocument>
 #include <QQmlEngine>
-#include <QCoreApplication>
-#include <QDir>
-#include <QUrl>
-#include <QFile>
 
 // 【修改点1】命名空间
 namespace orders {
@@ -63,6 +61,9 @@ bool OrdersPlugin::initialize(mpf::ServiceRegistry* registry)
 {
     m_registry = registry;
     
+    // 日志宏经由宿主的 ILogger 输出（宿主可在后台线程写日志，不阻塞界面）
+    mpf::LoggerAccess::setInstance(registry->get<mpf::ILogger>());
+    
     // -------------------------------------------------------------------------
     // 【日志使用示例】
     // MPF 提供统一的日志宏，支持不同级别：
@@ -74,19 +75,6 @@ bool OrdersPlugin::initialize(mpf::ServiceRegistry* registry)
     // -------------------------------------------------------------------------
     MPF_LOG_INFO("OrdersPlugin", "Initializing...");
     
-    // -------------------------------------------------------------------------
-    // 【调试】检查 qrc 资源是否可访问
-    // -------------------------------------------------------------------------
-    QStringList resourcesToCheck = {
-        ":/YourCo/Orders/qml/OrdersPage.qml",
-        "qrc:/YourCo/Orders/qml/OrdersPage.qml"
-    };
-    for (const QString& res : resourcesToCheck) {
-        QFile f(res);
-        MPF_LOG_DEBUG("OrdersPlugin", 
-            QString("Resource check: %1 exists=%2").arg(res).arg(f.exists() ? "YES" : "NO").toStdString().c_str());
-    }
-    
     // -------------------------------------------------------------------------
     // 【服务创建】
     // 在初始化阶段创建业务服务实例
@@ -98,8 +86,11 @@ bool OrdersPlugin::initialize(mpf::ServiceRegistry* registry)
     // 【QML 类型注册】
     // 必须在 QML 引擎加载任何使用这些类型的文件之前完成
     // 所以放在 initialize() 而不是 start() 中
+    // 无界面（headless）宿主没有 QML 引擎，只运行服务，跳过注册
     // -------------------------------------------------------------------------
-    registerQmlTypes();
+    if (!mpf::isHeadless()) {
+        registerQmlTypes();
+    }
     
     MPF_LOG_INFO("OrdersPlugin", "Initialized successfully");
     return true;
@@ -222,47 +213,15 @@ void OrdersPlugin::registerRoutes()
     // -------------------------------------------------------------------------
     auto* nav = m_registry->get<mpf::INavigation>();
     if (nav) {
-        // 构建 QML 搜索路径列表（优先级从高到低）
-        QStringList searchPaths;
-        QString appDir = QCoreApplication::applicationDirPath();
-        
-        // 1. MPF_SDK_ROOT 环境变量（mpf-dev 设置）
-        QString sdkRoot = qEnvironmentVariable("MPF_SDK_ROOT");
-        if (!sdkRoot.isEmpty()) {
-            searchPaths << QDir::cleanPath(sdkRoot + "/qml");
-        }
-        
-        // 2. QML_IMPORT_PATH 环境变量
-        QString qmlImportPaths = qEnvironmentVariable("QML_IMPORT_PATH");
-        searchPaths << qmlImportPaths.split(QDir::listSeparator(), Qt::SkipEmptyParts);
-        
-        // 3. 应用程序相对路径（标准 SDK 安装布局）
-        searchPaths << QDir::cleanPath(appDir + "/../qml");
-        
-        // 4. 应用程序同级 qml 目录（开发模式）
-        searchPaths << QDir::cleanPath(appDir + "/qml");
+        // 查找页面：使用宿主的 QML 资源索引（宿主核心服务，本 SDK ABI 的宿主都提供）
+        auto* resources = m_registry->get<mpf::IQmlResources>();
+        QString ordersPage = resources ? resources->fileUrl("YourCo.Orders", "OrdersPage.qml") : QString();
         
-        // 查找 QML 模块目录
-        QString qmlBase;
-        QString qmlFile;
-        for (const QString& basePath : searchPaths) {
-            QString candidate = QDir::cleanPath(basePath + "/YourCo/Orders/OrdersPage.qml");
-            if (QFile::exists(candidate)) {
-                qmlBase = QDir::cleanPath(basePath + "/YourCo/Orders");
-                qmlFile = candidate;
-                break;
-            }
-        }
-        
-        if (qmlFile.isEmpty()) {
+        if (ordersPage.isEmpty()) {
             MPF_LOG_ERROR("OrdersPlugin", "Could not find YourCo/Orders/OrdersPage.qml!");
-            MPF_LOG_ERROR("OrdersPlugin", QString("Searched paths: %1").arg(searchPaths.join("; ")).toStdString().c_str());
             return;
         }
         
-        QString ordersPage = QUrl::fromLocalFile(qmlFile).toString();
-        
-        MPF_LOG_INFO("OrdersPlugin", QString("QML base path: %1").arg(qmlBase).toStdString().c_str());
         MPF_LOG_INFO("OrdersPlugin", QString("Orders page URL: %1").arg(ordersPage).toStdString().c_str());
         
         // 注册主页面（内部导航使用 Popup）
@@ -3,7 +3,7 @@
 #include <QAbstractListModel>
 #include "orders_service.h"
 
-namespace orders {
+namespace rules {
 
 /**
  * @brief List model for orders
@@ -15,7 +15,7 @@ class OrderModel : public QAbstractListModel
     Q_OBJECT
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
     Q_PROPERTY(QString filterStatus READ filterStatus WRITE setFilterStatus NOTIFY filterStatusChanged)
-    Q_PROPERTY(orders::OrdersService* service READ service WRITE setService NOTIFY serviceChanged)
+    Q_PROPERTY(rules::OrdersService* service READ service WRITE setService NOTIFY serviceChanged)
 
 public:
     enum Roles {
@@ -66,4 +66,4 @@ private:
     QString m_filterStatus;
 };
 
-} // namespace orders
+} // namespace rules
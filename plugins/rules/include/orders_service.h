@@ -5,7 +5,7 @@
 #include <QVariantMap>
 #include <QDateTime>
 
-namespace orders {
+namespace rules {
 
 struct Order {
     QString id;
@@ -60,4 +60,4 @@ private:
     QList<Order> m_orders;
 };
 
-} // namespace orders
+} // namespace rules
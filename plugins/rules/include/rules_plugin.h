@@ -3,12 +3,10 @@
 #include <QObject>
 #include <mpf/interfaces/iplugin.h>
 
-namespace orders {
-class OrdersService;
-}
-
 namespace rules {
 
+class OrdersService;
+
 /**
  * @brief Orders plugin implementation
  *
@@ -40,7 +38,7 @@ private:
   void registerQmlTypes();
 
   mpf::ServiceRegistry *m_registry = nullptr;
-  std::unique_ptr<orders::OrdersService> m_ordersService;
+  std::unique_ptr<OrdersService> m_ordersService;
 };
 
 } // namespace rules
@@ -1,7 +1,7 @@
 #include "order_model.h"
 #include "orders_service.h"
 
-namespace orders {
+namespace rules {
 
 OrderModel::OrderModel(QObject* parent)
     : QAbstractListModel(parent)
@@ -132,4 +132,4 @@ void OrderModel::updateFilteredOrders()
     emit countChanged();
 }
 
-} // namespace orders
+} // namespace rules
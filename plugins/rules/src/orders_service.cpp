@@ -3,7 +3,7 @@
 #include <QDateTime>
 #include <algorithm>
 
-namespace orders {
+namespace rules {
 
 // Order methods
 
@@ -158,4 +158,4 @@ QString OrdersService::generateId() const
     return QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
 }
 
-} // namespace orders
+} // namespace rules
@@ -5,14 +5,12 @@
 #include <mpf/service_registry.h>
 #include <mpf/interfaces/inavigation.h>
 #include <mpf/interfaces/imenu.h>
+#include <mpf/interfaces/iqmlresources.h>
+#include <mpf/runtime.h>
 #include <mpf/logger.h>
 
 #include <QJsonDocument>
 #include <QQmlEngine>
-#include <QFile>
-#include <QDir>
-#include <QUrl>
-#include <QCoreApplication>
 
 namespace rules {
 
@@ -27,24 +25,18 @@ bool RulesPlugin::initialize(mpf::ServiceRegistry* registry)
 {
     m_registry = registry;
     
-    MPF_LOG_INFO("RulesPlugin", "Initializing...");
+    // Log through the host's ILogger (which may write on a background thread)
+    mpf::LoggerAccess::setInstance(registry->get<mpf::ILogger>());
     
-    // 调试：检查 qrc 资源是否可访问
-    QStringList resourcesToCheck = {
-        ":/Biiz/Rules/qml/OrdersPage.qml",
-        "qrc:/Biiz/Rules/qml/OrdersPage.qml"
-    };
-    for (const QString& res : resourcesToCheck) {
-        QFile f(res);
-        MPF_LOG_DEBUG("RulesPlugin", 
-            QString("Resource check: %1 exists=%2").arg(res).arg(f.exists() ? "YES" : "NO").toStdString().c_str());
-    }
+    MPF_LOG_INFO("RulesPlugin", "Initializing...");
     
     // Create and register our service
-    m_ordersService = std::make_unique<orders::OrdersService>(this);
+    m_ordersService = std::make_unique<OrdersService>(this);
     
-    // Register QML types
-    registerQmlTypes();
+    // Register QML types (a headless host has no QML engine)
+    if (!mpf::isHeadless()) {
+        registerQmlTypes();
+    }
     
     MPF_LOG_INFO("RulesPlugin", "Initialized successfully");
     return true;
@@ -104,44 +96,15 @@ void RulesPlugin::registerRoutes()
 {
     auto* nav = m_registry->get<mpf::INavigation>();
     if (nav) {
-        // 构建 QML 搜索路径列表（优先级从高到低）
-        QStringList searchPaths;
-        QString appDir = QCoreApplication::applicationDirPath();
-        
-        // 1. MPF_SDK_ROOT 环境变量（mpf-dev 设置）
-        QString sdkRoot = qEnvironmentVariable("MPF_SDK_ROOT");
-        if (!sdkRoot.isEmpty()) {
-            searchPaths << QDir::cleanPath(sdkRoot + "/qml");
-        }
+        // Resolve through the host's QML resource index (a core host service)
+        auto* resources = m_registry->get<mpf::IQmlResources>();
+        QString rulesPage = resources ? resources->fileUrl("Biiz.Rules", "RulesPage.qml") : QString();
         
-        // 2. QML_IMPORT_PATH 环境变量
-        QString qmlImportPaths = qEnvironmentVariable("QML_IMPORT_PATH");
-        searchPaths << qmlImportPaths.split(QDir::listSeparator(), Qt::SkipEmptyParts);
-        
-        // 3. 应用程序相对路径（标准 SDK 安装布局）
-        searchPaths << QDir::cleanPath(appDir + "/../qml");
-        
-        // 4. 应用程序同级 qml 目录（开发模式）
-        searchPaths << QDir::cleanPath(appDir + "/qml");
-        
-        // 查找 QML 模块目录
-        QString qmlFile;
-        for (const QString& basePath : searchPaths) {
-            QString candidate = QDir::cleanPath(basePath + "/Biiz/Rules/RulesPage.qml");
-            if (QFile::exists(candidate)) {
-                qmlFile = candidate;
-                break;
-            }
-        }
-        
-        if (qmlFile.isEmpty()) {
+        if (rulesPage.isEmpty()) {
             MPF_LOG_ERROR("RulesPlugin", "Could not find Biiz/Rules/RulesPage.qml!");
-            MPF_LOG_ERROR("RulesPlugin", QString("Searched paths: %1").arg(searchPaths.join("; ")).toStdString().c_str());
             return;
         }
         
-        QString rulesPage = QUrl::fromLocalFile(qmlFile).toString();
-        
         MPF_LOG_INFO("RulesPlugin", QString("Rules page URL: %1").arg(rulesPage).toStdString().c_str());
         
         // 注册主页面（内部导航使用 Popup）
@@ -172,7 +135,7 @@ void RulesPlugin::registerRoutes()
         menu->setBadge("rules", QString::number(m_ordersService->getOrderCount()));
         
         // Connect to update badge when rules change
-        connect(m_ordersService.get(), &orders::OrdersService::ordersChanged, this, [this, menu]() {
+        connect(m_ordersService.get(), &OrdersService::ordersChanged, this, [this, menu]() {
             menu->setBadge("rules", QString::number(m_ordersService->getOrderCount()));
         });
         
@@ -188,7 +151,7 @@ void RulesPlugin::registerQmlTypes()
     qmlRegisterSingletonInstance("Biiz.Rules", 1, 0, "RulesService", m_ordersService.get());
     
     // Register model
-    qmlRegisterType<orders::OrderModel>("Biiz.Rules", 1, 0, "RuleModel");
+    qmlRegisterType<OrderModel>("Biiz.Rules", 1, 0, "RuleModel");
     
     MPF_LOG_DEBUG("RulesPlugin", "Registered QML types");
 }
@@ -22,14 +22,15 @@ public:
 
     /**
      * @brief Register a route with its QML page URL
-     * @param route Route name (e.g., "orders", "settings")
+     * @param route Route name (e.g., "orders", "settings"), or a pattern with
+     *        parameter segments (e.g., "orders/:id") serving every matching route
      * @param qmlPageUrl Full URL to the QML page file
      */
     virtual void registerRoute(const QString& route, const QString& qmlPageUrl) = 0;
 
     /**
      * @brief Get the QML page URL for a route
-     * @param route Route name
+     * @param route Route name (e.g., "orders/42" for the pattern "orders/:id")
      * @return QML page URL, or empty string if not found
      */
     virtual QString getPageUrl(const QString& route) const = 0;
@@ -13,6 +13,16 @@ class ServiceRegistry;
  * 
  * Every plugin must implement this interface. The host will call these
  * methods during plugin lifecycle.
+ *
+ * A plugin whose metadata declares "threadSafe": true may have
+ * initialize() and start() called on a worker thread of the host's pool,
+ * which runs no event loop. Such a plugin must not create QObjects there:
+ * they would belong to that thread, so their timers and queued slots never
+ * run, and they cannot be children of the plugin instance, which lives on
+ * the GUI thread. Calling host services is fine. Create QObjects in the
+ * constructor or on the GUI thread instead, e.g. with
+ * QMetaObject::invokeMethod(this, ..., Qt::QueuedConnection). stop() is
+ * always called on the GUI thread.
  */
 class IPlugin
 {
@@ -58,5 +68,11 @@ public:
 
 } // namespace mpf
 
-#define MPF_IPlugin_iid "com.mpf.IPlugin/1.0"
+// The interface ID carries the SDK's binary interface version
+// (MPF_ABI_VERSION): a host built against an older SDK does not recognize
+// the plugin and refuses it, instead of calling past the end of its
+// ServiceRegistry vtable. Hosts still accept plugins of the previous
+// version, whose vtable slots are kept.
+#define MPF_IPlugin_iid "com.mpf.IPlugin/2.0"
+#define MPF_IPlugin_iid_v1 "com.mpf.IPlugin/1.0"
 Q_DECLARE_INTERFACE(mpf::IPlugin, MPF_IPlugin_iid)
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace mpf {
+
+/**
+ * @brief Index of the QML modules found on the QML search paths
+ *
+ * The host finds a module on the QML search paths (MPF_SDK_ROOT/qml,
+ * QML_IMPORT_PATH, the application's qml directories) the first time it
+ * is looked up and records its directory (one with a qmldir file) and the
+ * QML files in it. Plugins resolve their pages here instead of probing
+ * the filesystem. Later lookups are hash lookups; all are thread-safe.
+ *
+ * Files of modules built with qt_add_qml_module are also linked into the
+ * binaries as compiled units; fileUrl() returns those (qrc:) URLs when
+ * they exist, so pages skip parsing and compilation at runtime. Setting
+ * MPF_QML_FROM_DISK=1 returns the files on disk instead.
+ */
+class IQmlResources
+{
+public:
+    virtual ~IQmlResources() = default;
+
+    /**
+     * @brief Directory of a QML module
+     * @param uri Module URI (e.g., "YourCo.Orders")
+     * @return Absolute directory, or empty string if not found
+     */
+    virtual QString moduleDirectory(const QString& uri) const = 0;
+
+    /**
+     * @brief URL of a QML file inside a module
+     * @param uri Module URI (e.g., "YourCo.Orders")
+     * @param fileName File path relative to the module directory (e.g., "OrdersPage.qml")
+     * @return Resource or file URL, or empty string if not found
+     */
+    virtual QString fileUrl(const QString& uri, const QString& fileName) const = 0;
+
+    /**
+     * @brief Directories the index was built from, highest priority first
+     */
+    virtual QStringList searchPaths() const = 0;
+
+    static constexpr int apiVersion() { return 1; }
+};
+
+} // namespace mpf
@@ -15,3 +15,5 @@
 #include <mpf/interfaces/itheme.h>
 #include <mpf/interfaces/imenu.h>
 #include <mpf/interfaces/ieventbus.h>
+#include <mpf/interfaces/iqmlresources.h>
+#include <mpf/runtime.h>
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QCoreApplication>
+
+namespace mpf {
+
+/**
+ * @brief Whether the host runs without GUI and QML
+ *
+ * A headless host (mpf-host --headless or MPF_HEADLESS=1) runs on a plain
+ * QCoreApplication: services and the plugin lifecycle work as usual, but
+ * there is no QML engine and no window. Plugins should skip QML type
+ * registration and anything else that needs a GUI when this returns true.
+ */
+inline bool isHeadless()
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    return app && !app->inherits("QGuiApplication");
+}
+
+} // namespace mpf
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mpf/service_registry.h>
+
+namespace mpf {
+
+/**
+ * @brief Cached service lookup that follows provider changes
+ *
+ * Resolves the service once and re-resolves only when the registry's
+ * generation changes, e.g. after a higher-ranked provider is installed
+ * or the current one is removed. Not synchronized: use one instance
+ * per thread.
+ *
+ * @code
+ * ServiceRef<ILogger> logger(registry);
+ * if (logger) logger->info("Tag", "message");
+ * @endcode
+ */
+template<typename T>
+class ServiceRef
+{
+public:
+    explicit ServiceRef(ServiceRegistry* registry, int minVersion = 0)
+        : m_registry(registry)
+        , m_minVersion(minVersion)
+    {
+    }
+
+    /**
+     * @brief Get the current provider (nullptr if none)
+     */
+    T* get() const
+    {
+        if (!m_registry) {
+            return nullptr;
+        }
+        quint64 generation = m_registry->generation();
+        if (generation != m_generation) {
+            m_service = m_registry->template get<T>(m_minVersion);
+            m_generation = generation;
+        }
+        return m_service;
+    }
+
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+private:
+    ServiceRegistry* m_registry;
+    int m_minVersion;
+    mutable T* m_service = nullptr;
+    mutable quint64 m_generation = ~quint64(0);
+};
+
+} // namespace mpf
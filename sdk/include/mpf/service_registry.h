@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QString>
+#include <QList>
+#include <QFuture>
 #include <typeinfo>
 
 class QObject;
@@ -12,6 +14,11 @@ namespace mpf {
  * 
  * The actual implementation is in the host application.
  * Plugins receive a pointer to ServiceRegistry via IPlugin::initialize().
+ *
+ * Plugins are built separately from the host, so the order of the virtual
+ * functions is part of the binary interface: new virtuals are appended
+ * after those of the previous ABI version (see MPF_IPlugin_iid), never
+ * inserted or overloaded.
  */
 class ServiceRegistry
 {
@@ -20,6 +27,10 @@ public:
 
     /**
      * @brief Get a service by interface type
+     *
+     * If several providers implement the interface, the highest-ranked one
+     * that satisfies minVersion is returned.
+     *
      * @tparam T Interface type
      * @param minVersion Minimum required version (0 = any)
      * @return Service instance or nullptr if not found
@@ -31,22 +42,45 @@ public:
         return dynamic_cast<T*>(obj);
     }
 
+    /**
+     * @brief Get all providers of an interface
+     * @tparam T Interface type
+     * @param minVersion Minimum required version (0 = any)
+     * @return Providers ordered by rank, highest first
+     */
+    template<typename T>
+    QList<T*> getAll(int minVersion = 0)
+    {
+        QList<T*> result;
+        for (QObject* obj : getServices(typeid(T).name(), minVersion)) {
+            if (T* service = dynamic_cast<T*>(obj)) {
+                result.append(service);
+            }
+        }
+        return result;
+    }
+
     /**
      * @brief Register a service implementation
+     *
+     * Several providers may implement the same interface; get<T>() returns
+     * the one with the highest rank (ties go to the earlier registration).
+     *
      * @tparam T Interface type
      * @param instance Service instance
      * @param version API version
      * @param providerId Plugin ID providing this service
+     * @param rank Provider rank (default providers use 0)
      * @return true if registration succeeded
      */
     template<typename T>
-    bool add(T* instance, int version = 1, const QString& providerId = {})
+    bool add(T* instance, int version = 1, const QString& providerId = {}, int rank = 0)
     {
         QObject* obj = dynamic_cast<QObject*>(instance);
         if (!obj) {
             obj = reinterpret_cast<QObject*>(instance);
         }
-        return addService(typeid(T).name(), obj, version, providerId);
+        return addRankedService(typeid(T).name(), obj, version, providerId, rank);
     }
 
     /**
@@ -58,10 +92,55 @@ public:
         return hasService(typeid(T).name(), minVersion);
     }
 
+    /**
+     * @brief Wait for a service to become available
+     *
+     * The returned future is already finished if the service is registered;
+     * otherwise it finishes when a provider with a matching version is added.
+     * Unless a context object is passed to then(), continuations run in the
+     * thread that registers the service. The future is canceled if the
+     * registry is destroyed first.
+     *
+     * @code
+     * registry->whenAvailable<IOrders>().then(this, [this](IOrders* orders) {
+     *     m_orders = orders;
+     * });
+     * @endcode
+     *
+     * @tparam T Interface type
+     * @param minVersion Minimum required version (0 = any)
+     * @note Part of ABI version 2: hosts of version 1 do not implement it,
+     *       and they refuse plugins built against this SDK (see MPF_IPlugin_iid)
+     */
+    template<typename T>
+    QFuture<T*> whenAvailable(int minVersion = 0)
+    {
+        return serviceAvailable(typeid(T).name(), minVersion)
+            .then([](QObject* obj) { return dynamic_cast<T*>(obj); });
+    }
+
 protected:
+    // ABI version 1
     virtual QObject* getService(const char* typeName, int minVersion) = 0;
     virtual bool addService(const char* typeName, QObject* instance, int version, const QString& providerId) = 0;
     virtual bool hasService(const char* typeName, int minVersion) const = 0;
+
+public:
+    // ABI version 2
+
+    /**
+     * @brief Counter bumped on every registration or provider change
+     *
+     * Lets callers cache a resolved service and re-resolve only when the
+     * registry has changed (see ServiceRef).
+     */
+    virtual quint64 generation() const = 0;
+
+protected:
+    virtual QList<QObject*> getServices(const char* typeName, int minVersion) = 0;
+    virtual bool addRankedService(const char* typeName, QObject* instance, int version,
+                                  const QString& providerId, int rank) = 0;
+    virtual QFuture<QObject*> serviceAvailable(const char* typeName, int minVersion) = 0;
 };
 
 } // namespace mpf